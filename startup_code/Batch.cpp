@@ -0,0 +1,263 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include "Batch.h"
+
+namespace {
+
+void appendNumber(std::string& text, long long value) {
+    char digits[24];
+    int length = std::snprintf(digits, sizeof(digits), "%lld", value);
+    text.append(digits, length);
+}
+
+// Writes the change as denomination*count pairs, largest first, or "-" if there was none.
+void appendChange(std::string& text, const int* change) {
+    std::size_t start = text.size();
+    for (int slot = NUM_DENOMS - 1; slot >= 0; slot--) {
+        if (change[slot] > 0) {
+            if (text.size() > start) {
+                text += ',';
+            }
+            appendNumber(text, DENOMINATION_VALUES[slot]);
+            text += '*';
+            appendNumber(text, change[slot]);
+        }
+    }
+    if (text.size() == start) {
+        text += '-';
+    }
+}
+
+}
+
+Batch::Batch(SessionEngine& engine) : engine(engine), stats() {}
+
+// This method runs every transaction in the file on the given number of terminals and writes one
+// result line for each to out. It returns false if the file could not be opened.
+bool Batch::run(const std::string& filename, unsigned terminals, std::ostream& out) {
+    DataFile file(filename);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    StrRef line;
+
+    if (!file.isOpen()) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+    }
+    while (file.isOpen() && file.nextLine(line)) {
+        if (!line.empty() && line.data[0] != '#') {
+            transactions.push_back(Transaction{line, file.lineNumber()});
+        }
+    }
+
+    if (terminals <= 1) {
+        runTerminal(0, 1, out, stats);
+    } else {
+        std::vector<BatchStats> terminalStats(terminals, BatchStats());
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < terminals; t++) {
+            threads.emplace_back(&Batch::runTerminal, this, t, terminals, std::ref(out), std::ref(terminalStats[t]));
+        }
+        for (unsigned t = 0; t < terminals; t++) {
+            threads[t].join();
+            stats.transactions += terminalStats[t].transactions;
+            stats.succeeded += terminalStats[t].succeeded;
+            stats.failed += terminalStats[t].failed;
+        }
+    }
+    out.flush();
+    transactions.clear();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return file.isOpen();
+}
+
+// This method reads a change file and makes every change in it, or none of them if any line is not
+// a change or any change cannot be made. Blank lines and lines starting with '#' are skipped. Every
+// change gets one result line, in file order: "<line>|OK|<food id>" once made, "<line>|FAIL|<reason>"
+// for a line at fault, and "<line>|SKIP|<food id>" for the rest when nothing was made. Returns true
+// if the changes were made.
+bool Batch::applyChanges(const std::string& filename, std::ostream& out) {
+    DataFile file(filename);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<MenuChange> changes;
+    std::vector<const char*> lineFailures;
+    std::vector<const char*> failures;
+    bool parsed = file.isOpen();
+    bool applied = false;
+    StrRef line;
+
+    if (!file.isOpen()) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+    }
+    while (file.isOpen() && file.nextLine(line)) {
+        if (!line.empty() && line.data[0] != '#') {
+            transactions.push_back(Transaction{line, file.lineNumber()});
+            lineFailures.push_back(MenuChange::parse(line, changes));
+            parsed = parsed && lineFailures.back() == nullptr;
+        }
+    }
+    if (parsed) {
+        applied = engine.applyChanges(changes, failures);
+    } else {
+        engine.checkChanges(changes, failures);
+    }
+
+    std::string results;
+    std::size_t c = 0;
+    for (std::size_t i = 0; i < transactions.size(); i++) {
+        const char* failure = lineFailures[i];
+        const char* itemId = nullptr;
+        if (failure == nullptr) {
+            failure = failures[c];
+            itemId = changes[c].item.id;
+            c++;
+        }
+
+        stats.transactions++;
+        appendNumber(results, transactions[i].lineNo);
+        if (failure != nullptr) {
+            stats.failed++;
+            results += "|FAIL|";
+            results += failure;
+        } else if (applied) {
+            stats.succeeded++;
+            results += "|OK|";
+            results += itemId;
+        } else {
+            results += "|SKIP|";
+            results += itemId;
+        }
+        results += '\n';
+
+        if (results.size() >= BATCH_OUTPUT_BYTES) {
+            writeResults(results, out);
+        }
+    }
+    writeResults(results, out);
+    out.flush();
+    transactions.clear();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return applied;
+}
+
+// This method runs transactions first, first + step, first + 2 * step, ... as one terminal.
+void Batch::runTerminal(unsigned first, unsigned step, std::ostream& out, BatchStats& terminalStats) {
+    std::string results;
+    std::string detail;
+    std::vector<int> payments;
+
+    for (std::size_t i = first; i < transactions.size(); i += step) {
+        StrRef fields[5];
+        unsigned found = DataFile::split(transactions[i].line, '|', fields, 5);
+        const char* failure = "unknown transaction type";
+        detail.clear();
+
+        if (fields[0].length == 1 && fields[0].data[0] == 'P') {
+            failure = purchase(fields, found, payments, detail);
+        } else if (fields[0].length == 1 && fields[0].data[0] == 'A') {
+            failure = addItem(fields, found, detail);
+        } else if (fields[0].length == 1 && fields[0].data[0] == 'R') {
+            failure = removeItem(fields, found, detail);
+        } else if (fields[0].length == 1 && fields[0].data[0] == 'Q') {
+            failure = restock(fields, found, detail);
+        }
+
+        terminalStats.transactions++;
+        appendNumber(results, transactions[i].lineNo);
+        if (failure == nullptr) {
+            terminalStats.succeeded++;
+            results += "|OK|";
+            results += detail;
+        } else {
+            terminalStats.failed++;
+            results += "|FAIL|";
+            results += failure;
+        }
+        results += '\n';
+
+        if (results.size() >= BATCH_OUTPUT_BYTES) {
+            writeResults(results, out);
+        }
+    }
+    writeResults(results, out);
+}
+
+void Batch::writeResults(std::string& results, std::ostream& out) {
+    std::lock_guard<std::mutex> writing(outputLock);
+    out.write(results.data(), results.size());
+    results.clear();
+}
+
+// Coins that are not numbers are passed on as 0, which the engine rejects as an invalid denomination.
+const char* Batch::purchase(const StrRef* fields, unsigned found, std::vector<int>& payments, std::string& detail) {
+    const char* failure = nullptr;
+    int change[NUM_DENOMS];
+
+    if (found != 3) {
+        failure = "expected P|<food id>|<coins>";
+    } else {
+        const char* pos = fields[2].data;
+        const char* end = fields[2].data + fields[2].length;
+        payments.clear();
+        while (pos < end) {
+            const char* comma = static_cast<const char*>(std::memchr(pos, ',', end - pos));
+            int payment = 0;
+            if (!DataFile::parseInt(StrRef(pos, (comma != nullptr ? comma : end) - pos), payment)) {
+                payment = 0;
+            }
+            payments.push_back(payment);
+            pos = comma != nullptr ? comma + 1 : end;
+        }
+        failure = engine.purchase(fields[1].str(), payments.data(), payments.size(), change);
+    }
+    if (failure == nullptr) {
+        appendChange(detail, change);
+    }
+    return failure;
+}
+
+const char* Batch::addItem(const StrRef* fields, unsigned found, std::string& detail) {
+    const char* failure = nullptr;
+    int priceCents = 0;
+
+    if (found != 4) {
+        failure = "expected A|<name>|<description>|<price>";
+    } else if (fields[1].empty() || fields[1].length > NAMELEN) {
+        failure = "invalid name";
+    } else if (fields[2].empty() || fields[2].length > DESCLEN) {
+        failure = "invalid description";
+    } else if (!DataFile::parseCents(fields[3], priceCents)) {
+        failure = "invalid price";
+    } else {
+        failure = engine.addItem(fields[1].str(), fields[2].str(), Money::fromCents(priceCents), detail);
+    }
+    return failure;
+}
+
+const char* Batch::removeItem(const StrRef* fields, unsigned found, std::string& detail) {
+    const char* failure = nullptr;
+
+    if (found != 2) {
+        failure = "expected R|<food id>";
+    } else {
+        detail = fields[1].str();
+        failure = engine.removeItem(detail);
+    }
+    return failure;
+}
+
+const char* Batch::restock(const StrRef* fields, unsigned found, std::string& detail) {
+    const char* failure = nullptr;
+    int level = 0;
+
+    if (found != 3) {
+        failure = "expected Q|<food id>|<units>";
+    } else if (!DataFile::parseInt(fields[2], level)) {
+        failure = "invalid stock level";
+    } else {
+        detail = fields[1].str();
+        failure = engine.restock(detail, level);
+    }
+    return failure;
+}
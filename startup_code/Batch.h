@@ -0,0 +1,72 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <iosfwd>
+#include <vector>
+#include <mutex>
+#include "SessionEngine.h"
+#include "DataFile.h"
+
+// Results are collected in memory and written out once this many bytes are waiting.
+#define BATCH_OUTPUT_BYTES 65536
+
+// What a batch run did and how long the transactions took.
+struct BatchStats {
+    unsigned transactions;
+    unsigned succeeded;
+    unsigned failed;
+    double seconds;
+};
+
+// Runs a file of recorded transactions against the machine without any prompts. Each line is one
+// transaction, with fields separated by '|':
+//
+//   P|<food id>|<coin>,<coin>,...          purchase, paying the coins in order (values in cents)
+//   A|<name>|<description>|<price>         add a food item under the next free ID
+//   R|<food id>                            remove a food item
+//   Q|<food id>|<units>                    restock a food item to the given level
+//
+// Blank lines and lines starting with '#' are skipped. Every transaction produces one result line,
+// "<line>|OK|<detail>" or "<line>|FAIL|<reason>". The detail is the change handed out for a
+// purchase ("200*1,50*1", or "-" for exact payment) and the ID of the item for anything else.
+// Transactions are carried out by a SessionEngine and journaled like those from the menu.
+//
+// With more than one terminal, transactions are dealt out in turn to that many threads that run
+// side by side against the shared menu and float, the way several checkouts would. Each terminal
+// writes its results in blocks of whole lines, so the order of results then differs from the file.
+//
+// A change file of adds, removals, price changes and restocks (see MenuChange) is instead applied
+// as a whole with applyChanges: every change is made, or none of them if any one cannot be.
+class Batch {
+public:
+    explicit Batch(SessionEngine& engine);
+
+    bool run(const std::string& filename, unsigned terminals, std::ostream& out);
+    bool applyChanges(const std::string& filename, std::ostream& out);
+    const BatchStats& getStats() const { return stats; }
+
+private:
+    // One line of the transaction file and where it came from.
+    struct Transaction {
+        StrRef line;
+        unsigned lineNo;
+    };
+
+    SessionEngine& engine;
+    std::vector<Transaction> transactions;
+    std::mutex outputLock;
+    BatchStats stats;
+
+    Batch(const Batch&);
+    Batch& operator=(const Batch&);
+
+    void runTerminal(unsigned first, unsigned step, std::ostream& out, BatchStats& terminalStats);
+    void writeResults(std::string& results, std::ostream& out);
+    const char* purchase(const StrRef* fields, unsigned found, std::vector<int>& payments, std::string& detail);
+    const char* addItem(const StrRef* fields, unsigned found, std::string& detail);
+    const char* removeItem(const StrRef* fields, unsigned found, std::string& detail);
+    const char* restock(const StrRef* fields, unsigned found, std::string& detail);
+};
+
+#endif  // BATCH_H
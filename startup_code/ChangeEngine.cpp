@@ -0,0 +1,97 @@
+#include <climits>
+#include "ChangeEngine.h"
+
+// Amounts above this many gcd units are refused rather than building a huge table.
+#define MAX_CHANGE_UNITS 1000000
+
+// Marks an amount that cannot be made from the coins considered so far.
+#define UNREACHABLE INT_MAX
+
+namespace {
+
+int gcd(int a, int b) {
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+}
+
+// Each denomination is folded into the table with a sliding-window minimum: for amount a the best
+// count is min over k <= count of previous[a - k*value] + k. Grouping amounts by their remainder
+// modulo value turns that into a window of fixed width over one arithmetic sequence, so each
+// denomination costs O(amount) no matter how many coins of it are in stock.
+bool ChangeEngine::solve(const int* values, const int* counts, unsigned numDenoms, long long cents, int* used) {
+    int unit = 0;
+    for (unsigned i = 0; i < numDenoms; i++) {
+        if (values[i] > 0 && counts[i] > 0) {
+            unit = gcd(unit, values[i]);
+        }
+    }
+
+    bool feasible = cents == 0;
+    if (cents > 0 && unit > 0 && cents % unit == 0 && cents / unit <= MAX_CHANGE_UNITS) {
+        int target = static_cast<int>(cents / unit);
+        std::size_t width = static_cast<std::size_t>(target) + 1;
+
+        best.assign(width, UNREACHABLE);
+        best[0] = 0;
+        taken.assign(width * numDenoms, 0);
+        window.resize(width);
+
+        for (unsigned i = 0; i < numDenoms; i++) {
+            int step = values[i] > 0 ? values[i] / unit : 0;
+            int limit = counts[i];
+            if (step > 0 && limit > 0 && step <= target) {
+                previous = best;
+                int* row = &taken[i * width];
+                for (int residue = 0; residue < step; residue++) {
+                    // window holds sequence positions j whose previous[residue + j*step] - j is increasing.
+                    std::size_t front = 0;
+                    std::size_t back = 0;
+                    for (int j = 0; residue + j * step <= target; j++) {
+                        int amount = residue + j * step;
+                        if (previous[amount] != UNREACHABLE) {
+                            while (back > front && previous[residue + window[back - 1] * step] - window[back - 1] >=
+                                                   previous[amount] - j) {
+                                back--;
+                            }
+                            window[back++] = j;
+                        }
+                        while (back > front && window[front] < j - limit) {
+                            front++;
+                        }
+                        if (back > front) {
+                            int from = window[front];
+                            int candidate = previous[residue + from * step] + (j - from);
+                            if (candidate < best[amount]) {
+                                best[amount] = candidate;
+                                row[amount] = j - from;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        feasible = best[target] != UNREACHABLE;
+        if (feasible) {
+            int remaining = target;
+            for (unsigned i = numDenoms; i-- > 0;) {
+                int coins = taken[i * width + remaining];
+                used[i] = coins;
+                if (coins > 0) {
+                    remaining -= coins * (values[i] / unit);
+                }
+            }
+        }
+    } else if (feasible) {
+        for (unsigned i = 0; i < numDenoms; i++) {
+            used[i] = 0;
+        }
+    }
+    return feasible;
+}
\ No newline at end of file
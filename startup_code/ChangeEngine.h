@@ -0,0 +1,25 @@
+#ifndef CHANGEENGINE_H
+#define CHANGEENGINE_H
+
+#include <vector>
+
+// Finds the exact change for an amount that uses the fewest coins, respecting how many of each
+// denomination are actually in stock. Greedy change-making fails on limited stock (with one 50c and
+// three 20c coins it takes the 50c for 60c and gets stuck), so this solves the bounded problem
+// exactly with dynamic programming in O(denominations x amount) time.
+//
+// Scratch tables are kept between calls so repeated solves do not allocate once they have grown.
+class ChangeEngine {
+public:
+    // values and counts describe the float, one entry per denomination. On success used[i] is set to
+    // the number of coins of values[i] to hand out and true is returned; otherwise used is untouched.
+    bool solve(const int* values, const int* counts, unsigned numDenoms, long long cents, int* used);
+
+private:
+    std::vector<int> best;       // fewest coins for each reachable amount, in gcd units
+    std::vector<int> previous;   // the best table before the current denomination was added
+    std::vector<int> taken;      // coins of each denomination used, one row per denomination
+    std::vector<int> window;     // monotone queue for the sliding-window minimum
+};
+
+#endif  // CHANGEENGINE_H
\ No newline at end of file
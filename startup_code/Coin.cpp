@@ -1,141 +1,151 @@
 #include "Coin.h"
 #include "Node.h"
+#include "DataFile.h"
+#include "Stats.h"
+#include "SaveFile.h"
 #include <iostream>
 #include <iomanip>  // For setw and left manipulators 
 
+Coin::Coin() : denom(FIVE_CENTS), count(0), coinFloat(), changed(false) {}
+
 // This method loads coin denominations and their quantities from a file.
-// It reads each line from the specified file, parses the denomination and quantity,
-// and stores them in the denominations map. If a line cannot be parsed, it prints an error message.
+// The file is memory-mapped and each "denomination,quantity" line is parsed in place, then stored
+// in the slot of the coin float for that denomination. Malformed lines and values that are not a
+// denomination are reported with their line number and skipped.
 void Coin::loadDenominations(const std::string& filename) {
-    std::ifstream file(filename);
-    std::string line;
-    int denom, qty;
-    char comma;
-    while (getline(file, line)) {
-        std::istringstream iss(line);
-        if (iss >> denom >> comma >> qty) {
-            denominations[denom] = qty;
-        } else {
-            std::cerr << "Failed to parse line: " << line << std::endl;
+    STAT_TIME(STAT_LOAD_COINS);
+    DataFile file(filename);
+    if (!file.isOpen()) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+    } else {
+        StrRef line;
+        while (file.nextLine(line)) {
+            StrRef fields[2];
+            int denom = 0;
+            int qty = 0;
+            if (!line.empty()) {
+                if (DataFile::split(line, DELIM[0], fields, 2) == 2 &&
+                    DataFile::parseInt(fields[0], denom) && DataFile::parseInt(fields[1], qty) &&
+                    isValidDenomination(denom)) {
+                    setCount(denom, qty);
+                } else {
+                    std::cerr << filename << ':' << file.lineNumber() << ": failed to parse line: " << line.str() << std::endl;
+                }
+            }
         }
+        changed = false;
     }
-    file.close();
 }
 
-// This method checks if a given denomination is valid.
-// It returns true if the denomination exists in the denominations map, otherwise false.
-bool Coin::isValidDenomination(int denomination) {
-    return denominations.find(denomination) != denominations.end();
+// This method checks if a given value in cents is one of the system's denominations.
+bool Coin::isValidDenomination(int denomination) const {
+    return denominationSlot(denomination) != NO_DENOMINATION;
 }
 
-// This method checks if it's possible to make change for a given amount.
-// It converts the amount from dollars to cents and uses a temporary copy of the denominations map.
-// It iterates over the denominations from largest to smallest, subtracting the value of each coin
-// from the required amount until the amount is zero or no more coins are available.
-// It returns true if the exact change can be made, otherwise false.
-bool Coin::canMakeChange(double amount) {
-    int cents_needed = static_cast<int>(amount * 100);
-    std::map<int, int> temp_denoms = denominations;
-    bool can_make_change = false;
+// This method returns how many coins of a denomination are held, or 0 for a value that is not a denomination.
+int Coin::getCount(int denomination) const {
+    int slot = denominationSlot(denomination);
+    return slot != NO_DENOMINATION ? coinFloat.counts[slot] : 0;
+}
 
-    auto it = temp_denoms.rbegin();
-    while (it != temp_denoms.rend()) {
-        int coin_value = it->first;
-        while (cents_needed >= coin_value && it->second > 0) {
-            cents_needed -= coin_value;
-            it->second--;
-        }
-        ++it;
+void Coin::setCount(int denomination, int quantity) {
+    int slot = denominationSlot(denomination);
+    if (slot != NO_DENOMINATION) {
+        coinFloat.counts[slot] = quantity;
+        changed = true;
     }
+}
 
-    if (cents_needed == 0) {
-        can_make_change = true;
+// This method adds coins paid in to the float. counts holds the number of each Denomination.
+void Coin::addCoins(const int* counts) {
+    for (int slot = 0; slot < NUM_DENOMS; slot++) {
+        coinFloat.counts[slot] += counts[slot];
     }
+    changed = true;
+}
 
-    return can_make_change;
+// This method removes coins from the float, but only if every one of them is there.
+// It returns false and leaves the float untouched if any denomination is short.
+bool Coin::takeCoins(const int* counts) {
+    bool available = true;
+    for (int slot = 0; slot < NUM_DENOMS; slot++) {
+        available = available && counts[slot] <= coinFloat.counts[slot];
+    }
+    for (int slot = 0; slot < NUM_DENOMS && available; slot++) {
+        coinFloat.counts[slot] -= counts[slot];
+    }
+    changed = changed || available;
+    return available;
 }
 
-// This method attempts to make change for a given amount using available denominations.
-// It converts the amount from dollars to cents and uses a temporary copy of the denominations map for simulation.
-// It iterates over the denominations from largest to smallest, deducting the value of each coin from the required amount
-// until the amount is zero or no more coins are available. If exact change can be made, it updates the actual denominations.
-// It returns a vector of pairs, each containing a denomination and the number of coins used for that denomination.
-std::vector<std::pair<int, int>> Coin::makeChange(double& amount) {
-    int cents_needed = static_cast<int>(amount * 100);
-    std::vector<std::pair<int, int>> change;
-    std::map<int, int> temp_denoms = denominations;
+// This method checks if it's possible to make change for a given amount from the coins in stock.
+// It asks the change engine for an exact solution, which unlike a greedy pass also finds change
+// that needs smaller coins in place of a larger one that is available.
+// It returns true if the exact change can be made, otherwise false.
+bool Coin::canMakeChange(Money amount) {
+    STAT_TIME(STAT_CAN_MAKE_CHANGE);
+    int used[NUM_DENOMS];
+    return solveChange(amount, used);
+}
 
-    for (auto it = temp_denoms.rbegin(); it != temp_denoms.rend(); ++it) {
-        int coin_value = it->first;
-        int coins_used = 0;
-        bool complete = false;
-        
-        while (cents_needed >= coin_value && it->second > 0 && !complete) {
-            cents_needed -= coin_value;
-            it->second--;
-            coins_used++;
-            if (cents_needed == 0) {
-                complete = true;
-            }
-        }
-        if (coins_used > 0) {
-            change.push_back({coin_value, coins_used});
-        }
-        if (cents_needed == 0) {
-            complete = true;
+// This method makes change for a given amount using the fewest coins currently in stock.
+// If exact change can be made, the coins used are removed from the float.
+// On success used holds the number of coins of each Denomination handed out and true is returned.
+// It returns false, leaving the float untouched, if exact change cannot be made.
+bool Coin::makeChange(Money amount, int* used) {
+    STAT_TIME(STAT_MAKE_CHANGE);
+    bool made = solveChange(amount, used);
+    if (made) {
+        for (int slot = 0; slot < NUM_DENOMS; slot++) {
+            coinFloat.counts[slot] -= used[slot];
         }
+        changed = true;
     }
+    return made;
+}
 
-    if (cents_needed == 0) {
-        for (const auto& ch : change) {
-            denominations[ch.first] -= ch.second;
-        }
-    } else {
-        change.clear();
-    }
-    return change;
+// This method runs the change engine directly over the coin float.
+// On success used holds the number of coins of each denomination to hand out.
+bool Coin::solveChange(Money amount, int* used) {
+    return !amount.isNegative() &&
+           engine.solve(DENOMINATION_VALUES, coinFloat.counts, NUM_DENOMS, amount.asCents(), used);
 }
 
-// This method displays the current balance of all denominations in the system.
-// It iterates over the denominations map and prints each denomination, the quantity, and the total value.
+// This method writes the current balance of all denominations in the system to out.
+// It iterates over the coin float and prints each denomination, the quantity, and the total value.
 // It also calculates and prints the total value of all denominations combined.
-void Coin::displayBalance() const {
-    double totalValue = 0.0;
-   std::cout << "Balance Summary\n";
-    std::cout << "-------------\n";
-    std::cout << "Denom | Quantity | Value\n";
-    std::cout << "--------------------------\n";
+void Coin::displayBalance(std::ostream& out) const {
+    Money totalValue;
+    out << "Balance Summary\n";
+    out << "-------------\n";
+    out << "Denom | Quantity | Value\n";
+    out << "--------------------------\n";
 
-    for (const auto& denom : denominations) {
-        int denomination = denom.first;
-        int quantity = denom.second;
-        double value = denomination * quantity / 100.0;
+    for (int slot = 0; slot < NUM_DENOMS; slot++) {
+        int denomination = DENOMINATION_VALUES[slot];
+        int quantity = coinFloat.counts[slot];
+        Money value = Money::fromCents(denomination) * quantity;
         totalValue += value;
 
         std::ostringstream line;
         line << std::left << std::setw(5) << denomination << " | "
              << std::left << std::setw(8) << quantity << " |$ "
-             << std::right << std::setw(6) << std::fixed << std::setprecision(2) << value;
+             << std::right << std::setw(6) << value;
 
-        std::cout << line.str() << std::endl;
+        out << line.str() << std::endl;
     }
-    std::cout << "---------------------------" << std::endl;
-    std::cout << "                  $ " << std::fixed << std::setprecision(2) << totalValue << "\n";
+    out << "---------------------------" << std::endl;
+    out << "                  $ " << totalValue << "\n";
 }
 
 // This method saves the current denominations and their quantities to a file.
-// It opens the specified file for writing and writes each denomination and its quantity, separated by a delimiter.
-// If the file cannot be opened, it prints an error message.
-void Coin::saveDenominations(const std::string& filename) const {
-    std::ofstream file(filename);
-    bool file_opened = file.is_open();
-
-    if (file_opened) {
-        for (const auto& denom : denominations) {
-            file << denom.first << DELIM << denom.second << std::endl;
-        }
-        file.close();
-    } else {
-        std::cerr << "Error opening file for writing: " << filename << std::endl;
+// Each denomination and its quantity are written on a line of their own, separated by a delimiter.
+// The file is replaced as a whole, never left torn. Returns false if it could not be written.
+bool Coin::saveDenominations(const std::string& filename) const {
+    STAT_TIME(STAT_SAVE_COINS);
+    SaveFile file(filename);
+    for (int slot = 0; slot < NUM_DENOMS; slot++) {
+        file.write(std::to_string(DENOMINATION_VALUES[slot]) + DELIM + std::to_string(coinFloat.counts[slot]) + '\n');
     }
-}
\ No newline at end of file
+    return file.commit();
+}
@@ -5,13 +5,37 @@
 #include <sstream>
 #include <vector>
 #include <algorithm>
-#include <map>
+#include "Money.h"
+#include "ChangeEngine.h"
 
 #define DELIM ","  // delimiter
 
+// The number of denominations of currency available in the system
+#define NUM_DENOMS 10
+
 enum Denomination {
     FIVE_CENTS, TEN_CENTS, TWENTY_CENTS, FIFTY_CENTS, ONE_DOLLAR, 
-    TWO_DOLLARS, FIVE_DOLLARS, TEN_DOLLARS, TWENTY_DOLLARS
+    TWO_DOLLARS, FIVE_DOLLARS, TEN_DOLLARS, TWENTY_DOLLARS, FIFTY_DOLLARS
+};
+
+// The value in cents of each Denomination, indexed by the enum.
+constexpr int DENOMINATION_VALUES[NUM_DENOMS] = { 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000 };
+
+// Marks a value in cents that is not a denomination.
+#define NO_DENOMINATION -1
+
+// Maps a value in cents to its Denomination slot in O(1), or NO_DENOMINATION.
+constexpr int denominationSlot(int cents) {
+    return cents == 5 ? FIVE_CENTS : cents == 10 ? TEN_CENTS : cents == 20 ? TWENTY_CENTS :
+           cents == 50 ? FIFTY_CENTS : cents == 100 ? ONE_DOLLAR : cents == 200 ? TWO_DOLLARS :
+           cents == 500 ? FIVE_DOLLARS : cents == 1000 ? TEN_DOLLARS : cents == 2000 ? TWENTY_DOLLARS :
+           cents == 5000 ? FIFTY_DOLLARS : NO_DENOMINATION;
+}
+
+// The coin float: how many of each denomination the machine holds. A plain array, so taking or
+// restoring a snapshot is a single copy.
+struct CoinFloat {
+    int counts[NUM_DENOMS];
 };
 
 class Coin {
@@ -19,13 +43,29 @@ public:
     enum Denomination denom;
     unsigned count;
 
-    std::map<int, int> denominations;
+    Coin();
+
     void loadDenominations(const std::string& filename);
-    bool isValidDenomination(int denomination);
-    bool canMakeChange(double amount);
-    std::vector<std::pair<int, int>> makeChange(double& amount);
-    void displayBalance() const;
-    void saveDenominations(const std::string& filename) const;
+    bool isValidDenomination(int denomination) const;
+    int getCount(int denomination) const;
+    void setCount(int denomination, int quantity);
+    void addCoins(const int* counts);
+    bool takeCoins(const int* counts);
+    const CoinFloat& getFloat() const { return coinFloat; }
+    void setFloat(const CoinFloat& snapshot) { coinFloat = snapshot; changed = true; }
+    bool canMakeChange(Money amount);
+    bool makeChange(Money amount, int* used);
+    void displayBalance(std::ostream& out) const;
+    bool saveDenominations(const std::string& filename) const;
+    bool isChanged() const { return changed; }
+    void markSaved() { changed = false; }
+
+private:
+    CoinFloat coinFloat;
+    bool changed;  // since the float was loaded or last saved
+    ChangeEngine engine;
+
+    bool solveChange(Money amount, int* used);
 };
 
 #endif  // COIN_H
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include <fstream>
+#include <cstring>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "DataFile.h"
+
+DataFile::DataFile(const std::string& filename)
+    : opened(false), mapping(nullptr), mappedSize(0), start(nullptr), cursor(nullptr), end(nullptr), lineNo(0) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+                mapping = mapped;
+                mappedSize = info.st_size;
+                start = static_cast<const char*>(mapped);
+                cursor = start;
+                end = start + mappedSize;
+                opened = true;
+            }
+        }
+        close(fd);
+
+        if (!opened) {
+            // Empty files and files that cannot be mapped (pipes, some special files) are read normally.
+            std::ifstream file(filename, std::ios::binary);
+            fallback.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            start = fallback.data();
+            cursor = start;
+            end = start + fallback.size();
+            opened = !file.bad();
+        }
+    }
+}
+
+DataFile::~DataFile() {
+    if (mapping != nullptr) {
+        munmap(mapping, mappedSize);
+    }
+}
+
+// This method hands out the next line without its line terminator. Both "\n" and "\r\n" endings are accepted.
+// It returns false once the whole file has been read.
+bool DataFile::nextLine(StrRef& line) {
+    bool found = cursor < end;
+    if (found) {
+        const char* newline = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+        const char* lineEnd = newline != nullptr ? newline : end;
+        line = StrRef(cursor, lineEnd - cursor);
+        if (line.length > 0 && line.data[line.length - 1] == '\r') {
+            line.length--;
+        }
+        cursor = newline != nullptr ? newline + 1 : end;
+        lineNo++;
+    }
+    return found;
+}
+
+// This method splits a line on the delimiter into at most maxFields views, the last of which holds the
+// remainder of the line. It returns the number of fields found.
+unsigned DataFile::split(StrRef line, char delimiter, StrRef* fields, unsigned maxFields) {
+    unsigned found = 0;
+    const char* pos = line.data;
+    const char* lineEnd = line.data + line.length;
+
+    while (found + 1 < maxFields && pos != nullptr) {
+        const char* next = static_cast<const char*>(std::memchr(pos, delimiter, lineEnd - pos));
+        if (next != nullptr) {
+            fields[found++] = StrRef(pos, next - pos);
+            pos = next + 1;
+        } else {
+            fields[found++] = StrRef(pos, lineEnd - pos);
+            pos = nullptr;
+        }
+    }
+    if (pos != nullptr && maxFields > 0) {
+        fields[found++] = StrRef(pos, lineEnd - pos);
+    }
+    return found;
+}
+
+// This method parses a non-negative decimal integer that fills the whole view.
+bool DataFile::parseInt(StrRef text, int& value) {
+    bool valid = !text.empty();
+    long long result = 0;
+
+    for (std::size_t i = 0; i < text.length && valid; i++) {
+        char c = text.data[i];
+        if (c < '0' || c > '9') {
+            valid = false;
+        } else {
+            result = result * 10 + (c - '0');
+            valid = result <= INT_MAX;
+        }
+    }
+    if (valid) {
+        value = static_cast<int>(result);
+    }
+    return valid;
+}
+
+// This method parses a price such as "12.50", "12.5" or "12" straight to a whole number of cents.
+bool DataFile::parseCents(StrRef text, int& cents) {
+    const char* dot = text.empty() ? nullptr : static_cast<const char*>(std::memchr(text.data, '.', text.length));
+    StrRef dollarsText = dot != nullptr ? StrRef(text.data, dot - text.data) : text;
+    StrRef centsText = dot != nullptr ? StrRef(dot + 1, text.data + text.length - dot - 1) : StrRef();
+    int dollars = 0;
+    int fraction = 0;
+
+    bool valid = parseInt(dollarsText, dollars) && dollars <= INT_MAX / 100 - 1;
+    if (valid && dot != nullptr) {
+        valid = centsText.length >= 1 && centsText.length <= 2 && parseInt(centsText, fraction);
+        if (valid && centsText.length == 1) {
+            fraction *= 10;
+        }
+    }
+    if (valid) {
+        cents = dollars * 100 + fraction;
+    }
+    return valid;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef DATAFILE_H
+#define DATAFILE_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// A non-owning view of part of a DataFile buffer. Views stay valid for the lifetime of the file.
+struct StrRef {
+    const char* data;
+    std::size_t length;
+
+    StrRef() : data(nullptr), length(0) {}
+    StrRef(const char* data, std::size_t length) : data(data), length(length) {}
+
+    bool empty() const { return length == 0; }
+    std::string str() const { return std::string(data, length); }
+};
+
+// Read-only, memory-mapped view of a data file that is parsed in place. Lines and fields are handed
+// out as StrRefs into the mapping, so loading a file copies nothing until a value is stored.
+// Files that cannot be mapped are read into a private buffer instead.
+class DataFile {
+public:
+    explicit DataFile(const std::string& filename);
+    ~DataFile();
+
+    bool isOpen() const { return opened; }
+    bool nextLine(StrRef& line);
+    unsigned lineNumber() const { return lineNo; }
+    StrRef contents() const { return StrRef(start, end - start); }
+
+    static unsigned split(StrRef line, char delimiter, StrRef* fields, unsigned maxFields);
+    static bool parseInt(StrRef text, int& value);
+    static bool parseCents(StrRef text, int& cents);
+
+private:
+    bool opened;
+    void* mapping;
+    std::size_t mappedSize;
+    std::vector<char> fallback;
+    const char* start;
+    const char* cursor;
+    const char* end;
+    unsigned lineNo;
+
+    DataFile(const DataFile&);
+    DataFile& operator=(const DataFile&);
+};
+
+#endif  // DATAFILE_H
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include <atomic>
+#include <thread>
+#include "Epoch.h"
+
+namespace {
+
+// The epoch of a reader slot whose thread is not reading. Epochs start at 1.
+#define IDLE_EPOCH 0
+
+// One reader's slot, on a cache line of its own so that readers do not slow each other down.
+struct alignas(64) ReaderSlot {
+    std::atomic<unsigned long long> epoch;
+    std::atomic<bool> taken;
+};
+
+std::atomic<unsigned long long> currentEpoch(1);
+ReaderSlot slots[MAX_EPOCH_READERS];
+
+// The calling thread's slot, taken on its first read, and how deeply its guards are nested.
+struct LocalReader {
+    ReaderSlot* slot;
+    unsigned depth;
+
+    LocalReader() : slot(nullptr), depth(0) {}
+    ~LocalReader() {
+        if (slot != nullptr) {
+            slot->taken.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local LocalReader local;
+
+ReaderSlot* takeSlot() {
+    ReaderSlot* found = nullptr;
+    while (found == nullptr) {
+        for (unsigned i = 0; i < MAX_EPOCH_READERS && found == nullptr; i++) {
+            bool expected = false;
+            if (!slots[i].taken.load(std::memory_order_relaxed) &&
+                slots[i].taken.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                found = &slots[i];
+            }
+        }
+        if (found == nullptr) {
+            std::this_thread::yield();
+        }
+    }
+    return found;
+}
+
+}
+
+// A reader records the epoch it starts in before it loads any pointer to a shared structure. A
+// structure replaced before that load was tagged with an earlier epoch; one replaced after it gets
+// this epoch or a later one, which keeps it alive until the reader is done. A writer that scans the
+// slots before the store lands is safe too: the reader's load then comes after the writer
+// published, so the reader only ever sees the replacement.
+EpochGuard::EpochGuard() {
+    if (local.depth++ == 0) {
+        if (local.slot == nullptr) {
+            local.slot = takeSlot();
+        }
+        local.slot->epoch.store(currentEpoch.load());
+    }
+}
+
+EpochGuard::~EpochGuard() {
+    if (--local.depth == 0) {
+        local.slot->epoch.store(IDLE_EPOCH, std::memory_order_release);
+    }
+}
+
+// Starts a new epoch and returns the one that ended, the tag for whatever the caller has just
+// replaced.
+unsigned long long EpochGuard::advance() {
+    return currentEpoch.fetch_add(1);
+}
+
+// Returns the earliest epoch a reader may still be reading in. Anything tagged before it is free.
+unsigned long long EpochGuard::oldestActive() {
+    unsigned long long oldest = currentEpoch.load();
+    for (unsigned i = 0; i < MAX_EPOCH_READERS; i++) {
+        unsigned long long epoch = slots[i].epoch.load();
+        if (epoch != IDLE_EPOCH && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    return oldest;
+}
@@ -0,0 +1,29 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+// Threads that can be reading at once. A thread takes a reader slot the first time it reads and
+// gives it back when it exits; while every slot is taken, a new reader waits for one.
+#define MAX_EPOCH_READERS 128
+
+// Epoch-based reclamation, for structures that writers replace instead of changing in place so
+// that readers need no lock. A reader holds an EpochGuard for as long as it looks at such a
+// structure. A writer publishes the replacement first and only then calls advance, tagging what it
+// replaced with the epoch returned. Once oldestActive is past that tag, no reader can still be
+// looking at it and it can be freed.
+//
+// Starting and ending a read costs an atomic load and a store to the thread's own slot; readers
+// never wait for writers, and writers never wait for readers. Guards may be nested.
+class EpochGuard {
+public:
+    EpochGuard();
+    ~EpochGuard();
+
+    static unsigned long long advance();
+    static unsigned long long oldestActive();
+
+private:
+    EpochGuard(const EpochGuard&);
+    EpochGuard& operator=(const EpochGuard&);
+};
+
+#endif  // EPOCH_H
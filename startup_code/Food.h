@@ -9,17 +9,17 @@ private:
     std::string id;
     std::string name;
     std::string description;
-    double price;
+    Money price;
     int onHand;
 
 public:
-    Food(std::string id, std::string name, std::string description, double price, unsigned onHand)
-        : FoodItem(id, name, description, Price::parsePrice(price), onHand) {}
+    Food(const std::string& id, const std::string& name, const std::string& description, Money price, unsigned onHand)
+        : FoodItem(id, name, description, price, onHand) {}
 
     std::string getID() const { return id; }
     std::string getName() const { return name; }
     std::string getDescription() const { return description; }
-    double getPrice() const { return price; }
+    Money getPrice() const { return price; }
     int getOnHand() const { return onHand; }
 
     bool operator<(const Food &other) const {
@@ -0,0 +1,141 @@
+#include <iostream>
+#include <vector>
+#include <cstdio>
+#include "FoodIdAllocator.h"
+#include "DataFile.h"
+#include "SaveFile.h"
+
+FoodIdAllocator::FoodIdAllocator(bool reuse) : reuse(reuse), highWaterMark(0) {}
+
+// The file holds the high-water mark on a line of its own. A missing file is not an error, as
+// there is none until the first save; the mark then comes from the menu alone.
+bool FoodIdAllocator::load(const std::string& filename) {
+    DataFile file(filename);
+    StrRef line;
+    int mark = 0;
+    bool loaded = file.isOpen() && file.nextLine(line) && DataFile::parseInt(line, mark) && mark >= 0;
+
+    if (file.isOpen() && !loaded) {
+        std::cerr << filename << ": expected the highest food ID number handed out" << std::endl;
+    } else if (loaded && static_cast<unsigned>(mark) > highWaterMark) {
+        highWaterMark = mark;
+    }
+    return loaded;
+}
+
+bool FoodIdAllocator::save(const std::string& filename) const {
+    SaveFile file(filename);
+    file.write(std::to_string(highWaterMark) + '\n');
+    return file.commit();
+}
+
+// Raises the high-water mark to cover an ID that is or was in use, such as one added by a
+// journal record that a later record removed.
+void FoodIdAllocator::observe(const std::string& itemId) {
+    unsigned number = 0;
+    if (parse(itemId.c_str(), number) && number > highWaterMark) {
+        highWaterMark = number;
+    } else if (number < isFreed.size() && isFreed[number]) {
+        isFreed[number] = false;
+        dropTaken();
+    }
+}
+
+// This method raises the high-water mark to cover every ID on the menu and, with reuse turned on,
+// collects the numbers below it that are not on the menu. Call it once the menu is fully loaded.
+// It takes time in proportion to the size of the menu plus the high-water mark.
+void FoodIdAllocator::rebuild(const LinkedList& list) {
+    MenuReader menu(list);
+    for (const FoodItem* item : *menu) {
+        observe(item->id);
+    }
+
+    freed.clear();
+    isFreed.clear();
+    if (reuse) {
+        unsigned number = 0;
+        isFreed.assign(highWaterMark + 1, true);
+        isFreed[0] = false;
+        for (const FoodItem* item : *menu) {
+            if (parse(item->id, number)) {
+                isFreed[number] = false;
+            }
+        }
+        for (number = 1; number <= highWaterMark; number++) {
+            if (isFreed[number]) {
+                freed.push_back(number);
+            }
+        }
+    }
+}
+
+// This method sets itemId to the ID that allocate would hand out next, without taking it.
+// Returns false if every ID is taken.
+bool FoodIdAllocator::peek(std::string& itemId) const {
+    bool available = !freed.empty() || highWaterMark < MAX_FOOD_NUMBER;
+    if (available) {
+        itemId = format(!freed.empty() ? freed.front() : highWaterMark + 1);
+    }
+    return available;
+}
+
+// Returns false if every ID is taken.
+bool FoodIdAllocator::allocate(std::string& itemId) {
+    bool available = peek(itemId);
+    if (available && !freed.empty()) {
+        isFreed[freed.front()] = false;
+        freed.pop_front();
+        dropTaken();
+    } else if (available) {
+        highWaterMark++;
+    }
+    return available;
+}
+
+// This method takes back the ID of a removed item, to be handed out again if reuse is turned on.
+// A number already waiting to be handed out is not queued again.
+void FoodIdAllocator::release(const std::string& itemId) {
+    unsigned number = 0;
+    if (reuse && parse(itemId.c_str(), number) && number <= highWaterMark) {
+        if (number >= isFreed.size()) {
+            isFreed.resize(highWaterMark + 1, false);
+        }
+        if (!isFreed[number]) {
+            isFreed[number] = true;
+            freed.push_back(number);
+        }
+    }
+}
+
+// Drops numbers taken since they were queued off the front of the queue, so that the front is
+// always one that may be handed out.
+void FoodIdAllocator::dropTaken() {
+    while (!freed.empty() && !isFreed[freed.front()]) {
+        freed.pop_front();
+    }
+}
+
+std::string FoodIdAllocator::format(unsigned number) {
+    char itemId[16];
+    std::snprintf(itemId, sizeof(itemId), "F%04u", number);
+    return itemId;
+}
+
+// This method returns whether itemId has the form format writes, and if so sets number from it.
+bool FoodIdAllocator::parse(const char* itemId, unsigned& number) {
+    unsigned value = 0;
+    unsigned digits = 0;
+    bool valid = itemId[0] == 'F';
+
+    while (valid && itemId[digits + 1] != '\0') {
+        char digit = itemId[digits + 1];
+        valid = digit >= '0' && digit <= '9' && digits < IDLEN - 1;
+        value = value * 10 + (digit - '0');
+        digits++;
+    }
+    valid = valid && value >= 1 && value <= MAX_FOOD_NUMBER && format(value) == itemId;
+    if (valid) {
+        number = value;
+    }
+    return valid;
+}
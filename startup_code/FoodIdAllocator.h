@@ -0,0 +1,50 @@
+#ifndef FOODIDALLOCATOR_H
+#define FOODIDALLOCATOR_H
+
+#include <string>
+#include <deque>
+#include <vector>
+#include "LinkedList.h"
+
+// The largest number an "F" ID can carry within IDLEN characters.
+#define MAX_FOOD_NUMBER 9999999
+
+// Hands out IDs for new food items: 'F' followed by a number, zero-padded to four digits as in the
+// original menus ("F0042") and written out in full from F10000 up. IDs of equal length sort in
+// numeric order and shorter IDs sort first, so the menu stays in numeric order past F9999.
+//
+// The highest number ever handed out, the high-water mark, is saved to its own file so that the
+// IDs of removed items are not handed out again after a restart. When reuse is turned on, the
+// numbers of removed items below the mark are handed out again instead, oldest removal first. A
+// number is queued once however often it is released, and an ID that comes back onto the menu,
+// as through a change that adds it, is observed and so taken off the queue. IDs that do not have
+// the form above are left alone. Every operation is amortized O(1) except rebuild.
+//
+// Not thread-safe: callers that share one allocator between threads must serialize calls.
+class FoodIdAllocator {
+public:
+    explicit FoodIdAllocator(bool reuse);
+
+    bool load(const std::string& filename);
+    bool save(const std::string& filename) const;
+    void observe(const std::string& itemId);
+    void rebuild(const LinkedList& menu);
+
+    bool peek(std::string& itemId) const;
+    bool allocate(std::string& itemId);
+    void release(const std::string& itemId);
+    unsigned getHighWaterMark() const { return highWaterMark; }
+
+    static std::string format(unsigned number);
+    static bool parse(const char* itemId, unsigned& number);
+
+private:
+    bool reuse;
+    unsigned highWaterMark;
+    std::deque<unsigned> freed;  // may hold numbers since taken, which are skipped
+    std::vector<bool> isFreed;   // indexed by number: whether it may be handed out again
+
+    void dropTaken();
+};
+
+#endif  // FOODIDALLOCATOR_H
@@ -0,0 +1,107 @@
+#include "ItemIndex.h"
+
+// The table starts with this many slots and doubles whenever it is more than 70% full.
+#define INITIAL_INDEX_SLOTS 16
+
+ItemIndex::ItemIndex() : slots(INITIAL_INDEX_SLOTS, Slot{0, nullptr}), used(0) {}
+
+// This method scrambles a packed ID so that sequential IDs spread across the whole table.
+std::size_t ItemIndex::hashKey(FoodKey key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return static_cast<std::size_t>(key);
+}
+
+// This method returns the slot holding the given key, or the empty slot where it would be inserted.
+std::size_t ItemIndex::findSlot(FoodKey key) const {
+    std::size_t mask = slots.size() - 1;
+    std::size_t pos = hashKey(key) & mask;
+    bool found = false;
+
+    while (slots[pos].node != nullptr && !found) {
+        if (slots[pos].key == key) {
+            found = true;
+        } else {
+            pos = (pos + 1) & mask;
+        }
+    }
+    return pos;
+}
+
+Node* ItemIndex::find(FoodKey key) const {
+    return slots[findSlot(key)].node;
+}
+
+// This method adds a node to the index, replacing any existing node with the same ID.
+void ItemIndex::insert(Node* node) {
+    if ((used + 1) * 10 > slots.size() * 7) {
+        grow();
+    }
+    std::size_t pos = findSlot(node->data->key);
+    if (slots[pos].node == nullptr) {
+        used++;
+    }
+    slots[pos].key = node->data->key;
+    slots[pos].node = node;
+}
+
+// This method removes a key from the index and returns the node it mapped to, or nullptr.
+// Entries after the removed slot are shifted back so every probe chain stays unbroken.
+Node* ItemIndex::erase(FoodKey key) {
+    std::size_t mask = slots.size() - 1;
+    std::size_t hole = findSlot(key);
+    Node* removed = slots[hole].node;
+
+    if (removed != nullptr) {
+        std::size_t pos = (hole + 1) & mask;
+        while (slots[pos].node != nullptr) {
+            std::size_t home = hashKey(slots[pos].key) & mask;
+            // Move the entry back if its home slot is not between the hole and its current position.
+            if (((pos - home) & mask) >= ((pos - hole) & mask)) {
+                slots[hole] = slots[pos];
+                hole = pos;
+            }
+            pos = (pos + 1) & mask;
+        }
+        slots[hole].node = nullptr;
+        used--;
+    }
+    return removed;
+}
+
+void ItemIndex::clear() {
+    slots.assign(INITIAL_INDEX_SLOTS, Slot{0, nullptr});
+    used = 0;
+}
+
+// This method grows the table up front so that count entries fit without rehashing.
+void ItemIndex::reserve(unsigned count) {
+    std::size_t wanted = slots.size();
+    while (static_cast<std::size_t>(count) * 10 > wanted * 7) {
+        wanted *= 2;
+    }
+    if (wanted > slots.size()) {
+        rehash(wanted);
+    }
+}
+
+void ItemIndex::grow() {
+    rehash(slots.size() * 2);
+}
+
+void ItemIndex::rehash(std::size_t slotCount) {
+    std::vector<Slot> old(slotCount, Slot{0, nullptr});
+    old.swap(slots);
+    std::size_t mask = slots.size() - 1;
+
+    for (const Slot& slot : old) {
+        if (slot.node != nullptr) {
+            std::size_t pos = hashKey(slot.key) & mask;
+            while (slots[pos].node != nullptr) {
+                pos = (pos + 1) & mask;
+            }
+            slots[pos] = slot;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef ITEMINDEX_H
+#define ITEMINDEX_H
+
+#include <vector>
+#include <cstddef>
+#include "Node.h"
+
+// Open-addressing hash index from packed food ID to the list node holding it.
+// Uses linear probing with backward-shift deletion, so there are no tombstones
+// and lookups stay O(1) regardless of how many items have been removed.
+class ItemIndex {
+public:
+    ItemIndex();
+
+    Node* find(FoodKey key) const;
+    void prefetch(FoodKey key) const { __builtin_prefetch(&slots[hashKey(key) & (slots.size() - 1)], 1); }
+    void insert(Node* node);
+    Node* erase(FoodKey key);
+    void clear();
+    void reserve(unsigned count);
+    unsigned size() const { return used; }
+
+private:
+    struct Slot {
+        FoodKey key;
+        Node* node;
+    };
+
+    std::vector<Slot> slots;
+    unsigned used;
+
+    static std::size_t hashKey(FoodKey key);
+    std::size_t findSlot(FoodKey key) const;
+    void grow();
+    void rehash(std::size_t slotCount);
+};
+
+#endif  // ITEMINDEX_H
\ No newline at end of file
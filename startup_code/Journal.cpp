@@ -0,0 +1,387 @@
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Journal.h"
+#include "DataFile.h"
+#include "Stats.h"
+
+namespace {
+
+// FNV-1a over a record's text, written as eight hex digits at the end of the line.
+unsigned recordChecksum(const char* text, std::size_t length) {
+    unsigned hash = 2166136261u;
+    for (std::size_t i = 0; i < length; i++) {
+        hash ^= static_cast<unsigned char>(text[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Writes a coin list such as "200*1,50*1" for the Denominations with a count, and returns its
+// length. out must have room for COIN_LIST_BYTES.
+int formatCoins(char* out, const int* counts, bool largestFirst) {
+    int length = 0;
+    for (int i = 0; i < NUM_DENOMS; i++) {
+        int slot = largestFirst ? NUM_DENOMS - 1 - i : i;
+        if (counts[slot] > 0) {
+            length += std::snprintf(out + length, COIN_LIST_BYTES - length, "%s%d*%d", length > 0 ? "," : "",
+                                    DENOMINATION_VALUES[slot], counts[slot]);
+        }
+    }
+    return length;
+}
+
+// Returns whether a journal line carries the checksum of its text, and sets payload to the text.
+bool checkRecord(StrRef line, StrRef& payload) {
+    const char* mark = line.length >= 10 ? line.data + line.length - 10 : nullptr;
+    payload = StrRef(line.data, mark != nullptr ? mark - line.data : 0);
+    return mark != nullptr && mark[0] == '|' && mark[1] == '#' &&
+           std::strtoul(std::string(mark + 2, 8).c_str(), nullptr, 16) == recordChecksum(payload.data, payload.length);
+}
+
+// Parses a coin list such as "200*1,50*1" and adds sign times each count to the float.
+bool applyCoins(StrRef list, int sign, Coin& coins) {
+    bool valid = true;
+    const char* pos = list.data;
+    const char* end = list.data + list.length;
+
+    while (pos < end && valid) {
+        const char* comma = static_cast<const char*>(std::memchr(pos, ',', end - pos));
+        StrRef entry(pos, (comma != nullptr ? comma : end) - pos);
+        StrRef parts[2];
+        int denomination = 0;
+        int quantity = 0;
+        valid = DataFile::split(entry, '*', parts, 2) == 2 && DataFile::parseInt(parts[0], denomination) &&
+                DataFile::parseInt(parts[1], quantity) && coins.isValidDenomination(denomination);
+        if (valid) {
+            coins.setCount(denomination, coins.getCount(denomination) + sign * quantity);
+        }
+        pos = comma != nullptr ? comma + 1 : end;
+    }
+    return valid;
+}
+
+// Reads the records of a set of changes journaled by recordChanges, leaving line at the last of
+// them, and makes the changes all together. Returns false, changing nothing, if any record is
+// missing or damaged, as when a crash cut the set short.
+bool replayChanges(DataFile& file, unsigned records, StrRef& line, LinkedList& menu, FoodIdAllocator& ids) {
+    std::vector<MenuChange> changes;
+    std::vector<const char*> failures;
+    StrRef payload;
+    bool intact = true;
+
+    changes.reserve(records);
+    while (intact && changes.size() < records) {
+        intact = file.nextLine(line) && checkRecord(line, payload) && MenuChange::parse(payload, changes) == nullptr;
+    }
+    if (intact) {
+        for (const MenuChange& change : changes) {
+            if (change.type == MENU_ADD) {
+                ids.observe(change.item.id);
+            }
+        }
+        menu.applyChanges(changes, failures);
+    }
+    return intact;
+}
+
+}
+
+Journal::Journal() : fd(-1), durability(JOURNAL_GROUP), unsynced(0), closing(false) {}
+
+Journal::~Journal() {
+    {
+        std::lock_guard<std::mutex> locked(lock);
+        closing = true;
+    }
+    waiting.notify_one();
+    if (flusher.joinable()) {
+        flusher.join();
+    }
+    sync();
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool Journal::open(const std::string& filename, JournalDurability level) {
+    path = filename;
+    durability = level;
+    fd = ::open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    buffer.reserve(JOURNAL_BUFFER_BYTES + SALE_RECORD_BYTES);
+    if (fd < 0) {
+        std::cerr << "Error opening journal " << filename << ": " << std::strerror(errno) << std::endl;
+    } else if (durability == JOURNAL_GROUP) {
+        flusher = std::thread(&Journal::flushOnDeadline, this);
+    }
+    return fd >= 0;
+}
+
+bool Journal::parseDurability(const std::string& text, JournalDurability& level) {
+    bool valid = true;
+    if (text == "buffered") {
+        level = JOURNAL_BUFFERED;
+    } else if (text == "group") {
+        level = JOURNAL_GROUP;
+    } else if (text == "sync") {
+        level = JOURNAL_SYNC;
+    } else {
+        valid = false;
+    }
+    return valid;
+}
+
+// Records a completed sale. coinsIn and change hold the number of each Denomination the customer
+// paid in and was handed back. The record is formatted in place, so a sale allocates nothing.
+// The price recorded is the one charged, which is not the item's own if it was repriced mid-sale.
+void Journal::recordSale(const FoodItem& item, Money price, const int* coinsIn, const int* change) {
+    if (fd >= 0) {
+        char line[SALE_RECORD_BYTES];
+        int length = std::snprintf(line, sizeof(line), "S|%s|%lld|", item.id, price.asCents());
+        length += formatCoins(line + length, coinsIn, false);
+        line[length++] = '|';
+        length += formatCoins(line + length, change, true);
+        append(line, length);
+    }
+}
+
+void Journal::recordAdd(const FoodItem& item) {
+    std::ostringstream line;
+    line << "A|" << item.id << '|' << item.name << '|' << item.description << '|' << item.price.asCents();
+    std::string record = line.str();
+    append(record);
+}
+
+void Journal::recordRemove(const std::string& itemId) {
+    std::string record = "R|" + itemId;
+    append(record);
+}
+
+void Journal::recordRestock(const std::string& itemId, unsigned level) {
+    std::string record = "Q|" + itemId + '|' + std::to_string(level);
+    append(record);
+}
+
+// Records changes made together by LinkedList::applyChanges: "M|<count>", then each change as a
+// line of a change file. Replay makes them only if every one of them reached the journal.
+void Journal::recordChanges(const std::vector<MenuChange>& changes) {
+    if (fd >= 0) {
+        std::string record = "M|" + std::to_string(changes.size());
+        append(record);
+        for (const MenuChange& change : changes) {
+            record.clear();
+            change.format(record);
+            append(record);
+        }
+    }
+}
+
+void Journal::append(const std::string& record) {
+    append(record.data(), record.size());
+}
+
+// Adds the record with its checksum and newline to the buffer, then writes or syncs according to
+// the durability level.
+void Journal::append(const char* record, std::size_t length) {
+    std::lock_guard<std::mutex> locked(lock);
+    appendLocked(record, length);
+}
+
+void Journal::appendLocked(const char* record, std::size_t length) {
+    if (fd >= 0) {
+        char checksum[16];
+        int checksumLength = std::snprintf(checksum, sizeof(checksum), "|#%08x\n", recordChecksum(record, length));
+        buffer.append(record, length);
+        buffer.append(checksum, checksumLength);
+
+        if (unsynced == 0) {
+            oldestUnsynced = std::chrono::steady_clock::now();
+            waiting.notify_one();
+        }
+        unsynced++;
+
+        if (durability == JOURNAL_SYNC) {
+            syncLocked();
+        } else if (durability == JOURNAL_GROUP) {
+            writeBuffer();
+            std::chrono::milliseconds age = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - oldestUnsynced);
+            if (unsynced >= JOURNAL_GROUP_SIZE || age.count() >= JOURNAL_GROUP_INTERVAL_MS) {
+                syncLocked();
+            }
+        } else if (buffer.size() >= JOURNAL_BUFFER_BYTES) {
+            writeBuffer();
+        }
+    }
+}
+
+// Returns false if anything could not be written.
+bool Journal::writeBuffer() {
+    std::size_t written = 0;
+    bool failed = false;
+    while (written < buffer.size() && !failed) {
+        ssize_t result = write(fd, buffer.data() + written, buffer.size() - written);
+        if (result > 0) {
+            written += result;
+        } else if (result < 0 && errno != EINTR) {
+            std::cerr << "Error writing journal " << path << ": " << std::strerror(errno) << std::endl;
+            failed = true;
+        }
+    }
+    buffer.erase(0, written);
+    return !failed;
+}
+
+// This method writes out anything buffered and forces the journal to stable storage.
+void Journal::sync() {
+    std::lock_guard<std::mutex> locked(lock);
+    syncLocked();
+}
+
+void Journal::syncLocked() {
+    if (fd >= 0 && (unsynced > 0 || !buffer.empty())) {
+        writeBuffer();
+        fdatasync(fd);
+        unsynced = 0;
+    }
+}
+
+// With JOURNAL_GROUP, this runs on the flusher thread until the journal closes. It syncs the journal
+// once the oldest unsynced record is JOURNAL_GROUP_INTERVAL_MS old, unless a group of records has
+// synced it first.
+void Journal::flushOnDeadline() {
+    std::unique_lock<std::mutex> locked(lock);
+    while (!closing) {
+        if (unsynced == 0) {
+            waiting.wait(locked);
+        } else {
+            std::chrono::steady_clock::time_point deadline =
+                oldestUnsynced + std::chrono::milliseconds(JOURNAL_GROUP_INTERVAL_MS);
+            if (std::chrono::steady_clock::now() >= deadline) {
+                syncLocked();
+            } else {
+                waiting.wait_until(locked, deadline);
+            }
+        }
+    }
+}
+
+// This method records that every change journaled so far is part of a save that has been written
+// out in full, and forces the record to disk whatever the durability level. Once this returns true
+// the save stands even if the process dies before its files are in place. Returns false if the
+// record could not be written.
+bool Journal::commitSave() {
+    bool committed = fd >= 0;
+    if (committed) {
+        std::lock_guard<std::mutex> locked(lock);
+        appendLocked("K", 1);
+        committed = writeBuffer() && fdatasync(fd) == 0;
+        unsynced = 0;
+    }
+    return committed;
+}
+
+// This method returns whether the last intact record of a journal is a commit record, meaning a
+// save of everything before it was committed but may not have been put in place.
+bool Journal::hasCommit(const std::string& filename) {
+    DataFile file(filename);
+    bool committed = false;
+    bool intact = true;
+    StrRef line;
+    while (file.isOpen() && intact && file.nextLine(line)) {
+        StrRef payload;
+        intact = checkRecord(line, payload);
+        if (intact) {
+            committed = payload.length == 1 && payload.data[0] == 'K';
+        }
+    }
+    return committed;
+}
+
+// This method empties the journal once its changes are part of a full save.
+void Journal::checkpoint() {
+    std::lock_guard<std::mutex> locked(lock);
+    if (fd >= 0) {
+        buffer.clear();
+        unsynced = 0;
+        if (ftruncate(fd, 0) != 0 || fdatasync(fd) != 0) {
+            std::cerr << "Error truncating journal " << path << ": " << std::strerror(errno) << std::endl;
+        }
+    }
+}
+
+// This method applies every intact record in the journal to the loaded state and returns how many
+// were applied. Replay stops at the first record with a bad checksum, which is normally the last
+// line of a journal torn by a crash. The damaged tail is cut off so new records follow intact ones.
+unsigned Journal::replay(const std::string& filename, LinkedList& menu, Coin& coins, FoodIdAllocator& ids) {
+    STAT_TIME(STAT_REPLAY_JOURNAL);
+    DataFile file(filename);
+    unsigned applied = 0;
+    bool intact = true;
+    off_t intactBytes = 0;
+    StrRef line;
+
+    while (file.isOpen() && intact && file.nextLine(line)) {
+        StrRef payload;
+        intact = checkRecord(line, payload);
+        StrRef fields[6];
+        unsigned found = DataFile::split(payload, '|', fields, 6);
+        unsigned expected = 0;
+
+        if (intact && fields[0].length == 1) {
+            char type = fields[0].data[0];
+            int number = 0;
+            Node* itemNode = nullptr;
+            if (type == 'S' && found == 5) {
+                intact = applyCoins(fields[3], 1, coins) && applyCoins(fields[4], -1, coins);
+                itemNode = menu.findItem(fields[1].str());
+                if (intact && itemNode != nullptr && itemNode->data->on_hand.reserve()) {
+                    itemNode->data->on_hand.commit();
+                    menu.markChanged(*itemNode->data);
+                }
+                expected = 5;
+            } else if (type == 'A' && found == 5 && DataFile::parseInt(fields[4], number)) {
+                std::string description = fields[3].str();
+                ids.observe(fields[1].str());
+                menu.insertNode(FoodItem(fields[1].data, fields[1].length, fields[2].data, fields[2].length,
+                                         description.c_str(), Money::fromCents(number), DEFAULT_FOOD_STOCK_LEVEL));
+                expected = 5;
+            } else if (type == 'R' && found == 2) {
+                menu.eraseItem(fields[1].str());
+                expected = 2;
+            } else if (type == 'Q' && found == 3 && DataFile::parseInt(fields[2], number)) {
+                itemNode = menu.findItem(fields[1].str());
+                if (itemNode != nullptr) {
+                    itemNode->data->on_hand.set(number);
+                    menu.markChanged(*itemNode->data);
+                }
+                expected = 3;
+            } else if (type == 'M' && found == 2 && DataFile::parseInt(fields[1], number)) {
+                intact = replayChanges(file, number, line, menu, ids);
+                applied += intact ? number : 0;
+                expected = 2;
+            } else if (type == 'K' && found == 1) {
+                // Only ever the last record, and recovered before anything is loaded; see hasCommit.
+                expected = 1;
+            }
+        }
+        if (intact && expected == 0) {
+            intact = false;
+        }
+        if (intact) {
+            applied++;
+            intactBytes = line.data + line.length + 1 - file.contents().data;
+        } else {
+            std::cerr << filename << ':' << file.lineNumber() << ": damaged journal record, ignoring it and anything after it" << std::endl;
+        }
+    }
+    if (!intact && truncate(filename.c_str(), intactBytes) != 0) {
+        std::cerr << "Error truncating journal " << filename << ": " << std::strerror(errno) << std::endl;
+    }
+    return applied;
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "LinkedList.h"
+#include "Coin.h"
+#include "FoodIdAllocator.h"
+
+// With JOURNAL_GROUP, the journal is forced to disk after this many records or once the oldest
+// unsynced record is this old, whichever comes first. The age is watched by a thread of the
+// journal's own, so the last records before the machine goes idle are synced on time too.
+#define JOURNAL_GROUP_SIZE 32
+#define JOURNAL_GROUP_INTERVAL_MS 200
+
+// Records held in memory with JOURNAL_BUFFERED before they are written to the file.
+#define JOURNAL_BUFFER_BYTES 65536
+
+// Room for the coin list of a sale record, such as "200*1,50*1", with a count for every
+// Denomination, and for a whole sale record.
+#define COIN_LIST_BYTES (NUM_DENOMS * 24)
+#define SALE_RECORD_BYTES (64 + 2 * COIN_LIST_BYTES)
+
+// How hard the journal tries to keep a record once it has been appended.
+enum JournalDurability {
+    JOURNAL_BUFFERED,  // kept in memory and written in large batches; lost if the process dies
+    JOURNAL_GROUP,     // written at once, so it survives the process dying; fsynced in groups
+    JOURNAL_SYNC       // written and fsynced before append returns; survives power loss
+};
+
+// Append-only log of every change made to the machine since the last full save: sales (with the
+// coins paid in and the change handed out), admin edits and restocks. Each record is one line ending in a
+// checksum, so a line torn by a crash is detected and ignored on replay. Replaying the journal
+// over the last saved state rebuilds everything that happened after it. A save ends the journal
+// with a commit record once its files are written, and empties it once they are in place.
+// Thread-safe: records from several threads are appended one at a time.
+class Journal {
+public:
+    Journal();
+    ~Journal();
+
+    bool open(const std::string& filename, JournalDurability durability);
+    bool isOpen() const { return fd >= 0; }
+
+    void recordSale(const FoodItem& item, Money price, const int* coinsIn, const int* change);
+    void recordAdd(const FoodItem& item);
+    void recordRemove(const std::string& itemId);
+    void recordRestock(const std::string& itemId, unsigned level);
+    void recordChanges(const std::vector<MenuChange>& changes);
+
+    void sync();
+    bool commitSave();
+    void checkpoint();
+
+    static bool hasCommit(const std::string& filename);
+    static unsigned replay(const std::string& filename, LinkedList& menu, Coin& coins, FoodIdAllocator& ids);
+    static bool parseDurability(const std::string& text, JournalDurability& durability);
+
+private:
+    int fd;
+    std::string path;
+    JournalDurability durability;
+    std::string buffer;
+    unsigned unsynced;
+    std::chrono::steady_clock::time_point oldestUnsynced;
+    std::mutex lock;
+    std::condition_variable waiting;  // for the first unsynced record, or for closing
+    std::thread flusher;
+    bool closing;
+
+    Journal(const Journal&);
+    Journal& operator=(const Journal&);
+
+    void append(const std::string& record);
+    void append(const char* record, std::size_t length);
+    void appendLocked(const char* record, std::size_t length);
+    bool writeBuffer();
+    void syncLocked();
+    void flushOnDeadline();
+};
+
+#endif  // JOURNAL_H
\ No newline at end of file
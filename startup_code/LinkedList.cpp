@@ -1,160 +1,832 @@
 #include <iostream>
-#include <sstream>
 #include <fstream>
-#include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <unordered_map>
 #include "LinkedList.h"
+#include "Snapshot.h"
+#include "Stats.h"
 
-LinkedList::LinkedList() : head(nullptr), count(0) {}
+namespace {
 
-LinkedList::~LinkedList() {
-    Node* current = head;
-    while (current != nullptr) {
-        Node* next = current->next;
-        delete current;
-        current = next;
+const char MENU_TITLE[] =
+    "Food Menu\n"
+    "---------\n";
+const char MENU_COLUMNS[] = " | Name                                     | Price\n";
+const char MENU_RULE[] = "------------------------------------------------------------------";
+
+// Copies text to pos, padded with spaces to at least width characters, and returns the end.
+char* appendPadded(char* pos, const char* text, std::size_t width) {
+    std::size_t length = std::strlen(text);
+    std::memcpy(pos, text, length);
+    if (length < width) {
+        std::memset(pos + length, ' ', width - length);
+        length = width;
+    }
+    return pos + length;
+}
+
+// Appends an item as a line of a menu file.
+void appendItemLine(std::string& out, const FoodItem& item) {
+    char price[MONEY_TEXT_LEN];
+    out += item.id;
+    out += '|';
+    out += item.name;
+    out += '|';
+    out += item.description;
+    out += '|';
+    out.append(price, item.price.format(price));
+    out += '|';
+    out += std::to_string(item.on_hand.get());
+    out += '\n';
+}
+
+// Recovers an ID from its key, the reverse of FoodItem::makeKey.
+std::string idOfKey(FoodKey key) {
+    std::string id;
+    for (; key != 0; key >>= 8) {
+        id.insert(id.begin(), static_cast<char>(key & 0xff));
     }
+    return id;
+}
+
+// Hex digits of a segment checksum.
+#define DELTA_CHECKSUM_DIGITS 16
+
+// A delta file is a series of segments, one per save. A segment holds one line per changed item:
+// the item as a menu file line, or "-|id" if it was removed. It ends with the line
+// "=|generation|records|#checksum", the checksum covering everything in the segment before the
+// '#'. Generations count the segments since the menu file was last written in full.
+std::string deltaTrailer(const std::string& segment, unsigned generation, unsigned records) {
+    std::string trailer = "=|" + std::to_string(generation) + '|' + std::to_string(records) + '|';
+    Checksum checksum;
+    checksum.update(segment.data(), segment.size());
+    checksum.update(trailer.data(), trailer.size());
+    char digits[DELTA_CHECKSUM_DIGITS + 4];
+    std::snprintf(digits, sizeof(digits), "#%016llx\n", checksum.value());
+    return trailer + digits;
+}
+
+// An empty menu still has one (empty) page.
+unsigned pagesFor(unsigned items, unsigned pageSize) {
+    unsigned pages = 1;
+    if (pageSize > 0 && items > 0) {
+        pages = (items - 1) / pageSize + 1;
+    }
+    return pages;
+}
+
+// Goes through the segments of a delta file in order, calling visit with the generation, records
+// and line number of the trailer of each intact one. Returns the length of the file up to the end
+// of the last intact segment; anything after it is a segment whose writing was cut short.
+template <typename Visit>
+std::size_t scanDelta(DataFile& file, Visit visit) {
+    StrRef contents = file.contents();
+    std::vector<StrRef> records;
+    std::size_t intactBytes = 0;
+    bool intact = true;
+    StrRef line;
+
+    while (intact && file.nextLine(line)) {
+        StrRef fields[6];
+        int generation = 0;
+        int listed = 0;
+        if (DataFile::split(line, '|', fields, 6) == 4 && fields[0].length == 1 && fields[0].data[0] == '=') {
+            Checksum checksum;
+            const char* segmentStart = contents.data + intactBytes;
+            checksum.update(segmentStart, fields[3].data - segmentStart);
+            char expected[DELTA_CHECKSUM_DIGITS + 1];
+            std::snprintf(expected, sizeof(expected), "%016llx", checksum.value());
+            intact = DataFile::parseInt(fields[1], generation) && DataFile::parseInt(fields[2], listed) &&
+                     static_cast<std::size_t>(listed) == records.size() && fields[3].length == DELTA_CHECKSUM_DIGITS + 1 &&
+                     fields[3].data[0] == '#' && std::memcmp(fields[3].data + 1, expected, DELTA_CHECKSUM_DIGITS) == 0;
+            if (intact) {
+                visit(static_cast<unsigned>(generation), records, file.lineNumber());
+                records.clear();
+                intactBytes = std::min<std::size_t>(line.data + line.length + 1 - contents.data, contents.length);
+            }
+        } else {
+            records.push_back(line);
+        }
+    }
+    return intactBytes;
+}
+
+}
+
+LinkedList::LinkedList()
+    : head(nullptr), count(0), latest(new MenuView()), renderedVersion(0), deltaSegments(0), deltaRecords(0),
+      stagedSegments(0), stagedRecords(0) {}
+
+// Nodes and items are released together when the pool is destroyed. No reader may outlive the list.
+LinkedList::~LinkedList() {
     head = nullptr;
     count = 0;
+    index.clear();
+    for (const Retired& replaced : retired) {
+        delete replaced.view;
+    }
+    delete latest.load();
 }
 
-void LinkedList::insertNode(const FoodItem& data) {
-    Node* newNode = new Node();
-    newNode->data = new FoodItem(data);
-    newNode->next = nullptr;
+// The description is copied into the list's own storage, so the caller's text only needs to
+// outlive this call.
+bool LinkedList::insertNode(const FoodItem& data) {
+    bool inserted = false;
 
-    if (head == nullptr || head->data->id > data.id) {
-        newNode->next = head;
-        head = newNode;
+    if (index.find(data.key) != nullptr) {
+        std::cerr << "Food item with ID " << data.id << " already exists." << std::endl;
     } else {
-        Node* current = head;
-        while (current->next != nullptr && current->next->data->id <= data.id) {
-            current = current->next;
+        FoodItem stored(data);
+        stored.description = descriptions.add(data.description, std::strlen(data.description));
+        linkSorted(stored);
+        inserted = true;
+    }
+    return inserted;
+}
+
+// Links an item whose description is already in the list's storage into its sorted position.
+void LinkedList::linkSorted(const FoodItem& data) {
+    Node* prev = nullptr;
+    if (head != nullptr && head->data->key <= data.key) {
+        prev = head;
+        while (prev->next != nullptr && prev->next->data->key <= data.key) {
+            prev = prev->next;
         }
-        newNode->next = current->next;
-        current->next = newNode;
     }
+    Node* newNode = linkAfter(prev, data);
+    publish(latest.load()->with(newNode->data));
+}
+
+// This method links a node for an item whose description is already in the list's storage after
+// prev, or first if prev is nullptr, and returns it. The new version is left to the caller.
+Node* LinkedList::linkAfter(Node* prev, const FoodItem& data) {
+    Node* newNode = pool.acquire(data);
+    newNode->prev = prev;
+    newNode->next = prev != nullptr ? prev->next : head;
+    if (prev == nullptr) {
+        head = newNode;
+    } else {
+        prev->next = newNode;
+    }
+    if (newNode->next != nullptr) {
+        newNode->next->prev = newNode;
+    }
+    index.insert(newNode);
+    searchIndex.add(newNode);
+    priceIndex.add(newNode);
     count++;
+    markChanged(data);
+    return newNode;
+}
+
+// This method links a node for an item that sorts after tail, the last node or nullptr if the list
+// is empty, at the end of the list and returns it. The description must already be in the list's
+// storage. Unlike linkAfter it does not note the item as changed, as it is for items being loaded.
+// The new version is left to the caller.
+Node* LinkedList::appendNode(Node* tail, const FoodItem& data) {
+    Node* newNode = pool.acquire(data);
+    newNode->prev = tail;
+    if (tail == nullptr) {
+        head = newNode;
+    } else {
+        tail->next = newNode;
+    }
+    index.insert(newNode);
+    searchIndex.add(newNode);
+    priceIndex.add(newNode);
+    count++;
+    return newNode;
+}
+
+// This method unlinks a node already taken out of the index. The node, and its description, are
+// freed along with the version the caller publishes next.
+void LinkedList::unlink(Node* current) {
+    if (current->prev == nullptr) {
+        head = current->next;
+    } else {
+        current->prev->next = current->next;
+    }
+    if (current->next != nullptr) {
+        current->next->prev = current->prev;
+    }
+    markChanged(*current->data);
+    searchIndex.remove(current);
+    priceIndex.remove(current);
+    count--;
+    unlinked.push_back(current);
+}
+
+// This method puts a node for data, an item with the same ID and description, in place of current
+// and returns it. The new node shares current's stock counter, so sales under way on current
+// reserve and commit the same units as sales on the new one. Readers may still be looking at
+// current, which is freed along with the version the caller publishes next.
+Node* LinkedList::replaceNode(Node* current, const FoodItem& data) {
+    Node* newNode = pool.acquireReplacement(data, current);
+    newNode->prev = current->prev;
+    newNode->next = current->next;
+    if (current->prev == nullptr) {
+        head = newNode;
+    } else {
+        current->prev->next = newNode;
+    }
+    if (current->next != nullptr) {
+        current->next->prev = newNode;
+    }
+    index.erase(data.key);
+    index.insert(newNode);
+    searchIndex.remove(current);
+    searchIndex.add(newNode);
+    priceIndex.remove(current);
+    priceIndex.add(newNode);
+    markChanged(data);
+    replaced.push_back(current);
+    return newNode;
 }
 
+// This method makes next the version readers see. The version it replaces, and the nodes unlinked
+// since the last one was published, are freed once no reader can be looking at them any more.
+void LinkedList::publish(const MenuView* next) {
+    const MenuView* previous = latest.load();
+    latest.store(next);
+    unsigned long long epoch = EpochGuard::advance();
+    retired.push_back(Retired{epoch, previous, nullptr, false});
+    for (Node* node : replaced) {
+        retired.push_back(Retired{epoch, nullptr, node, true});
+    }
+    for (Node* node : unlinked) {
+        retired.push_back(Retired{epoch, nullptr, node, false});
+    }
+    replaced.clear();
+    unlinked.clear();
+    reclaim();
+}
+
+// Frees what edits have replaced, oldest first, up to the first thing a reader may still see.
+void LinkedList::reclaim() {
+    unsigned long long oldest = EpochGuard::oldestActive();
+    std::size_t freed = 0;
+    while (freed < retired.size() && retired[freed].epoch < oldest) {
+        delete retired[freed].view;
+        if (retired[freed].node != nullptr && retired[freed].replaced) {
+            pool.releaseReplaced(retired[freed].node);
+        } else if (retired[freed].node != nullptr) {
+            const char* description = retired[freed].node->data->description;
+            descriptions.release(description, std::strlen(description));
+            pool.release(retired[freed].node);
+        }
+        freed++;
+    }
+    retired.erase(retired.begin(), retired.begin() + freed);
+}
+
+// The menu is rendered once and then written with a single call until it changes.
 void LinkedList::displayMenu() const {
-    std::cout << "Food Menu\n";
-    std::cout << "---------\n";
-    std::cout << "ID    | Name                                     | Price\n";
-    std::cout << "------------------------------------------------------------------\n";
+    MenuReader menu(*this);
+    std::lock_guard<std::mutex> locked(renderLock);
+    if (rowStarts.empty() || renderedVersion != menu->getVersion()) {
+        renderMenu(*menu);
+    }
+    std::cout.write(rendered.data(), rendered.size());
+    std::cout.flush();
+}
 
-    Node* current = head;
-    while (current != nullptr) {
-        std::ostringstream nameStream;
-        nameStream << std::setw(NAMELEN) << std::left << current->data->name;
+// Pages are numbered from 1. Returns false, printing nothing, if there is no such page. Once the
+// menu is rendered a page costs only its own rows, whichever page it is.
+bool LinkedList::displayMenuPage(unsigned page, unsigned pageSize) const {
+    MenuReader menu(*this);
+    unsigned pages = pagesFor(menu->getCount(), pageSize);
+    bool shown = pageSize > 0 && page >= 1 && page <= pages;
 
-        std::cout << std::setw(IDLEN) << std::left << current->data->id << " | "
-                  << nameStream.str() << " | $"
-                  << current->data->price.dollars << '.';
-        
-        if (current->data->price.cents < 10) {
-            std::cout << '0';
+    if (shown) {
+        std::lock_guard<std::mutex> locked(renderLock);
+        if (rowStarts.empty() || renderedVersion != menu->getVersion()) {
+            renderMenu(*menu);
         }
-        std::cout << current->data->price.cents << std::endl;
-        current = current->next;
+        std::size_t first = static_cast<std::size_t>(page - 1) * pageSize;
+        std::size_t last = std::min<std::size_t>(first + pageSize, menu->getCount());
+        char footer[64];
+        int footerLength = std::snprintf(footer, sizeof(footer), "Page %u of %u\n\n", page, pages);
+
+        std::cout.write(rendered.data(), rowStarts[0]);
+        std::cout.write(rendered.data() + rowStarts[first], rowStarts[last] - rowStarts[first]);
+        std::cout.write(footer, footerLength);
+        std::cout.flush();
     }
-    std::cout << "" << std::endl;
+    return shown;
+}
+
+unsigned LinkedList::getPageCount(unsigned pageSize) const {
+    MenuReader menu(*this);
+    return pagesFor(menu->getCount(), pageSize);
 }
 
+// Appends the menu to text as displayMenu prints it, for output that does not go to the terminal.
+void LinkedList::appendMenu(std::string& text) const {
+    MenuReader menu(*this);
+    std::lock_guard<std::mutex> locked(renderLock);
+    if (rowStarts.empty() || renderedVersion != menu->getVersion()) {
+        renderMenu(*menu);
+    }
+    text.append(rendered);
+}
+
+// Appends a page of the menu to text as displayMenuPage prints it. Returns false, appending
+// nothing, if there is no such page.
+bool LinkedList::appendMenuPage(unsigned page, unsigned pageSize, std::string& text) const {
+    MenuReader menu(*this);
+    unsigned pages = pagesFor(menu->getCount(), pageSize);
+    bool shown = pageSize > 0 && page >= 1 && page <= pages;
+
+    if (shown) {
+        std::lock_guard<std::mutex> locked(renderLock);
+        if (rowStarts.empty() || renderedVersion != menu->getVersion()) {
+            renderMenu(*menu);
+        }
+        std::size_t first = static_cast<std::size_t>(page - 1) * pageSize;
+        std::size_t last = std::min<std::size_t>(first + pageSize, menu->getCount());
+        char footer[64];
+        int footerLength = std::snprintf(footer, sizeof(footer), "Page %u of %u\n\n", page, pages);
+
+        text.append(rendered.data(), rowStarts[0]);
+        text.append(rendered.data() + rowStarts[first], rowStarts[last] - rowStarts[first]);
+        text.append(footer, footerLength);
+    }
+    return shown;
+}
+
+// Builds the header, one row per item in ID order and the blank line that ends the menu, recording
+// where each row starts. The ID column is MENU_ID_WIDTH wide unless a longer ID needs more room.
+void LinkedList::renderMenu(const MenuView& menu) const {
+    char row[IDLEN + NAMELEN + MONEY_TEXT_LEN + 8];
+    std::size_t idWidth = MENU_ID_WIDTH;
+    for (const FoodItem* item : menu) {
+        idWidth = std::max(idWidth, std::strlen(item->id));
+    }
+
+    rendered.assign(MENU_TITLE, sizeof(MENU_TITLE) - 1);
+    rendered.append("ID");
+    rendered.append(idWidth - 2, ' ');
+    rendered.append(MENU_COLUMNS, sizeof(MENU_COLUMNS) - 1);
+    rendered.append(MENU_RULE, sizeof(MENU_RULE) - 1);
+    rendered.append(idWidth - MENU_ID_WIDTH, '-');
+    rendered += '\n';
+    rendered.reserve(rendered.size() + static_cast<std::size_t>(menu.getCount()) * (idWidth + NAMELEN + 14) + 1);
+    rowStarts.clear();
+    rowStarts.reserve(menu.getCount() + 1);
+
+    for (const FoodItem* item : menu) {
+        char* pos = appendPadded(row, item->id, idWidth);
+        std::memcpy(pos, " | ", 3);
+        pos = appendPadded(pos + 3, item->name, NAMELEN);
+        std::memcpy(pos, " | $", 4);
+        pos += 4;
+        pos += item->price.format(pos);
+        *pos++ = '\n';
+
+        rowStarts.push_back(rendered.size());
+        rendered.append(row, pos - row);
+    }
+    rowStarts.push_back(rendered.size());
+    rendered += '\n';
+    renderedVersion = menu.getVersion();
+}
+
+// Each line is "id|name|description|price", optionally followed by "|on hand". Items without a stock
+// level start with DEFAULT_FOOD_STOCK_LEVEL. The file is parsed in place from a memory mapping and
+// malformed lines are reported with their line numbers and skipped. Blank lines are ignored.
+// Changes saved since the file was last written in full are then applied from its delta file.
 void LinkedList::loadMenuFromFile(const std::string& filename) {
-    std::ifstream file(filename);
-    bool success = file.is_open();
+    STAT_TIME(STAT_LOAD_MENU);
+    DataFile file(filename);
+    bool success = file.isOpen();
     if (!success) {
         std::cerr << "Error opening file: " << filename << std::endl;
     } else {
-        std::string line;
-        while (std::getline(file, line)) {
-            std::istringstream iss(line);
-            std::string id, name, description, priceStr;
-            char delimiter = '|';
-            if (std::getline(iss, id, delimiter) &&
-                std::getline(iss, name, delimiter) &&
-                std::getline(iss, description, delimiter) &&
-                std::getline(iss, priceStr, delimiter)) {
-                size_t dotPos = priceStr.find('.');
-                if (dotPos != std::string::npos) {
-                    unsigned int dollars = std::stoi(priceStr.substr(0, dotPos));
-                    unsigned int cents = std::stoi(priceStr.substr(dotPos + 1));
-                    Price price(dollars, cents);
-                    FoodItem item(id, name, description, price, DEFAULT_FOOD_STOCK_LEVEL);
-                    insertNode(item);
-                } else {
-                    std::cerr << "Error reading price from file: " << filename << std::endl;
+        std::vector<FoodItem> items;
+        StrRef line;
+        while (file.nextLine(line)) {
+            if (!line.empty()) {
+                readItem(line, filename, file.lineNumber(), items);
+            }
+        }
+        applyDelta(filename, items);
+        bulkInsert(items, filename);
+    }
+}
+
+// This method parses one line of a menu file and adds the item to items, with its description
+// already in the list's storage. Returns false, after reporting why, if the line is malformed.
+bool LinkedList::readItem(StrRef line, const std::string& filename, unsigned lineNumber, std::vector<FoodItem>& items) {
+    StrRef fields[6];
+    unsigned found = DataFile::split(line, '|', fields, 6);
+    int cents = 0;
+    int onHand = DEFAULT_FOOD_STOCK_LEVEL;
+    bool valid = false;
+
+    if (found != 4 && found != 5) {
+        std::cerr << filename << ':' << lineNumber << ": expected 4 or 5 fields separated by '|'" << std::endl;
+    } else if (fields[0].empty() || fields[0].length > IDLEN || fields[1].length > NAMELEN || fields[2].length > DESCLEN) {
+        std::cerr << filename << ':' << lineNumber << ": field too long" << std::endl;
+    } else if (!DataFile::parseCents(fields[3], cents)) {
+        std::cerr << filename << ':' << lineNumber << ": invalid price \"" << fields[3].str() << '"' << std::endl;
+    } else if (found == 5 && !DataFile::parseInt(fields[4], onHand)) {
+        std::cerr << filename << ':' << lineNumber << ": invalid stock level \"" << fields[4].str() << '"' << std::endl;
+    } else {
+        const char* storedDescription = descriptions.add(fields[2].data, fields[2].length);
+        items.push_back(FoodItem(fields[0].data, fields[0].length, fields[1].data, fields[1].length,
+                                 storedDescription, Money::fromCents(cents), onHand));
+        valid = true;
+    }
+    return valid;
+}
+
+// This method applies the intact segments of a menu file's delta file, if it has one, to the items
+// read from the menu file. The last record for an ID wins.
+void LinkedList::applyDelta(const std::string& filename, std::vector<FoodItem>& items) {
+    std::string deltaName = filename + MENU_DELTA_SUFFIX;
+    DataFile file(deltaName);
+    deltaSegments = 0;
+    deltaRecords = 0;
+
+    if (file.isOpen()) {
+        std::unordered_map<FoodKey, std::size_t> positions(items.size());
+        for (std::size_t i = 0; i < items.size(); i++) {
+            positions.insert(std::make_pair(items[i].key, i));
+        }
+        std::vector<bool> dropped(items.size(), false);
+
+        std::size_t intactBytes = scanDelta(file, [&](unsigned, const std::vector<StrRef>& records, unsigned trailerLine) {
+            deltaSegments++;
+            deltaRecords += records.size();
+            for (std::size_t r = 0; r < records.size(); r++) {
+                StrRef fields[2];
+                unsigned lineNumber = trailerLine - static_cast<unsigned>(records.size() - r);
+                bool removal = DataFile::split(records[r], '|', fields, 2) == 2 && fields[0].length == 1 && fields[0].data[0] == '-';
+                FoodKey key = FoodItem::makeKey(fields[1].data, fields[1].length);
+                if (removal || readItem(records[r], deltaName, lineNumber, items)) {
+                    key = removal ? key : items.back().key;
+                    std::unordered_map<FoodKey, std::size_t>::iterator at = positions.find(key);
+                    if (at != positions.end() && !dropped[at->second]) {
+                        descriptions.release(items[at->second].description, std::strlen(items[at->second].description));
+                    }
+                    if (removal) {
+                        if (at != positions.end()) {
+                            dropped[at->second] = true;
+                        }
+                    } else if (at == positions.end()) {
+                        positions.insert(std::make_pair(key, items.size() - 1));
+                        dropped.push_back(false);
+                    } else {
+                        items[at->second] = items.back();
+                        items.pop_back();
+                        dropped[at->second] = false;
+                    }
                 }
+            }
+        });
+        if (intactBytes < file.contents().length) {
+            std::cerr << deltaName << ": ignoring the damaged changes at the end of the file" << std::endl;
+        }
+
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < items.size(); i++) {
+            if (!dropped[i]) {
+                items[kept++] = items[i];
+            }
+        }
+        items.erase(items.begin() + kept, items.end());
+    }
+}
+
+// Links a batch of records into the list in O(n log n) rather than the O(n^2) of repeated insertNode calls.
+// Files written by saveMenuToFile are already in ID order, in which case the sort is skipped entirely.
+// Duplicate IDs are reported and only the first record for each ID is kept. Descriptions must
+// already be in the list's storage, each added on its own; those of dropped records are released.
+void LinkedList::bulkInsert(std::vector<FoodItem>& items, const std::string& source) {
+    auto byId = [](const FoodItem& a, const FoodItem& b) { return a.key < b.key; };
+
+    if (head != nullptr) {
+        // Merging into an existing menu is rare enough to use the ordinary sorted insert.
+        for (const FoodItem& item : items) {
+            if (index.find(item.key) != nullptr) {
+                std::cerr << "Duplicate food ID " << item.id << " in " << source << ", keeping the first entry." << std::endl;
+                descriptions.release(item.description, std::strlen(item.description));
             } else {
-                std::cerr << "Error reading line from file: " << filename << std::endl;
+                linkSorted(item);
             }
         }
-        file.close();
+    } else {
+        if (!std::is_sorted(items.begin(), items.end(), byId)) {
+            std::stable_sort(items.begin(), items.end(), byId);
+        }
+
+        index.reserve(items.size());
+        pool.reserve(items.size());
+        Node* tail = nullptr;
+        for (const FoodItem& item : items) {
+            if (tail != nullptr && tail->data->key == item.key) {
+                std::cerr << "Duplicate food ID " << item.id << " in " << source << ", keeping the first entry." << std::endl;
+                descriptions.release(item.description, std::strlen(item.description));
+            } else {
+                tail = appendNode(tail, item);
+            }
+        }
+        publish(MenuView::build(head, latest.load()->getVersion() + 1));
     }
 }
 
 Node* LinkedList::findItem(const std::string& itemId) const {
-    Node* current = head;
+    STAT_TIME(STAT_FIND_ITEM);
     Node* foundNode = nullptr;
-
-    while (current != nullptr && foundNode == nullptr) {
-        if (current->data->id == itemId) {
-            foundNode = current;
-        } else {
-            current = current->next;
-        }
+    if (itemId.size() <= IDLEN) {
+        foundNode = index.find(FoodItem::makeKey(itemId));
     }
     return foundNode;
 }
 
+// Finds up to limit items whose names or descriptions match every word of the query, best match
+// first. See SearchIndex for how words match and how matches are ranked.
+void LinkedList::search(const std::string& query, unsigned limit, std::vector<Node*>& matches) const {
+    STAT_TIME(STAT_SEARCH);
+    if (!searchIndex.isBuilt()) {
+        searchIndex.build(head, count);
+    }
+    searchIndex.search(query, limit, matches);
+}
+
+// Returns the number of items priced from low to high, both included, in O(log n).
+unsigned LinkedList::countByPrice(Money low, Money high) const {
+    if (!priceIndex.isBuilt()) {
+        priceIndex.build(head, count);
+    }
+    return priceIndex.count(low, high);
+}
+
+// Fills matches with up to limit items priced from low to high, cheapest first and items of the
+// same price in ID order, after skipping the first skip of them. With limit items listed the cost
+// is O(log n + limit), wherever in the range they are.
+void LinkedList::listByPrice(Money low, Money high, unsigned skip, unsigned limit, std::vector<Node*>& matches) const {
+    STAT_TIME(STAT_LIST_BY_PRICE);
+    if (!priceIndex.isBuilt()) {
+        priceIndex.build(head, count);
+    }
+    priceIndex.list(low, high, skip, limit, matches);
+}
+
 bool LinkedList::removeItem(const std::string& itemId) {
-    Node* current = head;
-    Node* previous = nullptr;
-    bool itemRemoved = false;
-
-    while (current != nullptr && !itemRemoved) {
-        if (current->data->id == itemId) {
-            if (previous == nullptr) {
-                head = current->next;
+    Node* current = findItem(itemId);
+    bool itemRemoved = current != nullptr;
+
+    if (itemRemoved) {
+        std::cout << "\"" << current->data->id << " - " << current->data->name << " - " << current->data->description << "\" has been removed from the system." << std::endl;
+        eraseItem(itemId);
+    } else {
+        std::cerr << "Food item with ID " << itemId << " not found." << std::endl;
+    }
+
+    return itemRemoved;
+}
+
+// Removes an item without printing anything, for callers such as journal replay.
+bool LinkedList::eraseItem(const std::string& itemId) {
+    Node* current = nullptr;
+    if (itemId.size() <= IDLEN) {
+        current = index.erase(FoodItem::makeKey(itemId));
+    }
+    bool itemRemoved = current != nullptr;
+
+    if (itemRemoved) {
+        unlink(current);
+        publish(latest.load()->without(current->data->key));
+    }
+    return itemRemoved;
+}
+
+// Returns false if there is no item with that ID. Readers may be looking at the item, so it is
+// replaced by a copy with the new price rather than changed. The copy shares the original's stock
+// level, so a sale of the item under way on another thread completes against it.
+bool LinkedList::setPrice(const std::string& itemId, Money price) {
+    Node* current = findItem(itemId);
+    bool found = current != nullptr;
+
+    if (found) {
+        FoodItem repriced(*current->data);
+        repriced.price = price;
+        Node* newNode = replaceNode(current, repriced);
+        publish(latest.load()->with(newNode->data));
+    }
+    return found;
+}
+
+// Returns true if every change could be made to the menu as it stands, otherwise false with
+// failures holding why each change that could not be made fails; see applyChanges.
+bool LinkedList::checkChanges(const std::vector<MenuChange>& changes, std::vector<const char*>& failures) const {
+    std::vector<std::size_t> order;
+    return checkChanges(changes, order, failures);
+}
+
+// Fills order with the positions of the changes in ID order, and failures with nullptr for each
+// change that can be made or the reason it cannot. Each check is an index lookup, so this is O(m)
+// for changes already in ID order and O(m log m) otherwise.
+bool LinkedList::checkChanges(const std::vector<MenuChange>& changes, std::vector<std::size_t>& order,
+                              std::vector<const char*>& failures) const {
+    auto byId = [&changes](std::size_t a, std::size_t b) { return changes[a].item.key < changes[b].item.key; };
+    bool valid = true;
+
+    order.resize(changes.size());
+    for (std::size_t i = 0; i < changes.size(); i++) {
+        order[i] = i;
+    }
+    if (!std::is_sorted(order.begin(), order.end(), byId)) {
+        std::stable_sort(order.begin(), order.end(), byId);
+    }
+
+    failures.assign(changes.size(), nullptr);
+    for (std::size_t i = 0; i < order.size(); i++) {
+        const MenuChange& change = changes[order[i]];
+        bool onMenu = index.find(change.item.key) != nullptr;
+        if (i > 0 && changes[order[i - 1]].item.key == change.item.key) {
+            failures[order[i]] = "more than one change for this food ID";
+        } else if (change.type == MENU_ADD && onMenu) {
+            failures[order[i]] = "food ID already in use";
+        } else if (change.type != MENU_ADD && !onMenu) {
+            failures[order[i]] = "item not found";
+        }
+        valid = valid && failures[order[i]] == nullptr;
+    }
+    return valid;
+}
+
+// This method makes every change, or none if any of them cannot be made, in which case it returns
+// false and failures holds why each change that could not be made fails. Each ID may be changed
+// only once. The changes are merged into the list in a single walk down it, in ID order, and
+// readers see them all at once in one new version, so m changes cost O(n + m) rather than a walk
+// of the list each. The descriptions of added items are copied into the list's storage. A repriced
+// item is replaced as by setPrice, sharing its stock level with the original.
+bool LinkedList::applyChanges(const std::vector<MenuChange>& changes, std::vector<const char*>& failures) {
+    std::vector<std::size_t> order;
+    bool valid = checkChanges(changes, order, failures);
+
+    if (valid && !changes.empty()) {
+        Node* prev = nullptr;
+        Node* current = head;
+        for (std::size_t i : order) {
+            const MenuChange& change = changes[i];
+            while (current != nullptr && current->data->key < change.item.key) {
+                prev = current;
+                current = current->next;
+            }
+            if (change.type == MENU_ADD) {
+                FoodItem stored(change.item);
+                stored.description = descriptions.add(change.description.data, change.description.length);
+                prev = linkAfter(prev, stored);
+            } else if (change.type == MENU_REMOVE) {
+                Node* removed = index.erase(change.item.key);
+                current = current->next;
+                unlink(removed);
+            } else if (change.type == MENU_REPRICE) {
+                FoodItem repriced(*current->data);
+                repriced.price = change.item.price;
+                current = replaceNode(current, repriced);
             } else {
-                previous->next = current->next;
+                current->data->on_hand.set(change.item.on_hand.get());
+                markChanged(*current->data);
             }
-            std::cout << "\"" << current->data->id << " - " << current->data->name << " - " << current->data->description << "\" has been removed from the system." << std::endl;
-            delete current;
-            count--;
-            itemRemoved = true;
-        } else {
-            previous = current;
-            current = current->next;
         }
+        publish(MenuView::build(head, latest.load()->getVersion() + 1));
     }
+    return valid;
+}
 
-    if (!itemRemoved) {
-        std::cerr << "Food item with ID " << itemId << " not found." << std::endl;
+// This method notes that an item has changed since the last save, so that saveChanges writes it.
+// Items are added and removed through the list, which notes them itself; callers note stock level
+// changes. Safe to call from several threads at once. The same item may be noted any number of
+// times. When the notes fill the room they have, they are boiled down first, and given more room
+// only if that leaves them more than half of it; so a steady stream of sales stops allocating.
+void LinkedList::markChanged(const FoodItem& item) {
+    std::lock_guard<std::mutex> locked(changedLock);
+    if (changedKeys.size() == changedKeys.capacity() && changedKeys.size() >= 64) {
+        std::sort(changedKeys.begin(), changedKeys.end());
+        changedKeys.erase(std::unique(changedKeys.begin(), changedKeys.end()), changedKeys.end());
+        if (changedKeys.size() * 2 > changedKeys.capacity()) {
+            changedKeys.reserve(changedKeys.capacity() * 2);
+        }
     }
+    changedKeys.push_back(item.key);
+}
 
-    return itemRemoved;
+// The file is replaced as a whole, never left torn, and any delta file it had is removed, as the
+// file now holds everything. Returns false if the file could not be written.
+bool LinkedList::saveMenuToFile(const std::string& filename) const {
+    STAT_TIME(STAT_SAVE_MENU);
+    MenuReader menu(*this);
+    SaveFile file(filename);
+    writeMenu(file, *menu);
+    return file.commit() && SaveFile::remove(filename + MENU_DELTA_SUFFIX);
 }
 
-void LinkedList::saveMenuToFile(const std::string& filename) const {
-    std::ofstream file(filename);
-    bool fileOpened = file.is_open();
+void LinkedList::writeMenu(SaveFile& file, const MenuView& menu) const {
+    std::string line;
+    for (const FoodItem* item : menu) {
+        line.clear();
+        appendItemLine(line, *item);
+        file.write(line);
+    }
+}
 
-    if (!fileOpened) {
-        std::cerr << "Error opening file for writing: " << filename << std::endl;
-    } else {
-        Node* current = head;
-        while (current != nullptr) {
-            file << current->data->id << '|'
-                 << current->data->name << '|'
-                 << current->data->description << '|'
-                 << current->data->price.dollars << '.';
-            if (current->data->price.cents < 10) {
-                file << '0';
+// This method stages a save of the menu over the menu file it was loaded from, to be put in place by
+// installChanges. Only the items changed since the last save are written, as a new segment of the
+// delta file. When the delta file would grow past MENU_COMPACT_PERCENT of the menu, the whole
+// menu is written instead, to replace both files. Nothing is staged if nothing has changed. Call
+// markSaved once the save is in place. Returns false if the staged file could not be written.
+bool LinkedList::saveChanges(const std::string& filename) {
+    STAT_TIME(STAT_SAVE_MENU);
+    MenuReader menu(*this);
+    std::vector<FoodKey> keys;
+    {
+        std::lock_guard<std::mutex> locked(changedLock);
+        keys = changedKeys;
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    stagedSegments = deltaSegments;
+    stagedRecords = deltaRecords;
+    bool staged = true;
+
+    if (!keys.empty() && (deltaRecords + keys.size()) * 100 > static_cast<std::size_t>(menu->getCount()) * MENU_COMPACT_PERCENT) {
+        SaveFile file(filename + SAVE_STAGED_SUFFIX);
+        writeMenu(file, *menu);
+        staged = file.commit();
+        stagedSegments = 0;
+        stagedRecords = 0;
+    } else if (!keys.empty()) {
+        std::string segment;
+        for (FoodKey key : keys) {
+            const FoodItem* item = menu->find(key);
+            if (item != nullptr) {
+                appendItemLine(segment, *item);
+            } else {
+                segment += "-|" + idOfKey(key) + '\n';
             }
-            file << current->data->price.cents << std::endl;
-            current = current->next;
         }
-        file.close();
+        stagedSegments = deltaSegments + 1;
+        stagedRecords = deltaRecords + keys.size();
+        segment += deltaTrailer(segment, stagedSegments, keys.size());
+        SaveFile file(filename + MENU_DELTA_SUFFIX + SAVE_STAGED_SUFFIX);
+        file.write(segment);
+        staged = file.commit();
+    }
+    return staged;
+}
+
+void LinkedList::markSaved() {
+    std::lock_guard<std::mutex> locked(changedLock);
+    changedKeys.clear();
+    deltaSegments = stagedSegments;
+    deltaRecords = stagedRecords;
+}
+
+// This method puts a save staged by saveChanges in place. Running it again after a crash part way
+// through finishes the job: a segment already at the end of the delta file is not added twice.
+bool LinkedList::installChanges(const std::string& filename) {
+    std::string deltaName = filename + MENU_DELTA_SUFFIX;
+    std::string segmentName = deltaName + SAVE_STAGED_SUFFIX;
+    bool installed = true;
+
+    if (SaveFile::exists(filename + SAVE_STAGED_SUFFIX)) {
+        // The menu file without its delta file is never loaded, as an interrupted install is
+        // always finished first.
+        installed = SaveFile::remove(deltaName) && SaveFile::install(filename);
+    }
+    if (installed && SaveFile::exists(segmentName)) {
+        DataFile segment(segmentName);
+        DataFile delta(deltaName);
+        bool stagedFound = false;
+        unsigned stagedGeneration = 0;
+        unsigned lastGeneration = 0;
+        std::size_t segmentBytes = scanDelta(segment, [&](unsigned generation, const std::vector<StrRef>&, unsigned) {
+            stagedFound = true;
+            stagedGeneration = generation;
+        });
+        std::size_t intactBytes = scanDelta(delta, [&](unsigned generation, const std::vector<StrRef>&, unsigned) {
+            lastGeneration = generation;
+        });
+
+        if (!stagedFound) {
+            std::cerr << segmentName << ": damaged, not saving its changes" << std::endl;
+            installed = false;
+        } else if (stagedGeneration != lastGeneration) {
+            installed = SaveFile::append(deltaName, intactBytes, segment.contents().data, segmentBytes);
+        }
+        installed = installed && SaveFile::remove(segmentName);
     }
-}
\ No newline at end of file
+    return installed;
+}
+
+// This method removes whatever saveChanges staged.
+void LinkedList::discardChanges(const std::string& filename) {
+    SaveFile::discard(filename);
+    SaveFile::discard(filename + MENU_DELTA_SUFFIX);
+}
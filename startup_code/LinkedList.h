@@ -1,24 +1,157 @@
 #ifndef LINKEDLIST_H
 #define LINKEDLIST_H
 
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
 #include "Node.h"
+#include "ItemIndex.h"
+#include "NodePool.h"
+#include "TextArena.h"
+#include "SearchIndex.h"
+#include "PriceIndex.h"
+#include "SaveFile.h"
+#include "DataFile.h"
+#include "MenuView.h"
+#include "MenuChange.h"
+#include "Epoch.h"
 
+// Items shown per page when the menu is too long to show at once.
+#define MENU_PAGE_SIZE 20
+
+// Width of the ID column of the menu, enough for the four-digit IDs of the original menus. The
+// column widens when longer IDs are on the menu.
+#define MENU_ID_WIDTH 5
+
+// A menu file is followed by a delta file of this name holding the changes saved since the menu
+// file was last written in full.
+#define MENU_DELTA_SUFFIX ".delta"
+
+// Once the delta file would hold more records than this percentage of the items on the menu, the
+// next save writes the whole menu again instead.
+#define MENU_COMPACT_PERCENT 25
+
+// The menu. Edits are made by one thread at a time, which may also use the list's own lookups
+// (findItem, search, countByPrice, listByPrice, getHead). Every edit publishes a new MenuView, so any number of other
+// threads can read the menu through a MenuReader while it is edited.
 class LinkedList {
 public:
     LinkedList();
     ~LinkedList();
 
-    void insertNode(const FoodItem& data);
+    bool insertNode(const FoodItem& data);
     void displayMenu() const;
+    bool displayMenuPage(unsigned page, unsigned pageSize) const;
+    unsigned getPageCount(unsigned pageSize) const;
+    void appendMenu(std::string& text) const;
+    bool appendMenuPage(unsigned page, unsigned pageSize, std::string& text) const;
     void loadMenuFromFile(const std::string& filename);
     Node* findItem(const std::string& itemId) const;
+    void search(const std::string& query, unsigned limit, std::vector<Node*>& matches) const;
+    unsigned countByPrice(Money low, Money high) const;
+    void listByPrice(Money low, Money high, unsigned skip, unsigned limit, std::vector<Node*>& matches) const;
     bool removeItem(const std::string& itemId);
-    void saveMenuToFile(const std::string& filename) const;
+    bool eraseItem(const std::string& itemId);
+    bool setPrice(const std::string& itemId, Money price);
+    bool checkChanges(const std::vector<MenuChange>& changes, std::vector<const char*>& failures) const;
+    bool applyChanges(const std::vector<MenuChange>& changes, std::vector<const char*>& failures);
+    void markChanged(const FoodItem& item);
+    bool saveMenuToFile(const std::string& filename) const;
+    bool saveChanges(const std::string& filename);
+    void markSaved();
     Node* getHead() const { return head; }
+    unsigned getCount() const { return count; }
+    const PoolStats& getPoolStats() const { return pool.getStats(); }
+    std::size_t getTextBytes() const { return descriptions.bytesReserved(); }
+
+    static bool installChanges(const std::string& filename);
+    static void discardChanges(const std::string& filename);
 
 private:
+    friend class Snapshot;
+    friend class MenuReader;
+
+    // A version of the menu, or an item, that an edit replaced, with the epoch it was replaced in.
+    struct Retired {
+        unsigned long long epoch;
+        const MenuView* view;  // nullptr for an item
+        Node* node;            // nullptr for a version
+        bool replaced;         // the item has a newer version, which shares its stock counter
+    };
+
     Node* head;
     unsigned count;
+    ItemIndex index;
+    NodePool pool;
+    TextArena descriptions;
+
+    // Built on the first search, or the first query by price, so menus that are never searched or
+    // browsed by price do not pay for them.
+    mutable SearchIndex searchIndex;
+    mutable PriceIndex priceIndex;
+
+    // The latest version of the menu, the items removed and the old versions of items replaced since
+    // it was published, and the versions and items edits have replaced that readers may still be
+    // looking at.
+    std::atomic<const MenuView*> latest;
+    std::vector<Node*> unlinked;
+    std::vector<Node*> replaced;
+    std::vector<Retired> retired;
+
+    // The menu as displayMenu prints it, kept until a new version is published. rowStarts holds
+    // where each item's row begins, followed by where the rows end, so that any page can be cut
+    // out of it directly. Stock levels are not part of it. Displays on several threads share it,
+    // hence the lock.
+    mutable std::string rendered;
+    mutable std::vector<std::size_t> rowStarts;
+    mutable unsigned long long renderedVersion;
+    mutable std::mutex renderLock;
+
+    // Keys of the items added, removed, repriced or restocked since the last save, some perhaps more
+    // than once. Sales on several threads add to it, hence the lock.
+    std::vector<FoodKey> changedKeys;
+    std::mutex changedLock;
+
+    // Segments and records in the delta file of the menu file the list was loaded from, and the
+    // same once the save staged by saveChanges is in place.
+    unsigned deltaSegments;
+    unsigned deltaRecords;
+    unsigned stagedSegments;
+    unsigned stagedRecords;
+
+    void renderMenu(const MenuView& menu) const;
+    bool readItem(StrRef line, const std::string& filename, unsigned lineNumber, std::vector<FoodItem>& items);
+    void applyDelta(const std::string& filename, std::vector<FoodItem>& items);
+    void writeMenu(SaveFile& file, const MenuView& menu) const;
+    void linkSorted(const FoodItem& data);
+    Node* linkAfter(Node* prev, const FoodItem& data);
+    Node* appendNode(Node* tail, const FoodItem& data);
+    void unlink(Node* current);
+    Node* replaceNode(Node* current, const FoodItem& data);
+    bool checkChanges(const std::vector<MenuChange>& changes, std::vector<std::size_t>& order,
+                      std::vector<const char*>& failures) const;
+    void bulkInsert(std::vector<FoodItem>& items, const std::string& source);
+    void publish(const MenuView* next);
+    void reclaim();
+};
+
+// Reads the latest version of a menu without a lock, on any thread, however the menu is edited
+// meanwhile. The version and every item on it stay valid for as long as the MenuReader exists, so
+// keep it no longer than needed: items removed or repriced since are freed only once no reader
+// can see them.
+class MenuReader {
+public:
+    explicit MenuReader(const LinkedList& menu) : guard(), view(menu.latest.load()) {}
+    const MenuView& operator*() const { return *view; }
+    const MenuView* operator->() const { return view; }
+
+private:
+    EpochGuard guard;  // must come first, so the version is loaded under it
+    const MenuView* view;
+
+    MenuReader(const MenuReader&);
+    MenuReader& operator=(const MenuReader&);
 };
 
 #endif  // LINKEDLIST_H
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "MenuChange.h"
+
+namespace {
+
+bool validId(StrRef id) {
+    return !id.empty() && id.length <= IDLEN;
+}
+
+}
+
+// This method parses a line of a change file and adds the change to changes. Returns nullptr on
+// success, otherwise why the line is not a change. The description of an item to add is left in
+// the line, which must outlive the change.
+const char* MenuChange::parse(StrRef line, std::vector<MenuChange>& changes) {
+    StrRef fields[7];
+    unsigned found = DataFile::split(line, '|', fields, 7);
+    char type = fields[0].length == 1 ? fields[0].data[0] : '\0';
+    const char* failure = nullptr;
+    int cents = 0;
+    int units = DEFAULT_FOOD_STOCK_LEVEL;
+
+    if (type == 'A') {
+        if (found != 5 && found != 6) {
+            failure = "expected A|<food id>|<name>|<description>|<price>[|<units>]";
+        } else if (!validId(fields[1])) {
+            failure = "invalid food ID";
+        } else if (fields[2].empty() || fields[2].length > NAMELEN) {
+            failure = "invalid name";
+        } else if (fields[3].empty() || fields[3].length > DESCLEN) {
+            failure = "invalid description";
+        } else if (!DataFile::parseCents(fields[4], cents)) {
+            failure = "invalid price";
+        } else if (found == 6 && !DataFile::parseInt(fields[5], units)) {
+            failure = "invalid stock level";
+        } else {
+            changes.push_back(MenuChange(MENU_ADD, FoodItem(fields[1].data, fields[1].length, fields[2].data, fields[2].length,
+                                                            "", Money::fromCents(cents), units), fields[3]));
+        }
+    } else if (type == 'R') {
+        if (found != 2) {
+            failure = "expected R|<food id>";
+        } else if (!validId(fields[1])) {
+            failure = "invalid food ID";
+        } else {
+            changes.push_back(MenuChange(MENU_REMOVE, FoodItem(fields[1].data, fields[1].length, "", 0, "", Money(), 0), StrRef()));
+        }
+    } else if (type == 'P') {
+        if (found != 3) {
+            failure = "expected P|<food id>|<price>";
+        } else if (!validId(fields[1])) {
+            failure = "invalid food ID";
+        } else if (!DataFile::parseCents(fields[2], cents)) {
+            failure = "invalid price";
+        } else {
+            changes.push_back(MenuChange(MENU_REPRICE, FoodItem(fields[1].data, fields[1].length, "", 0, "",
+                                                                Money::fromCents(cents), 0), StrRef()));
+        }
+    } else if (type == 'Q') {
+        if (found != 3) {
+            failure = "expected Q|<food id>|<units>";
+        } else if (!validId(fields[1])) {
+            failure = "invalid food ID";
+        } else if (!DataFile::parseInt(fields[2], units)) {
+            failure = "invalid stock level";
+        } else {
+            changes.push_back(MenuChange(MENU_RESTOCK, FoodItem(fields[1].data, fields[1].length, "", 0, "", Money(), units), StrRef()));
+        }
+    } else {
+        failure = "unknown change type";
+    }
+    return failure;
+}
+
+// Appends the change as a line of a change file, without the newline.
+void MenuChange::format(std::string& line) const {
+    char price[MONEY_TEXT_LEN];
+    line += type == MENU_ADD ? 'A' : type == MENU_REMOVE ? 'R' : type == MENU_REPRICE ? 'P' : 'Q';
+    line += '|';
+    line += item.id;
+    if (type == MENU_ADD) {
+        line += '|';
+        line += item.name;
+        line += '|';
+        line.append(description.data, description.length);
+    }
+    if (type == MENU_ADD || type == MENU_REPRICE) {
+        line += '|';
+        line.append(price, item.price.format(price));
+    }
+    if (type == MENU_ADD || type == MENU_RESTOCK) {
+        line += '|';
+        line += std::to_string(item.on_hand.get());
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef MENUCHANGE_H
+#define MENUCHANGE_H
+
+#include <string>
+#include <vector>
+#include "Node.h"
+#include "DataFile.h"
+
+enum MenuChangeType {
+    MENU_ADD,      // add an item under a given ID
+    MENU_REMOVE,   // remove an item
+    MENU_REPRICE,  // change the price of an item
+    MENU_RESTOCK   // set the stock level of an item
+};
+
+// One change to make to a menu with LinkedList::applyChanges. As a line of a change file, with
+// fields separated by '|':
+//
+//   A|<food id>|<name>|<description>|<price>[|<units>]   add an item, with DEFAULT_FOOD_STOCK_LEVEL
+//                                                        units unless given
+//   R|<food id>                                          remove an item
+//   P|<food id>|<price>                                  change the price of an item
+//   Q|<food id>|<units>                                  set the stock level of an item
+//
+// Prices are in dollars and cents, as in a menu file.
+struct MenuChange {
+    MenuChangeType type;
+    FoodItem item;       // the item to add; otherwise its ID, with the new price or stock level
+    StrRef description;  // the description of an item to add, until the menu copies it
+
+    MenuChange(MenuChangeType type, const FoodItem& item, StrRef description)
+        : type(type), item(item), description(description) {}
+
+    static const char* parse(StrRef line, std::vector<MenuChange>& changes);
+    void format(std::string& line) const;
+};
+
+#endif  // MENUCHANGE_H
@@ -0,0 +1,183 @@
+#include <algorithm>
+#include "MenuView.h"
+
+MenuView::MenuView() : count(0), version(0) {}
+
+// A copy shares every chunk of the original.
+MenuView::MenuView(const MenuView& other)
+    : chunks(other.chunks), firstKeys(other.firstKeys), count(other.count), version(other.version) {
+    for (const Chunk* chunk : chunks) {
+        chunk->versions++;
+    }
+}
+
+MenuView::~MenuView() {
+    for (const Chunk* chunk : chunks) {
+        releaseChunk(chunk);
+    }
+}
+
+MenuView::const_iterator& MenuView::const_iterator::operator++() {
+    if (++slot == view->chunks[chunk]->size) {
+        chunk++;
+        slot = 0;
+    }
+    return *this;
+}
+
+// Returns a chunk of this version's own: a copy of from, or an empty chunk if from is nullptr.
+MenuView::Chunk* MenuView::newChunk(const Chunk* from) {
+    Chunk* chunk = from != nullptr ? new Chunk(*from) : new Chunk();
+    chunk->versions = 1;
+    return chunk;
+}
+
+void MenuView::releaseChunk(const Chunk* chunk) {
+    if (--chunk->versions == 0) {
+        delete chunk;
+    }
+}
+
+// This method puts chunk in place of chunk c, which this version stops sharing.
+void MenuView::replaceChunk(std::size_t c, Chunk* chunk) {
+    releaseChunk(chunks[c]);
+    chunks[c] = chunk;
+    firstKeys[c] = chunk->keys[0];
+}
+
+// Returns the chunk that holds key or would hold it: the last one starting at or before it.
+std::size_t MenuView::chunkOf(FoodKey key) const {
+    std::size_t after = std::upper_bound(firstKeys.begin(), firstKeys.end(), key) - firstKeys.begin();
+    return after > 0 ? after - 1 : 0;
+}
+
+FoodItem* MenuView::find(FoodKey key) const {
+    FoodItem* found = nullptr;
+    if (!chunks.empty()) {
+        const Chunk& chunk = *chunks[chunkOf(key)];
+        const FoodKey* at = std::lower_bound(chunk.keys, chunk.keys + chunk.size, key);
+        if (at != chunk.keys + chunk.size && *at == key) {
+            found = chunk.items[at - chunk.keys];
+        }
+    }
+    return found;
+}
+
+FoodItem* MenuView::find(const std::string& itemId) const {
+    return itemId.size() <= IDLEN ? find(FoodItem::makeKey(itemId)) : nullptr;
+}
+
+// This method returns the next version: this one with item added, or in place of the item with the
+// same ID. A full chunk is split in two to make room.
+MenuView* MenuView::with(FoodItem* item) const {
+    MenuView* next = new MenuView(*this);
+    next->version = version + 1;
+
+    if (chunks.empty()) {
+        Chunk* first = newChunk(nullptr);
+        first->keys[0] = item->key;
+        first->items[0] = item;
+        first->size = 1;
+        next->chunks.push_back(first);
+        next->firstKeys.push_back(item->key);
+        next->count++;
+    } else {
+        std::size_t c = chunkOf(item->key);
+        Chunk* chunk = newChunk(chunks[c]);
+        unsigned pos = std::lower_bound(chunk->keys, chunk->keys + chunk->size, item->key) - chunk->keys;
+
+        if (pos < chunk->size && chunk->keys[pos] == item->key) {
+            chunk->items[pos] = item;
+        } else {
+            if (chunk->size == VIEW_CHUNK_SIZE) {
+                Chunk* upper = newChunk(nullptr);
+                unsigned half = VIEW_CHUNK_SIZE / 2;
+                upper->size = VIEW_CHUNK_SIZE - half;
+                std::copy(chunk->keys + half, chunk->keys + VIEW_CHUNK_SIZE, upper->keys);
+                std::copy(chunk->items + half, chunk->items + VIEW_CHUNK_SIZE, upper->items);
+                chunk->size = half;
+                next->chunks.insert(next->chunks.begin() + c + 1, upper);
+                next->firstKeys.insert(next->firstKeys.begin() + c + 1, upper->keys[0]);
+                if (pos > half) {
+                    next->replaceChunk(c, chunk);
+                    chunk = upper;
+                    pos -= half;
+                    c++;
+                }
+            }
+            std::copy_backward(chunk->keys + pos, chunk->keys + chunk->size, chunk->keys + chunk->size + 1);
+            std::copy_backward(chunk->items + pos, chunk->items + chunk->size, chunk->items + chunk->size + 1);
+            chunk->keys[pos] = item->key;
+            chunk->items[pos] = item;
+            chunk->size++;
+            next->count++;
+        }
+        if (next->chunks[c] == chunk) {
+            // The upper half of a split, already in place.
+            next->firstKeys[c] = chunk->keys[0];
+        } else {
+            next->replaceChunk(c, chunk);
+        }
+    }
+    return next;
+}
+
+// This method returns the next version: this one without the item with key, which must be on it.
+// A chunk left empty is dropped, and one left less than a quarter full is merged with a neighbour
+// when the two fit in one chunk.
+MenuView* MenuView::without(FoodKey key) const {
+    MenuView* next = new MenuView(*this);
+    next->version = version + 1;
+
+    std::size_t c = chunkOf(key);
+    Chunk* chunk = newChunk(chunks[c]);
+    unsigned pos = std::lower_bound(chunk->keys, chunk->keys + chunk->size, key) - chunk->keys;
+    std::copy(chunk->keys + pos + 1, chunk->keys + chunk->size, chunk->keys + pos);
+    std::copy(chunk->items + pos + 1, chunk->items + chunk->size, chunk->items + pos);
+    chunk->size--;
+    next->count--;
+
+    if (chunk->size == 0) {
+        releaseChunk(chunk);
+        releaseChunk(next->chunks[c]);
+        next->chunks.erase(next->chunks.begin() + c);
+        next->firstKeys.erase(next->firstKeys.begin() + c);
+    } else {
+        next->replaceChunk(c, chunk);
+        std::size_t lower = c + 1 < next->chunks.size() ? c : c - 1;
+        if (chunk->size < VIEW_CHUNK_SIZE / 4 && next->chunks.size() > 1 &&
+            next->chunks[lower]->size + next->chunks[lower + 1]->size <= VIEW_CHUNK_SIZE) {
+            Chunk* merged = newChunk(next->chunks[lower]);
+            const Chunk& upper = *next->chunks[lower + 1];
+            std::copy(upper.keys, upper.keys + upper.size, merged->keys + merged->size);
+            std::copy(upper.items, upper.items + upper.size, merged->items + merged->size);
+            merged->size += upper.size;
+            releaseChunk(&upper);
+            next->chunks.erase(next->chunks.begin() + lower + 1);
+            next->firstKeys.erase(next->firstKeys.begin() + lower + 1);
+            next->replaceChunk(lower, merged);
+        }
+    }
+    return next;
+}
+
+// This method makes a version holding every item of a list, given its head, in full chunks.
+MenuView* MenuView::build(Node* head, unsigned long long version) {
+    MenuView* view = new MenuView();
+    view->version = version;
+    Chunk* chunk = nullptr;
+
+    for (Node* current = head; current != nullptr; current = current->next) {
+        if (chunk == nullptr || chunk->size == VIEW_CHUNK_SIZE) {
+            chunk = newChunk(nullptr);
+            chunk->size = 0;
+            view->chunks.push_back(chunk);
+            view->firstKeys.push_back(current->data->key);
+        }
+        chunk->keys[chunk->size] = current->data->key;
+        chunk->items[chunk->size] = current->data;
+        chunk->size++;
+        view->count++;
+    }
+    return view;
+}
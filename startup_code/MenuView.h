@@ -0,0 +1,72 @@
+#ifndef MENUVIEW_H
+#define MENUVIEW_H
+
+#include <string>
+#include <vector>
+#include "Node.h"
+
+// Items per chunk of a MenuView. An edit copies one chunk and the list of chunks, so making a new
+// version costs O(VIEW_CHUNK_SIZE + items / VIEW_CHUNK_SIZE) however large the menu is.
+#define VIEW_CHUNK_SIZE 256
+
+// One version of the menu: its items in ID order as they stood between two edits. A LinkedList
+// publishes a new version for every edit instead of changing the one readers may be looking at,
+// so a reader holding a version sees exactly that menu without taking any lock. Items are not
+// changed while they are on a version, except for their stock levels, which every version shares
+// and which change atomically; a price change puts a new copy of the item on the next version.
+//
+// The items are held in chunks of consecutive IDs, and a new version shares every chunk that its
+// edit did not touch with the version before it. Versions are made and deleted only by the thread
+// editing the list, which also keeps count of the versions sharing each chunk.
+class MenuView {
+public:
+    class const_iterator {
+    public:
+        const_iterator(const MenuView* view, std::size_t chunk, unsigned slot) : view(view), chunk(chunk), slot(slot) {}
+        FoodItem* operator*() const { return view->chunks[chunk]->items[slot]; }
+        const_iterator& operator++();
+        bool operator!=(const const_iterator& other) const { return chunk != other.chunk || slot != other.slot; }
+
+    private:
+        const MenuView* view;
+        std::size_t chunk;
+        unsigned slot;
+    };
+
+    MenuView();
+    MenuView(const MenuView& other);
+    ~MenuView();
+
+    unsigned long long getVersion() const { return version; }
+    unsigned getCount() const { return count; }
+    FoodItem* find(FoodKey key) const;
+    FoodItem* find(const std::string& itemId) const;
+    const_iterator begin() const { return const_iterator(this, 0, 0); }
+    const_iterator end() const { return const_iterator(this, chunks.size(), 0); }
+
+    MenuView* with(FoodItem* item) const;
+    MenuView* without(FoodKey key) const;
+    static MenuView* build(Node* head, unsigned long long version);
+
+private:
+    struct Chunk {
+        mutable unsigned versions;  // sharing the chunk; never looked at by readers
+        unsigned size;
+        FoodKey keys[VIEW_CHUNK_SIZE];
+        FoodItem* items[VIEW_CHUNK_SIZE];
+    };
+
+    std::vector<const Chunk*> chunks;
+    std::vector<FoodKey> firstKeys;  // the first key of each chunk, for finding the chunk of a key
+    unsigned count;
+    unsigned long long version;
+
+    MenuView& operator=(const MenuView&);
+
+    std::size_t chunkOf(FoodKey key) const;
+    void replaceChunk(std::size_t c, Chunk* chunk);
+    static Chunk* newChunk(const Chunk* from);
+    static void releaseChunk(const Chunk* chunk);
+};
+
+#endif  // MENUVIEW_H
@@ -0,0 +1,66 @@
+#include <stdexcept>
+#include <limits>
+#include <cstring>
+#include "Money.h"
+
+Money Money::operator+(const Money& other) const {
+    long long result = 0;
+    if (__builtin_add_overflow(value, other.value, &result)) {
+        throw std::overflow_error("Money addition overflowed");
+    }
+    return Money(result);
+}
+
+Money Money::operator-(const Money& other) const {
+    long long result = 0;
+    if (__builtin_sub_overflow(value, other.value, &result)) {
+        throw std::overflow_error("Money subtraction overflowed");
+    }
+    return Money(result);
+}
+
+Money Money::operator*(long long count) const {
+    long long result = 0;
+    if (__builtin_mul_overflow(value, count, &result)) {
+        throw std::overflow_error("Money multiplication overflowed");
+    }
+    return Money(result);
+}
+
+Money Money::operator-() const {
+    if (value == std::numeric_limits<long long>::min()) {
+        throw std::overflow_error("Money negation overflowed");
+    }
+    return Money(-value);
+}
+
+// The digits are written backwards from the end of a local buffer and then moved to the front.
+unsigned Money::format(char* buffer) const {
+    unsigned long long magnitude = isNegative() ? 0ULL - static_cast<unsigned long long>(value)
+                                                : static_cast<unsigned long long>(value);
+    char digits[MONEY_TEXT_LEN];
+    char* pos = digits + sizeof(digits);
+    *--pos = static_cast<char>('0' + magnitude % 10);
+    *--pos = static_cast<char>('0' + magnitude / 10 % 10);
+    *--pos = '.';
+    magnitude /= 100;
+    do {
+        *--pos = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (isNegative()) {
+        *--pos = '-';
+    }
+    unsigned length = static_cast<unsigned>(digits + sizeof(digits) - pos);
+    std::memcpy(buffer, pos, length);
+    buffer[length] = '\0';
+    return length;
+}
+
+// The amount is formatted into a local buffer first so that any field width set on the stream
+// applies to the whole amount rather than just the dollars.
+std::ostream& operator<<(std::ostream& out, const Money& amount) {
+    char buffer[MONEY_TEXT_LEN];
+    amount.format(buffer);
+    return out << buffer;
+}
@@ -0,0 +1,51 @@
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <ostream>
+
+// Room for the longest amount format writes: a sign, 17 dollar digits, the point, two cents digits
+// and the terminating null.
+#define MONEY_TEXT_LEN 24
+
+// An amount of money held as a whole number of cents. All arithmetic is exact integer math and
+// throws std::overflow_error rather than wrapping, so prices, payments and change never drift.
+class Money {
+public:
+    Money() : value(0) {}
+
+    static Money fromCents(long long cents) { return Money(cents); }
+
+    long long asCents() const { return value; }
+    long long dollars() const { return value / 100; }
+    int cents() const { return static_cast<int>(value % 100); }
+    bool isZero() const { return value == 0; }
+    bool isNegative() const { return value < 0; }
+
+    // Writes the amount as operator<< does into buffer, which must hold MONEY_TEXT_LEN characters,
+    // and returns its length.
+    unsigned format(char* buffer) const;
+
+    Money operator+(const Money& other) const;
+    Money operator-(const Money& other) const;
+    Money operator*(long long count) const;
+    Money operator-() const;
+    Money& operator+=(const Money& other) { return *this = *this + other; }
+    Money& operator-=(const Money& other) { return *this = *this - other; }
+
+    bool operator==(const Money& other) const { return value == other.value; }
+    bool operator!=(const Money& other) const { return value != other.value; }
+    bool operator<(const Money& other) const { return value < other.value; }
+    bool operator<=(const Money& other) const { return value <= other.value; }
+    bool operator>(const Money& other) const { return value > other.value; }
+    bool operator>=(const Money& other) const { return value >= other.value; }
+
+private:
+    long long value;
+
+    explicit Money(long long cents) : value(cents) {}
+};
+
+// Writes the amount as dollars and two-digit cents, e.g. "12.50" or "-0.05", without a currency sign.
+std::ostream& operator<<(std::ostream& out, const Money& amount);
+
+#endif  // MONEY_H
\ No newline at end of file
@@ -1,8 +1,88 @@
+#include <cstring>
+#include <algorithm>
 #include "Node.h"
 
-Node::Node() : data(nullptr), next(nullptr) {}
+Node::Node() : data(nullptr), next(nullptr), prev(nullptr) {}
 
+// The FoodItem a node points at shares the node's NodePool slot and is destroyed by the pool.
 Node::~Node() {
-    delete data;
     data = nullptr;
-}
\ No newline at end of file
+}
+
+// Names longer than NAMELEN and IDs longer than IDLEN are truncated; callers validate lengths first.
+FoodItem::FoodItem(const char* id, std::size_t idLength, const char* name, std::size_t nameLength,
+                   const char* description, Money price, unsigned on_hand)
+    : key(0), price(price), on_hand(on_hand), description(description) {
+    idLength = std::min(idLength, static_cast<std::size_t>(IDLEN));
+    nameLength = std::min(nameLength, static_cast<std::size_t>(NAMELEN));
+    std::memcpy(this->id, id, idLength);
+    this->id[idLength] = '\0';
+    std::memcpy(this->name, name, nameLength);
+    this->name[nameLength] = '\0';
+    key = makeKey(this->id, idLength);
+}
+
+FoodItem::FoodItem(const std::string& id, const std::string& name, const char* description, Money price, unsigned on_hand)
+    : FoodItem(id.data(), id.size(), name.data(), name.size(), description, price, on_hand) {}
+
+FoodItem::FoodItem(const std::string& id, const std::string& name, const std::string& description, Money price, unsigned on_hand)
+    : FoodItem(id, name, description.c_str(), price, on_hand) {}
+
+// The ID bytes are packed big-endian into the low end of the key, so a shorter ID always has a smaller
+// key than a longer one and IDs of equal length compare exactly as their strings do.
+FoodKey FoodItem::makeKey(const char* id, std::size_t length) {
+    FoodKey key = 0;
+    for (std::size_t i = 0; i < length && i < sizeof(FoodKey); i++) {
+        key = (key << 8) | static_cast<unsigned char>(id[i]);
+    }
+    return key;
+}
+// The copy keeps its own word, even if this level was attached to a counter.
+StockLevel& StockLevel::operator=(const StockLevel& other) {
+    level.store(other.state->load(std::memory_order_relaxed), std::memory_order_relaxed);
+    state = &level;
+    return *this;
+}
+
+// This method moves the level to counter, which it uses from then on.
+void StockLevel::attach(std::atomic<unsigned long long>* counter) {
+    counter->store(state->load(std::memory_order_relaxed), std::memory_order_relaxed);
+    state = counter;
+}
+
+// This method returns how many units can still be reserved.
+unsigned StockLevel::available() const {
+    unsigned long long word = state->load(std::memory_order_relaxed);
+    return onHand(word) > reserved(word) ? onHand(word) - reserved(word) : 0;
+}
+
+// This method sets the level on hand, as when restocking. Units already reserved stay reserved.
+void StockLevel::set(unsigned units) {
+    unsigned long long word = state->load(std::memory_order_relaxed);
+    while (!state->compare_exchange_weak(word, pack(units, reserved(word)), std::memory_order_acq_rel, std::memory_order_relaxed)) {
+    }
+}
+
+// This method reserves one unit if any are available and returns whether it did.
+bool StockLevel::reserve() {
+    unsigned long long word = state->load(std::memory_order_relaxed);
+    bool taken = false;
+    while (!taken && onHand(word) > reserved(word)) {
+        taken = state->compare_exchange_weak(word, word + 1, std::memory_order_acq_rel, std::memory_order_relaxed);
+    }
+    return taken;
+}
+
+// This method takes a reserved unit out of stock once it has been paid for.
+void StockLevel::commit() {
+    unsigned long long word = state->load(std::memory_order_relaxed);
+    unsigned long long next;
+    do {
+        next = pack(onHand(word) > 0 ? onHand(word) - 1 : 0, reserved(word) - 1);
+    } while (!state->compare_exchange_weak(word, next, std::memory_order_acq_rel, std::memory_order_relaxed));
+}
+
+// This method puts back a reserved unit when its sale is cancelled.
+void StockLevel::release() {
+    state->fetch_sub(1, std::memory_order_acq_rel);
+}
@@ -2,10 +2,13 @@
 #define NODE_H
 
 #include <string>
+#include <cstddef>
+#include <atomic>
 #include "Coin.h"
+#include "Money.h"
 
-// The length of the id string not counting the null terminator
-#define IDLEN 5
+// The maximum length of the id string not counting the null terminator
+#define IDLEN 8
 
 // The maximum length of a food item name not counting the null terminator
 #define NAMELEN 40
@@ -19,34 +22,72 @@
 // The possible default food stock level that all new stock should start at and that we should reset to on restock
 #define DEFAULT_FOOD_STOCK_LEVEL 20
 
-// The number of denominations of currency available in the system 
-#define NUM_DENOMS 8
+// Food IDs packed into an integer so that ordering and equality are single comparisons.
+typedef unsigned long long FoodKey;
+static_assert(IDLEN <= sizeof(FoodKey), "food IDs must fit in a FoodKey");
 
-class Price {
+// Units of an item in stock. A buyer reserves a unit when they choose the item, then either commits
+// it when they have paid, which takes it out of stock, or releases it if they cancel. The level
+// on hand and the number of units reserved share one atomic word, so every step is a single
+// compare-and-swap: the level never drops below zero and two buyers can never both take the last
+// unit. Reserved units still count as on hand until they are committed, so saving in the middle
+// of a sale records the stock as it was before the sale.
+//
+// An item not on a list keeps its word in itself, and a copy of it gets a word of its own with the
+// same value, which keeps FoodItem copyable. An item on a list instead uses a counter its NodePool
+// gives it (attach), which every later version of the item shares (share), so a sale that reserved
+// a unit on one version commits it on the same counter whatever versions come after.
+class StockLevel {
 public:
-    int dollars;
-    int cents;
+    StockLevel(unsigned units = 0) : level(pack(units, 0)), state(&level) {}
+    StockLevel(const StockLevel& other) : level(other.state->load(std::memory_order_relaxed)), state(&level) {}
+    StockLevel& operator=(const StockLevel& other);
 
-    Price(int dollars = 0, int cents = 0) : dollars(dollars), cents(cents) {}
+    unsigned get() const { return onHand(state->load(std::memory_order_relaxed)); }
+    unsigned available() const;
+    void set(unsigned units);
+    bool reserve();
+    void commit();
+    void release();
 
-    static Price parsePrice(double value) {
-        int dollars = static_cast<int>(value);
-        int cents = static_cast<int>((value - dollars) * 100.0 + 0.5); // Adding 0.5 to round to the nearest cent
-        return Price(dollars, cents);
+    void attach(std::atomic<unsigned long long>* counter);
+    void share(const StockLevel& other) { state = other.state; }
+    std::atomic<unsigned long long>* counter() const { return state; }
+    static unsigned reservedOn(const std::atomic<unsigned long long>* counter) {
+        return reserved(counter->load(std::memory_order_acquire));
     }
 
+private:
+    std::atomic<unsigned long long> level;   // for an item not on a list
+    std::atomic<unsigned long long>* state;  // units on hand in the high half, units reserved in the low half
+
+    static unsigned long long pack(unsigned onHand, unsigned reserved) {
+        return static_cast<unsigned long long>(onHand) << 32 | reserved;
+    }
+    static unsigned onHand(unsigned long long word) { return static_cast<unsigned>(word >> 32); }
+    static unsigned reserved(unsigned long long word) { return static_cast<unsigned>(word); }
 };
 
+// The hot part of a food record. Fixed-width buffers keep each item in one contiguous block that
+// lookup and display can scan without chasing pointers. The description is cold, so only a pointer
+// to it is kept here: while an item is being built it borrows the caller's text, and once it is
+// inserted into a LinkedList it points into that list's description storage.
 class FoodItem {
 public:
-    std::string id;
-    std::string name;
-    std::string description;
-    Price price;
-    unsigned on_hand;
-
-    FoodItem(std::string id, std::string name, std::string description, Price price, unsigned on_hand)
-        : id(id), name(name), description(description), price(price), on_hand(on_hand) {}
+    FoodKey key;
+    char id[IDLEN + 1];
+    char name[NAMELEN + 1];
+    Money price;
+    StockLevel on_hand;
+    const char* description;
+
+    FoodItem(const char* id, std::size_t idLength, const char* name, std::size_t nameLength,
+             const char* description, Money price, unsigned on_hand);
+    FoodItem(const std::string& id, const std::string& name, const char* description, Money price, unsigned on_hand);
+    FoodItem(const std::string& id, const std::string& name, const std::string& description, Money price, unsigned on_hand);
+
+    static FoodKey makeKey(const char* id, std::size_t length);
+    static FoodKey makeKey(const std::string& id) { return makeKey(id.data(), id.size()); }
 };
 
 class Node {
@@ -55,6 +96,7 @@ public:
     ~Node();
     FoodItem* data;
     Node* next;
+    Node* prev;
 };
 
 #endif  // NODE_H
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include <new>
+#include "NodePool.h"
+
+NodePool::NodePool()
+    : freeList(nullptr), cursor(nullptr), end(nullptr), nextSlabSize(INITIAL_SLAB_SLOTS), stats(),
+      counterCursor(nullptr), counterEnd(nullptr), nextCounterSlabSize(INITIAL_SLAB_SLOTS) {}
+
+// Live items are destroyed slab by slab in memory order, then each slab is freed with a single call.
+// When FoodItem needs no destructor the walk is skipped and teardown is just the slab frees. Slots
+// past a slab's used mark were never written, so the walk stops there.
+NodePool::~NodePool() {
+    for (const Slab& slab : slabs) {
+        if (!std::is_trivially_destructible<FoodItem>::value) {
+            for (Slot* slot = slab.slots; slot != slab.slots + slab.used; slot++) {
+                if (slot->live) {
+                    reinterpret_cast<FoodItem*>(&slot->item)->~FoodItem();
+                }
+            }
+        }
+        ::operator delete(slab.slots);
+    }
+    for (std::atomic<unsigned long long>* counters : counterSlabs) {
+        delete[] counters;
+    }
+}
+
+// Slab memory is left untouched until slots are handed out, so reserving a large slab costs nothing up front.
+void NodePool::addSlab(unsigned size) {
+    Slab slab = { static_cast<Slot*>(::operator new(sizeof(Slot) * size)), size, 0 };
+    slabs.push_back(slab);
+    cursor = slab.slots;
+    end = slab.slots + size;
+    stats.slabAllocations++;
+    stats.capacity += size;
+    if (nextSlabSize < MAX_SLAB_SLOTS) {
+        nextSlabSize *= 2;
+    }
+}
+
+void NodePool::addCounterSlab(unsigned size) {
+    counterSlabs.push_back(new std::atomic<unsigned long long>[size]);
+    counterCursor = counterSlabs.back();
+    counterEnd = counterCursor + size;
+    stats.slabAllocations++;
+    if (nextCounterSlabSize < MAX_SLAB_SLOTS) {
+        nextCounterSlabSize *= 2;
+    }
+}
+
+// Moves the counters of freed items whose sales have all finished to the free list. Nothing can
+// reserve on such a counter any more, since no reader can still see its item.
+void NodePool::freeUnheldCounters() {
+    std::size_t kept = 0;
+    for (std::atomic<unsigned long long>* counter : heldCounters) {
+        if (StockLevel::reservedOn(counter) == 0) {
+            freeCounters.push_back(counter);
+        } else {
+            heldCounters[kept++] = counter;
+        }
+    }
+    heldCounters.resize(kept);
+}
+
+// Puts the slots of the newest slab that were never handed out on the free list, so that none are
+// lost when a new slab takes over.
+void NodePool::freeRest() {
+    while (cursor != end) {
+        Slot* slot = cursor++;
+        slot->live = false;
+        slot->nextFree = freeList;
+        freeList = slot;
+    }
+    if (!slabs.empty()) {
+        slabs.back().used = slabs.back().size;
+    }
+}
+
+// This method makes sure at least count more nodes can be acquired without touching the system
+// allocator. A new slab only has to make up what the free list and the newest slab cannot give.
+void NodePool::reserve(unsigned count) {
+    unsigned available = static_cast<unsigned>(end - cursor);
+    Slot* slot = freeList;
+    while (slot != nullptr && available < count) {
+        available++;
+        slot = slot->nextFree;
+    }
+    if (available < count) {
+        freeRest();
+        addSlab(count - available);
+    }
+
+    // Stock counters likewise; the rest of the newest counter slab goes on its free list.
+    unsigned counters = static_cast<unsigned>((counterEnd - counterCursor) + freeCounters.size());
+    if (counters < count) {
+        while (counterCursor != counterEnd) {
+            freeCounters.push_back(counterCursor++);
+        }
+        addCounterSlab(count - counters);
+    }
+}
+
+// This method returns a node whose data points at a copy of the given item, with a stock counter of
+// its own that starts at the item's level.
+Node* NodePool::acquire(const FoodItem& data) {
+    Node* node = place(data);
+    std::atomic<unsigned long long>* counter = nullptr;
+    if (freeCounters.empty() && !heldCounters.empty()) {
+        freeUnheldCounters();
+    }
+    if (!freeCounters.empty()) {
+        counter = freeCounters.back();
+        freeCounters.pop_back();
+    } else {
+        if (counterCursor == counterEnd) {
+            addCounterSlab(nextCounterSlabSize);
+        }
+        counter = counterCursor++;
+    }
+    node->data->on_hand.attach(counter);
+    return node;
+}
+
+// This method returns a node whose data points at a copy of the given item, a new version of the
+// item at current, sharing current's stock counter.
+Node* NodePool::acquireReplacement(const FoodItem& data, const Node* current) {
+    Node* node = place(data);
+    node->data->on_hand.share(current->data->on_hand);
+    return node;
+}
+
+// Freed slots are reused first; otherwise the next untouched slot of the newest slab is used.
+Node* NodePool::place(const FoodItem& data) {
+    Slot* slot = nullptr;
+    if (freeList != nullptr) {
+        slot = freeList;
+        freeList = slot->nextFree;
+        stats.reused++;
+    } else {
+        if (cursor == end) {
+            addSlab(nextSlabSize);
+        }
+        slot = cursor++;
+        slabs.back().used++;
+    }
+
+    Node* node = new (&slot->node) Node();
+    node->data = new (&slot->item) FoodItem(data);
+    slot->live = true;
+    stats.acquired++;
+    return node;
+}
+
+// Frees the node along with its stock counter, as when its item is removed.
+void NodePool::release(Node* node) {
+    std::atomic<unsigned long long>* counter = node->data->on_hand.counter();
+    if (StockLevel::reservedOn(counter) == 0) {
+        freeCounters.push_back(counter);
+    } else {
+        heldCounters.push_back(counter);
+    }
+    releaseReplaced(node);
+}
+
+// Frees a node whose stock counter a newer version of its item still uses.
+void NodePool::releaseReplaced(Node* node) {
+    Slot* slot = reinterpret_cast<Slot*>(node);
+    node->data->~FoodItem();
+    node->~Node();
+    slot->live = false;
+    slot->nextFree = freeList;
+    freeList = slot;
+    stats.released++;
+}
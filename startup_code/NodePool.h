@@ -0,0 +1,81 @@
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <vector>
+#include <atomic>
+#include <type_traits>
+#include "Node.h"
+
+// Number of slots in the first slab. Later slabs double in size up to MAX_SLAB_SLOTS.
+#define INITIAL_SLAB_SLOTS 64
+#define MAX_SLAB_SLOTS 65536
+
+// Counters describing how the pool has been used, so allocation savings can be measured.
+struct PoolStats {
+    unsigned long slabAllocations;  // calls to the system allocator
+    unsigned long acquired;         // nodes handed out
+    unsigned long released;         // nodes given back
+    unsigned long reused;           // acquisitions served from a previously released slot
+    unsigned long capacity;         // total slots across all slabs
+};
+
+// Slab allocator for list nodes. Each slot holds a Node and the FoodItem it points at side by side,
+// so one acquire replaces two heap allocations and neighbouring nodes share cache lines.
+// Released slots go on a free list for reuse and every slab is returned in one go on destruction.
+//
+// Each item's stock level is kept apart from its slot, in a counter of its own (see StockLevel).
+// acquireReplacement makes a node for a new version of an item that shares the counter of the
+// version it replaces; releaseReplaced frees such an old version but leaves the counter, which is
+// freed with the last version, by release. A counter with units still reserved on it when its item
+// is freed, by a sale that has not finished, is only reused once those units are committed or
+// released.
+class NodePool {
+public:
+    NodePool();
+    ~NodePool();
+
+    Node* acquire(const FoodItem& data);
+    Node* acquireReplacement(const FoodItem& data, const Node* current);
+    void release(Node* node);
+    void releaseReplaced(Node* node);
+    void reserve(unsigned count);
+    const PoolStats& getStats() const { return stats; }
+
+private:
+    struct Slot {
+        Node node;  // must stay first so a Node* converts back to its Slot*
+        typename std::aligned_storage<sizeof(FoodItem), alignof(FoodItem)>::type item;
+        Slot* nextFree;
+        bool live;
+    };
+
+    struct Slab {
+        Slot* slots;
+        unsigned size;
+        unsigned used;  // slots from the start that have been handed out or put on the free list
+    };
+
+    std::vector<Slab> slabs;
+    Slot* freeList;
+    Slot* cursor;
+    Slot* end;
+    unsigned nextSlabSize;
+    PoolStats stats;
+    std::vector<std::atomic<unsigned long long>*> counterSlabs;  // stock counters, slab by slab as for slots
+    std::vector<std::atomic<unsigned long long>*> freeCounters;
+    std::vector<std::atomic<unsigned long long>*> heldCounters;  // freed with units still reserved
+    std::atomic<unsigned long long>* counterCursor;
+    std::atomic<unsigned long long>* counterEnd;
+    unsigned nextCounterSlabSize;
+
+    NodePool(const NodePool&);
+    NodePool& operator=(const NodePool&);
+
+    void addSlab(unsigned size);
+    void freeRest();
+    void addCounterSlab(unsigned size);
+    void freeUnheldCounters();
+    Node* place(const FoodItem& data);
+};
+
+#endif  // NODEPOOL_H
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <new>
+#include "PriceIndex.h"
+
+PriceIndex::PriceIndex() : built(false), head(nullptr), size(0), random(0x9e3779b97f4a7c15ull) {
+    head = newEntry(PRICE_INDEX_LEVELS);
+    for (unsigned level = 0; level < PRICE_INDEX_LEVELS; level++) {
+        head->links[level].width = 1;
+    }
+}
+
+PriceIndex::~PriceIndex() {
+    Entry* current = head;
+    while (current != nullptr) {
+        Entry* next = current->links[0].next;
+        ::operator delete(current);
+        current = next;
+    }
+}
+
+// This method indexes every item of a list, given its head. The entries are sorted as plain
+// values, so the sort does not chase pointers, then linked in order on the end of every level
+// they reach.
+void PriceIndex::build(Node* list, unsigned count) {
+    std::vector<Entry> sorted;
+    sorted.reserve(count);
+    for (Node* current = list; current != nullptr; current = current->next) {
+        sorted.push_back(Entry{current->data->price, current->data->key, current, 0, nullptr});
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Entry& a, const Entry& b) {
+        return a.price < b.price || (a.price == b.price && a.key < b.key);
+    });
+
+    Entry* last[PRICE_INDEX_LEVELS];
+    unsigned lastAt[PRICE_INDEX_LEVELS];
+    std::fill(last, last + PRICE_INDEX_LEVELS, head);
+    std::fill(lastAt, lastAt + PRICE_INDEX_LEVELS, 0u);
+    for (std::size_t i = 0; i < sorted.size(); i++) {
+        unsigned at = static_cast<unsigned>(i) + 1;
+        Entry* entry = newEntry(randomHeight());
+        entry->price = sorted[i].price;
+        entry->key = sorted[i].key;
+        entry->node = sorted[i].node;
+        for (unsigned level = 0; level < entry->height; level++) {
+            last[level]->links[level].next = entry;
+            last[level]->links[level].width = at - lastAt[level];
+            last[level] = entry;
+            lastAt[level] = at;
+        }
+    }
+    size = static_cast<unsigned>(sorted.size());
+    for (unsigned level = 0; level < PRICE_INDEX_LEVELS; level++) {
+        last[level]->links[level].width = size + 1 - lastAt[level];
+    }
+    built = true;
+}
+
+void PriceIndex::add(Node* node) {
+    if (built) {
+        Entry* before[PRICE_INDEX_LEVELS];
+        unsigned positions[PRICE_INDEX_LEVELS];
+        unsigned at = walk(node->data->price, node->data->key, before, positions) + 1;
+        Entry* entry = newEntry(randomHeight());
+        entry->price = node->data->price;
+        entry->key = node->data->key;
+        entry->node = node;
+
+        for (unsigned level = 0; level < PRICE_INDEX_LEVELS; level++) {
+            Link& link = before[level]->links[level];
+            if (level < entry->height) {
+                entry->links[level].next = link.next;
+                entry->links[level].width = positions[level] + link.width + 1 - at;
+                link.next = entry;
+                link.width = at - positions[level];
+            } else {
+                link.width++;
+            }
+        }
+        size++;
+    }
+}
+
+// The node must still hold its item, with the price it was indexed at.
+void PriceIndex::remove(Node* node) {
+    if (built) {
+        Entry* before[PRICE_INDEX_LEVELS];
+        unsigned positions[PRICE_INDEX_LEVELS];
+        walk(node->data->price, node->data->key, before, positions);
+        Entry* entry = before[0]->links[0].next;
+
+        if (entry != nullptr && entry->key == node->data->key) {
+            for (unsigned level = 0; level < PRICE_INDEX_LEVELS; level++) {
+                Link& link = before[level]->links[level];
+                if (level < entry->height) {
+                    link.next = entry->links[level].next;
+                    link.width += entry->links[level].width - 1;
+                } else {
+                    link.width--;
+                }
+            }
+            ::operator delete(entry);
+            size--;
+        }
+    }
+}
+
+// Returns the number of items priced from low to high, both included.
+unsigned PriceIndex::count(Money low, Money high) const {
+    return low <= high ? countUpTo(high, true) - countUpTo(low, false) : 0;
+}
+
+// This method fills matches with up to limit items priced from low to high, cheapest first, after
+// skipping the first skip of them.
+void PriceIndex::list(Money low, Money high, unsigned skip, unsigned limit, std::vector<Node*>& matches) const {
+    unsigned target = countUpTo(low, false) + skip + 1;
+    const Entry* current = head;
+    unsigned at = 0;
+    matches.clear();
+
+    for (unsigned level = PRICE_INDEX_LEVELS; level-- > 0;) {
+        while (current->links[level].next != nullptr && at + current->links[level].width <= target) {
+            at += current->links[level].width;
+            current = current->links[level].next;
+        }
+    }
+    if (at == target) {
+        while (current != nullptr && current->price <= high && matches.size() < limit) {
+            matches.push_back(current->node);
+            current = current->links[0].next;
+        }
+    }
+}
+
+// This method finds, on every level, the last entry before the item with this price and key would
+// go, and its position, and returns the position of the last entry before it on the bottom level.
+unsigned PriceIndex::walk(Money price, FoodKey key, Entry** before, unsigned* positions) const {
+    Entry* current = head;
+    unsigned at = 0;
+    for (unsigned level = PRICE_INDEX_LEVELS; level-- > 0;) {
+        const Entry* next = current->links[level].next;
+        while (next != nullptr && (next->price < price || (next->price == price && next->key < key))) {
+            at += current->links[level].width;
+            current = current->links[level].next;
+            next = current->links[level].next;
+        }
+        before[level] = current;
+        positions[level] = at;
+    }
+    return at;
+}
+
+// Returns the number of items priced below price, or up to it if inclusive is set.
+unsigned PriceIndex::countUpTo(Money price, bool inclusive) const {
+    const Entry* current = head;
+    unsigned at = 0;
+    for (unsigned level = PRICE_INDEX_LEVELS; level-- > 0;) {
+        const Entry* next = current->links[level].next;
+        while (next != nullptr && (next->price < price || (inclusive && next->price == price))) {
+            at += current->links[level].width;
+            current = next;
+            next = current->links[level].next;
+        }
+    }
+    return at;
+}
+
+// An entry and its links are one allocation, sized for its height.
+PriceIndex::Entry* PriceIndex::newEntry(unsigned height) {
+    Entry* entry = new (::operator new(sizeof(Entry) + height * sizeof(Link))) Entry();
+    entry->node = nullptr;
+    entry->height = height;
+    entry->links = reinterpret_cast<Link*>(entry + 1);
+    for (unsigned level = 0; level < height; level++) {
+        entry->links[level] = Link{nullptr, 0};
+    }
+    return entry;
+}
+
+// Each level up is reached by a quarter of the entries on the level below. The sequence is fixed,
+// so the same edits always build the same list.
+unsigned PriceIndex::randomHeight() {
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    unsigned long long bits = random;
+    unsigned height = 1;
+    while (height < PRICE_INDEX_LEVELS && (bits & 3) == 0) {
+        height++;
+        bits >>= 2;
+    }
+    return height;
+}
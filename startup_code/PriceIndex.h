@@ -0,0 +1,63 @@
+#ifndef PRICEINDEX_H
+#define PRICEINDEX_H
+
+#include <vector>
+#include "Node.h"
+
+// Levels of the skip list. Each level links about a quarter of the entries on the level below, so
+// this is room for far more items than any menu holds.
+#define PRICE_INDEX_LEVELS 16
+
+// Food items in order of price, cheapest first, and items of the same price in ID order. Counts the
+// items priced within a range in O(log n), and lists them from any position in the range in
+// O(log n + k) for k items listed, so a page of them costs the same wherever it falls.
+//
+// The items are kept in an indexable skip list: every link also records how many items it passes
+// over, so the walk that finds a price counts the items before it on the way, and the item at a
+// given position is found the same way. Adding and removing an item are O(log n).
+//
+// Nothing is indexed until build is called; until then add and remove do nothing. An indexed
+// item's price must not change in place; a repriced item is removed and the new one added.
+class PriceIndex {
+public:
+    PriceIndex();
+    ~PriceIndex();
+
+    bool isBuilt() const { return built; }
+    void build(Node* list, unsigned count);
+    void add(Node* node);
+    void remove(Node* node);
+    unsigned count(Money low, Money high) const;
+    void list(Money low, Money high, unsigned skip, unsigned limit, std::vector<Node*>& matches) const;
+
+private:
+    struct Entry;
+
+    struct Link {
+        Entry* next;     // nullptr after the last entry
+        unsigned width;  // positions from this entry to next; the position after the last is size + 1
+    };
+
+    struct Entry {
+        Money price;
+        FoodKey key;
+        Node* node;
+        unsigned height;
+        Link* links;  // height of them, allocated with the entry
+    };
+
+    bool built;
+    Entry* head;  // at position 0, before every entry, with a link on every level
+    unsigned size;
+    unsigned long long random;
+
+    PriceIndex(const PriceIndex&);
+    PriceIndex& operator=(const PriceIndex&);
+
+    unsigned walk(Money price, FoodKey key, Entry** before, unsigned* positions) const;
+    unsigned countUpTo(Money price, bool inclusive) const;
+    Entry* newEntry(unsigned height);
+    unsigned randomHeight();
+};
+
+#endif  // PRICEINDEX_H
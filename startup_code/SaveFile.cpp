@@ -0,0 +1,139 @@
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "SaveFile.h"
+
+SaveFile::SaveFile(const std::string& filename)
+    : target(filename), temp(filename + SAVE_TEMP_SUFFIX), fd(-1), failed(false) {
+    fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Error opening file for writing: " << temp << ": " << std::strerror(errno) << std::endl;
+    }
+    buffer.reserve(SAVE_BUFFER_BYTES);
+}
+
+SaveFile::~SaveFile() {
+    if (fd >= 0) {
+        close(fd);
+        unlink(temp.c_str());
+    }
+}
+
+void SaveFile::write(const char* data, std::size_t length) {
+    buffer.append(data, length);
+    if (buffer.size() >= SAVE_BUFFER_BYTES) {
+        flush();
+    }
+}
+
+// This method overwrites bytes already written, such as a header field that is only known at the end.
+void SaveFile::patch(off_t offset, const void* data, std::size_t length) {
+    flush();
+    if (fd >= 0 && !failed && pwrite(fd, data, length, offset) != static_cast<ssize_t>(length)) {
+        failed = true;
+    }
+}
+
+void SaveFile::flush() {
+    std::size_t written = 0;
+    while (fd >= 0 && !failed && written < buffer.size()) {
+        ssize_t result = ::write(fd, buffer.data() + written, buffer.size() - written);
+        if (result > 0) {
+            written += result;
+        } else if (result < 0 && errno != EINTR) {
+            failed = true;
+        }
+    }
+    buffer.clear();
+}
+
+// This method puts the file in place, replacing any file of the same name. Returns false, leaving
+// the old file as it was, if anything could not be written.
+bool SaveFile::commit() {
+    flush();
+    bool committed = fd >= 0 && !failed && fsync(fd) == 0;
+    if (fd >= 0) {
+        committed = close(fd) == 0 && committed;
+        fd = -1;
+    }
+    committed = committed && rename(temp.c_str(), target.c_str()) == 0 && syncDirectory(target);
+    if (!committed) {
+        std::cerr << "Error writing file: " << target << ": " << std::strerror(errno) << std::endl;
+        unlink(temp.c_str());
+    }
+    return committed;
+}
+
+// This method puts the staged copy of a file in place, if there is one. Doing it again after it
+// has been done does nothing, so a save interrupted here can simply be installed again.
+bool SaveFile::install(const std::string& filename) {
+    std::string staged = filename + SAVE_STAGED_SUFFIX;
+    bool installed = !exists(staged) || (rename(staged.c_str(), filename.c_str()) == 0 && syncDirectory(filename));
+    if (!installed) {
+        std::cerr << "Error putting " << staged << " in place: " << std::strerror(errno) << std::endl;
+    }
+    return installed;
+}
+
+// This method removes the staged copy of a file and anything left of a write cut short.
+void SaveFile::discard(const std::string& filename) {
+    std::string staged = filename + SAVE_STAGED_SUFFIX;
+    unlink((staged + SAVE_TEMP_SUFFIX).c_str());
+    unlink(staged.c_str());
+    unlink((filename + SAVE_TEMP_SUFFIX).c_str());
+}
+
+bool SaveFile::exists(const std::string& filename) {
+    return access(filename.c_str(), F_OK) == 0;
+}
+
+// Returns false if the file is there but could not be removed.
+bool SaveFile::remove(const std::string& filename) {
+    bool removed = unlink(filename.c_str()) == 0 || errno == ENOENT;
+    if (!removed) {
+        std::cerr << "Error removing " << filename << ": " << std::strerror(errno) << std::endl;
+    }
+    return removed;
+}
+
+// This method cuts a file down to its first keep bytes, adds data after them and syncs it. The
+// file is created if it does not exist.
+bool SaveFile::append(const std::string& filename, off_t keep, const char* data, std::size_t length) {
+    bool created = !exists(filename);
+    int out = ::open(filename.c_str(), O_WRONLY | O_CREAT, 0644);
+    bool appended = out >= 0 && ftruncate(out, keep) == 0;
+    std::size_t written = 0;
+    while (appended && written < length) {
+        ssize_t result = pwrite(out, data + written, length - written, keep + written);
+        if (result > 0) {
+            written += result;
+        } else if (result < 0 && errno != EINTR) {
+            appended = false;
+        }
+    }
+    appended = appended && fdatasync(out) == 0;
+    if (out >= 0) {
+        appended = close(out) == 0 && appended;
+    }
+    appended = appended && (!created || syncDirectory(filename));
+    if (!appended) {
+        std::cerr << "Error appending to " << filename << ": " << std::strerror(errno) << std::endl;
+    }
+    return appended;
+}
+
+// A rename or a new file is only durable once the directory holding it has been synced.
+bool SaveFile::syncDirectory(const std::string& filename) {
+    std::string::size_type slash = filename.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : filename.substr(0, slash);
+    int dir = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    bool synced = dir >= 0 && fsync(dir) == 0;
+    if (dir >= 0) {
+        close(dir);
+    }
+    return synced;
+}
@@ -0,0 +1,52 @@
+#ifndef SAVEFILE_H
+#define SAVEFILE_H
+
+#include <string>
+#include <cstddef>
+#include <sys/types.h>
+
+// A file being written goes to its name with SAVE_TEMP_SUFFIX until it is complete. A file that is
+// complete but not yet in place, as part of a save that has not been committed, has its name with
+// SAVE_STAGED_SUFFIX.
+#define SAVE_TEMP_SUFFIX ".tmp"
+#define SAVE_STAGED_SUFFIX ".new"
+
+// Text written out at a time.
+#define SAVE_BUFFER_BYTES 65536
+
+// Writes a whole file so that a crash never leaves it torn. Everything is written to a temporary
+// file, which commit syncs and renames over the target; the directory is then synced so that the
+// rename survives a crash too. Until commit the target is untouched, and a file that is destroyed
+// without being committed removes its temporary file.
+class SaveFile {
+public:
+    explicit SaveFile(const std::string& filename);
+    ~SaveFile();
+
+    bool isOpen() const { return fd >= 0; }
+    void write(const char* data, std::size_t length);
+    void write(const std::string& text) { write(text.data(), text.size()); }
+    void patch(off_t offset, const void* data, std::size_t length);
+    bool commit();
+
+    static bool install(const std::string& filename);
+    static void discard(const std::string& filename);
+    static bool exists(const std::string& filename);
+    static bool remove(const std::string& filename);
+    static bool append(const std::string& filename, off_t keep, const char* data, std::size_t length);
+
+private:
+    std::string target;
+    std::string temp;
+    int fd;
+    bool failed;
+    std::string buffer;
+
+    SaveFile(const SaveFile&);
+    SaveFile& operator=(const SaveFile&);
+
+    void flush();
+    static bool syncDirectory(const std::string& filename);
+};
+
+#endif  // SAVEFILE_H
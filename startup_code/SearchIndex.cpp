@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <cstring>
+#include "SearchIndex.h"
+
+namespace {
+
+bool isWordChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
+
+char fold(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+unsigned trigramAt(const std::string& word, std::size_t pos) {
+    return static_cast<unsigned char>(word[pos]) << 16 | static_cast<unsigned char>(word[pos + 1]) << 8 |
+           static_cast<unsigned char>(word[pos + 2]);
+}
+
+// Returns whether the folded word occurs in text, only at the start of a word of text if wordStart is set.
+bool containsFolded(const char* text, const std::string& word, bool wordStart) {
+    bool found = false;
+    for (std::size_t pos = 0; text[pos] != '\0' && !found; pos++) {
+        if (!wordStart || pos == 0 || !isWordChar(text[pos - 1])) {
+            std::size_t matched = 0;
+            while (matched < word.size() && fold(text[pos + matched]) == word[matched]) {
+                matched++;
+            }
+            found = matched == word.size();
+        }
+    }
+    return found;
+}
+
+bool byId(const Node* a, const Node* b) {
+    return a->data->key < b->data->key;
+}
+
+}
+
+SearchIndex::SearchIndex() : built(false), trie(1, TrieNode{'\0', 0, 0, NO_WORD, 0}) {}
+
+// This method indexes every item of a list, given its head. The list is in ID order, so every item
+// goes on the end of its words' lists.
+void SearchIndex::build(Node* head, unsigned count) {
+    built = true;
+    descWordIds.reserve(count);
+    Node* current = head;
+    while (current != nullptr) {
+        index(current);
+        current = current->next;
+    }
+}
+
+void SearchIndex::add(Node* node) {
+    if (built) {
+        index(node);
+    }
+}
+
+// The node must still hold its item, so call this before the node is released.
+void SearchIndex::remove(Node* node) {
+    if (built) {
+        unindex(node);
+    }
+}
+
+// This method fills matches with up to limit items matching every word of the query, best first.
+// The limit is meant to be a screenful: each candidate is checked against the matches so far.
+void SearchIndex::search(const std::string& query, unsigned limit, std::vector<Node*>& matches) const {
+    std::vector<std::string> words;
+    splitWords(query.c_str(), words);
+    matches.clear();
+
+    if (!words.empty() && limit > 0) {
+        std::vector<WordMatches> found(words.size());
+        std::size_t driver = 0;
+        for (std::size_t i = 0; i < words.size(); i++) {
+            findMatches(words[i], found[i]);
+            if (found[i].entries < found[driver].entries) {
+                driver = i;
+            }
+        }
+        visitMatches(found[driver], [&](Node* node) {
+            bool wanted = std::find(matches.begin(), matches.end(), node) == matches.end();
+            for (std::size_t i = 0; i < words.size() && wanted; i++) {
+                wanted = i == driver || itemHas(*node->data, words[i]);
+            }
+            if (wanted) {
+                matches.push_back(node);
+            }
+            return matches.size() < limit;
+        });
+    }
+}
+
+// This method looks up one query word. Description words containing it must contain its rarest
+// trigram, so only the words listed under that trigram are checked.
+void SearchIndex::findMatches(const std::string& word, WordMatches& found) const {
+    found.word = word;
+    found.trieNode = findTrie(word);
+    found.entries = found.trieNode != 0 ? trie[found.trieNode].items : 0;
+    found.descWords.clear();
+
+    const std::vector<unsigned>* rarest = nullptr;
+    bool missing = word.size() < SEARCH_NGRAM;
+    for (std::size_t pos = 0; pos + SEARCH_NGRAM <= word.size() && !missing; pos++) {
+        std::unordered_map<unsigned, std::vector<unsigned>>::const_iterator listed = trigrams.find(trigramAt(word, pos));
+        if (listed == trigrams.end()) {
+            missing = true;
+        } else if (rarest == nullptr || listed->second.size() < rarest->size()) {
+            rarest = &listed->second;
+        }
+    }
+    if (!missing) {
+        for (unsigned id : *rarest) {
+            if (!descWords[id].items.empty() && descWords[id].text.find(word) != std::string::npos) {
+                found.descWords.push_back(id);
+                found.entries += descWords[id].items.size();
+            }
+        }
+    }
+    std::sort(found.descWords.begin(), found.descWords.end(), [this](unsigned a, unsigned b) {
+        const std::string& first = descWords[a].text;
+        const std::string& second = descWords[b].text;
+        return first.size() != second.size() ? first.size() < second.size() : first < second;
+    });
+}
+
+// This method calls visit on the items matching one word in rank order, the same item possibly
+// more than once, until visit returns false. It returns false if visit stopped it. Name words
+// starting with the word are found by a breadth-first walk of the trie below it, which yields
+// shorter words first.
+template <typename Visit>
+bool SearchIndex::visitMatches(const WordMatches& found, Visit visit) const {
+    bool going = true;
+
+    if (found.trieNode != 0) {
+        std::vector<unsigned> level(1, found.trieNode);
+        std::vector<unsigned> nextLevel;
+        while (going && !level.empty()) {
+            for (std::size_t i = 0; i < level.size() && going; i++) {
+                const TrieNode& trieNode = trie[level[i]];
+                if (trieNode.word != NO_WORD) {
+                    const Postings& items = nameWords[trieNode.word];
+                    for (std::size_t n = 0; n < items.size() && going; n++) {
+                        going = visit(items[n]);
+                    }
+                }
+                for (unsigned child = trieNode.firstChild; child != 0; child = trie[child].nextSibling) {
+                    if (trie[child].items > 0) {
+                        nextLevel.push_back(child);
+                    }
+                }
+            }
+            level.swap(nextLevel);
+            nextLevel.clear();
+        }
+    }
+
+    for (std::size_t i = 0; i < found.descWords.size() && going; i++) {
+        const Postings& items = descWords[found.descWords[i]].items;
+        for (std::size_t n = 0; n < items.size() && going; n++) {
+            going = visit(items[n]);
+        }
+    }
+    return going;
+}
+
+// This method returns the trie node reached by spelling out the prefix, or 0 if there is none.
+unsigned SearchIndex::findTrie(const std::string& prefix) const {
+    unsigned current = 0;
+    bool found = true;
+    for (std::size_t i = 0; i < prefix.size() && found; i++) {
+        unsigned child = trie[current].firstChild;
+        while (child != 0 && trie[child].letter < prefix[i]) {
+            child = trie[child].nextSibling;
+        }
+        found = child != 0 && trie[child].letter == prefix[i];
+        current = found ? child : 0;
+    }
+    return current;
+}
+
+// This method returns the index of a name word, adding the word to the trie if it is new.
+unsigned SearchIndex::nameWord(const std::string& word) {
+    unsigned current = 0;
+    for (char letter : word) {
+        unsigned previous = 0;
+        unsigned child = trie[current].firstChild;
+        while (child != 0 && trie[child].letter < letter) {
+            previous = child;
+            child = trie[child].nextSibling;
+        }
+        if (child == 0 || trie[child].letter != letter) {
+            unsigned added = static_cast<unsigned>(trie.size());
+            trie.push_back(TrieNode{letter, 0, child, NO_WORD, 0});
+            if (previous == 0) {
+                trie[current].firstChild = added;
+            } else {
+                trie[previous].nextSibling = added;
+            }
+            child = added;
+        }
+        current = child;
+    }
+    if (trie[current].word == NO_WORD) {
+        trie[current].word = static_cast<unsigned>(nameWords.size());
+        nameWords.push_back(Postings());
+    }
+    return trie[current].word;
+}
+
+// This method adds change to the entry count of every trie node on the path of a name word that is
+// already in the trie, including the root.
+void SearchIndex::countNameEntries(const std::string& word, int change) {
+    unsigned current = 0;
+    trie[current].items += change;
+    for (char letter : word) {
+        current = trie[current].firstChild;
+        while (trie[current].letter != letter) {
+            current = trie[current].nextSibling;
+        }
+        trie[current].items += change;
+    }
+}
+
+// This method returns the index of a description word, listing a new word under each of its trigrams.
+unsigned SearchIndex::descWord(const std::string& word) {
+    std::pair<std::unordered_map<std::string, unsigned>::iterator, bool> entry =
+        descWordIds.insert(std::make_pair(word, static_cast<unsigned>(descWords.size())));
+    if (entry.second) {
+        descWords.push_back(DescWord{word, Postings()});
+        std::vector<unsigned> wordTrigrams;
+        for (std::size_t pos = 0; pos + SEARCH_NGRAM <= word.size(); pos++) {
+            wordTrigrams.push_back(trigramAt(word, pos));
+        }
+        std::sort(wordTrigrams.begin(), wordTrigrams.end());
+        wordTrigrams.erase(std::unique(wordTrigrams.begin(), wordTrigrams.end()), wordTrigrams.end());
+        for (unsigned trigram : wordTrigrams) {
+            trigrams[trigram].push_back(entry.first->second);
+        }
+    }
+    return entry.first->second;
+}
+
+void SearchIndex::index(Node* node) {
+    std::vector<std::string> words;
+    splitWords(node->data->name, words);
+    for (const std::string& word : words) {
+        insertPosting(nameWords[nameWord(word)], node);
+        countNameEntries(word, 1);
+    }
+    splitWords(node->data->description, words);
+    for (const std::string& word : words) {
+        if (word.size() >= SEARCH_NGRAM) {
+            insertPosting(descWords[descWord(word)].items, node);
+        }
+    }
+}
+
+void SearchIndex::unindex(Node* node) {
+    std::vector<std::string> words;
+    splitWords(node->data->name, words);
+    for (const std::string& word : words) {
+        unsigned found = findTrie(word);
+        if (found != 0 && trie[found].word != NO_WORD && erasePosting(nameWords[trie[found].word], node)) {
+            countNameEntries(word, -1);
+        }
+    }
+    splitWords(node->data->description, words);
+    for (const std::string& word : words) {
+        std::unordered_map<std::string, unsigned>::const_iterator found = descWordIds.find(word);
+        if (found != descWordIds.end()) {
+            erasePosting(descWords[found->second].items, node);
+        }
+    }
+}
+
+// This method replaces words with the distinct words of text, folded to lower case.
+void SearchIndex::splitWords(const char* text, std::vector<std::string>& words) {
+    words.clear();
+    std::size_t pos = 0;
+    while (text[pos] != '\0') {
+        if (isWordChar(text[pos])) {
+            std::size_t start = pos;
+            while (isWordChar(text[pos])) {
+                pos++;
+            }
+            words.push_back(std::string(text + start, pos - start));
+            std::transform(words.back().begin(), words.back().end(), words.back().begin(), fold);
+        } else {
+            pos++;
+        }
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+}
+
+// This method checks one query word against an item's own text, the same way the index would match it.
+bool SearchIndex::itemHas(const FoodItem& item, const std::string& word) {
+    return containsFolded(item.name, word, true) ||
+           (word.size() >= SEARCH_NGRAM && containsFolded(item.description, word, false));
+}
+
+// Items are mostly added in ID order, so the common case is appending.
+void SearchIndex::insertPosting(Postings& items, Node* node) {
+    if (items.empty() || byId(items.back(), node)) {
+        items.push_back(node);
+    } else {
+        items.insert(std::lower_bound(items.begin(), items.end(), node, byId), node);
+    }
+}
+
+// Returns false if the node was not in the list.
+bool SearchIndex::erasePosting(Postings& items, Node* node) {
+    Postings::iterator found = std::lower_bound(items.begin(), items.end(), node, byId);
+    bool erased = found != items.end() && *found == node;
+    if (erased) {
+        items.erase(found);
+    }
+    return erased;
+}
@@ -0,0 +1,92 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "Node.h"
+
+// Query words shorter than this are matched against names only, as the description index has
+// nothing to offer for them.
+#define SEARCH_NGRAM 3
+
+// Finds food items by the words of their names and descriptions. Text is split into words of
+// letters and digits and compared without regard to case.
+//
+// Name words are kept in a prefix trie, so a query word matches any name word it begins. Description
+// words are indexed by their trigrams, so a query word of at least SEARCH_NGRAM characters also
+// matches any description word that contains it. Each indexed word keeps the nodes of the items
+// using it in ID order. An item matches a query when every query word matches its name or
+// description.
+//
+// Matches are ranked: items whose name has the query word itself, then items whose name has a longer
+// word starting with it (shorter words first), then items matching on the description; items with
+// the same rank come in ID order. A search walks the candidates for the query word with the fewest
+// of them in that order, checking the other words against each, and stops as soon as it has enough.
+// Its cost therefore depends on the number of results wanted and on the rarest query word, not on
+// the size of the menu.
+//
+// Nothing is indexed until build is called; until then add and remove do nothing. Words that no
+// item uses any more stay in the trie and trigram lists with no items and are skipped.
+class SearchIndex {
+public:
+    SearchIndex();
+
+    bool isBuilt() const { return built; }
+    void build(Node* head, unsigned count);
+    void add(Node* node);
+    void remove(Node* node);
+    void search(const std::string& query, unsigned limit, std::vector<Node*>& matches) const;
+
+private:
+    typedef std::vector<Node*> Postings;  // kept in ID order
+
+    // One character of the trie. Children of a node form a list in character order.
+    struct TrieNode {
+        char letter;
+        unsigned firstChild;   // 0 when there are none, as the root is never a child
+        unsigned nextSibling;  // 0 at the end of the list
+        unsigned word;         // index into nameWords, or NO_WORD
+        unsigned items;        // entries in the item lists of this node's words and the words below it
+    };
+
+    struct DescWord {
+        std::string text;
+        Postings items;
+    };
+
+    // Where the items matching one query word are listed.
+    struct WordMatches {
+        std::string word;
+        unsigned trieNode;                // the name words starting with it, or 0 if there are none
+        std::vector<unsigned> descWords;  // the description words containing it, best first
+        unsigned long long entries;       // item list entries to go through, counting an item once per word
+    };
+
+    static const unsigned NO_WORD = ~0u;
+
+    bool built;
+    std::vector<TrieNode> trie;
+    std::vector<Postings> nameWords;
+    std::vector<DescWord> descWords;
+    std::unordered_map<std::string, unsigned> descWordIds;
+    std::unordered_map<unsigned, std::vector<unsigned>> trigrams;  // to the description words containing each
+
+    unsigned findTrie(const std::string& prefix) const;
+    unsigned nameWord(const std::string& word);
+    unsigned descWord(const std::string& word);
+    void countNameEntries(const std::string& word, int change);
+    void index(Node* node);
+    void unindex(Node* node);
+
+    void findMatches(const std::string& word, WordMatches& found) const;
+    template <typename Visit>
+    bool visitMatches(const WordMatches& found, Visit visit) const;
+
+    static void splitWords(const char* text, std::vector<std::string>& words);
+    static bool itemHas(const FoodItem& item, const std::string& word);
+    static void insertPosting(Postings& items, Node* node);
+    static bool erasePosting(Postings& items, Node* node);
+};
+
+#endif  // SEARCHINDEX_H
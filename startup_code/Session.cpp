@@ -0,0 +1,445 @@
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include "Session.h"
+#include "Stats.h"
+
+// Failed attempts at removing an item before the session goes back to the main menu, as at the
+// terminal.
+#define SESSION_REMOVE_ATTEMPTS 5
+
+namespace {
+
+// The main menu of a session served to a client, which has nothing that needs the machine itself.
+const SessionOption SERVED_MENU[] = {
+    { "Display Meal Options", SESSION_DISPLAY, false },
+    { "Purchase Meal", SESSION_PURCHASE, false },
+    { "End Session", SESSION_END, false },
+    { "Add Food", SESSION_ADD, true },
+    { "Remove Food", SESSION_REMOVE, true },
+    { "Display Balance", SESSION_BALANCE, true },
+    { "Restock Food", SESSION_RESTOCK, true }
+};
+
+void appendMoney(std::string& text, Money amount) {
+    char digits[MONEY_TEXT_LEN];
+    text += '$';
+    text.append(digits, amount.format(digits));
+}
+
+// Writes the change one entry per coin, largest first, as the terminal does.
+void appendChange(std::string& text, const int* change) {
+    char coin[16];
+    text += "Your change is ";
+    for (int slot = NUM_DENOMS - 1; slot >= 0; slot--) {
+        int value = DENOMINATION_VALUES[slot];
+        for (int i = 0; i < change[slot]; i++) {
+            if (value >= 100) {
+                text.append(coin, std::snprintf(coin, sizeof(coin), "$%d ", value / 100));
+            } else {
+                text.append(coin, std::snprintf(coin, sizeof(coin), "%dc ", value));
+            }
+        }
+    }
+    text += '\n';
+}
+
+// Returns the line without the blanks around it.
+StrRef trimmed(StrRef line) {
+    while (!line.empty() && (line.data[0] == ' ' || line.data[0] == '\t')) {
+        line = StrRef(line.data + 1, line.length - 1);
+    }
+    while (!line.empty() && (line.data[line.length - 1] == ' ' || line.data[line.length - 1] == '\t' ||
+                             line.data[line.length - 1] == '\r')) {
+        line.length--;
+    }
+    return line;
+}
+
+}
+
+Session::Session(SessionEngine& engine, const LinkedList& menu, const Coin& coins, const SessionOption* options,
+                 unsigned optionCount)
+    : engine(engine), menu(menu), coins(coins), options(options != nullptr ? options : SERVED_MENU),
+      optionCount(options != nullptr ? optionCount : sizeof(SERVED_MENU) / sizeof(SERVED_MENU[0])), localOption(0),
+      state(SESSION_MENU), attempts(0), holding(false) {}
+
+Session::~Session() {
+    releaseHeld();
+}
+
+void Session::start(std::string& reply) {
+    showMenu(reply);
+}
+
+// This method takes the next line the client sent, without its newline, and appends the reply.
+void Session::handleLine(StrRef line, std::string& reply) {
+    STAT_TIME(STAT_SESSION_STEP);
+    StrRef text = trimmed(line);
+
+    if (state == SESSION_MENU) {
+        chooseOption(text, reply);
+    } else if (state == SESSION_BROWSE) {
+        browse(text, reply);
+    } else if (state == SESSION_PURCHASE_ITEM) {
+        chooseItem(text, reply);
+    } else if (state == SESSION_PURCHASE_COIN) {
+        payCoin(text, reply);
+    } else if (state == SESSION_ADD_NAME) {
+        addName(text, reply);
+    } else if (state == SESSION_ADD_DESCRIPTION) {
+        addDescription(text, reply);
+    } else if (state == SESSION_ADD_PRICE) {
+        addPrice(text, reply);
+    } else if (state == SESSION_REMOVE_ITEM) {
+        removeItem(text, reply);
+    } else if (state == SESSION_RESTOCK_ITEM) {
+        restockItem(text, reply);
+    } else if (state == SESSION_RESTOCK_LEVEL) {
+        restockLevel(text, reply);
+    }
+}
+
+// This method returns the local option the last line chose, once, or 0 if it chose none.
+int Session::takeLocalOption() {
+    int option = localOption;
+    localOption = 0;
+    return option;
+}
+
+void Session::showMenu(std::string& reply) {
+    char line[64];
+    bool admin = false;
+    state = SESSION_MENU;
+    reply += "Main Menu:\n";
+    for (unsigned i = 0; i < optionCount; i++) {
+        if (options[i].adminOnly && !admin) {
+            reply += "Administrator-Only Menu:\n";
+            admin = true;
+        }
+        reply.append(line, std::snprintf(line, sizeof(line), "%3u. ", i + 1));
+        reply += options[i].label;
+        reply += '\n';
+    }
+    reply.append(line, std::snprintf(line, sizeof(line), "Select your option (1-%u) :\n", optionCount));
+}
+
+void Session::chooseOption(StrRef line, std::string& reply) {
+    int option = 0;
+    bool number = DataFile::parseInt(line, option);
+    bool listed = number && option >= 1 && option <= static_cast<int>(optionCount);
+    SessionAction action = listed ? options[option - 1].action : SESSION_LOCAL;
+
+    if (!number) {
+        reply += "Invalid input. Please enter a number from 1 to " + std::to_string(optionCount) + ".\n";
+        showMenu(reply);
+    } else if (!listed) {
+        reply += "Invalid input. Please try again.\n";
+        showMenu(reply);
+    } else if (action == SESSION_LOCAL) {
+        localOption = option;
+    } else if (action == SESSION_DISPLAY) {
+        if (menu.getPageCount(MENU_PAGE_SIZE) <= 1) {
+            menu.appendMenu(reply);
+            showMenu(reply);
+        } else {
+            menu.appendMenuPage(1, MENU_PAGE_SIZE, reply);
+            state = SESSION_BROWSE;
+            promptPage(reply);
+        }
+    } else if (action == SESSION_PURCHASE) {
+        promptItem(reply);
+    } else if (action == SESSION_END) {
+        reply += "Good bye!";
+        state = SESSION_ENDED;
+    } else if (action == SESSION_ADD) {
+        startAdd(reply);
+    } else if (action == SESSION_REMOVE) {
+        attempts = 0;
+        state = SESSION_REMOVE_ITEM;
+        reply += "Enter the food ID of the item to remove from the menu: ";
+    } else if (action == SESSION_BALANCE) {
+        std::ostringstream balance;
+        coins.displayBalance(balance);
+        reply += balance.str();
+        showMenu(reply);
+    } else {
+        state = SESSION_RESTOCK_ITEM;
+        reply += "Enter the food ID of the item to restock: ";
+    }
+}
+
+void Session::promptPage(std::string& reply) {
+    reply += "Enter a page number (1-" + std::to_string(menu.getPageCount(MENU_PAGE_SIZE)) +
+             "), or press enter to return to the main menu: ";
+}
+
+void Session::browse(StrRef line, std::string& reply) {
+    int page = 0;
+    if (line.empty()) {
+        showMenu(reply);
+    } else if (!DataFile::parseInt(line, page) || page < 1 ||
+               !menu.appendMenuPage(static_cast<unsigned>(page), MENU_PAGE_SIZE, reply)) {
+        reply += "Invalid input. Please enter a page number from 1 to " +
+                 std::to_string(menu.getPageCount(MENU_PAGE_SIZE)) + ".\n";
+        promptPage(reply);
+    } else {
+        promptPage(reply);
+    }
+}
+
+void Session::promptItem(std::string& reply) {
+    state = SESSION_PURCHASE_ITEM;
+    reply += "Purchase Meal\n-------------\nPlease enter the ID of the food you wish to purchase:\n";
+}
+
+// A unit of the item is held from here until the purchase is completed or cancelled.
+void Session::chooseItem(StrRef line, std::string& reply) {
+    if (line.empty()) {
+        reply += "Returning to main menu.\nPurchase process was cancelled.\n";
+        showMenu(reply);
+    } else {
+        MenuReader items(menu);
+        const FoodItem* item = line.length <= IDLEN ? items->find(FoodItem::makeKey(line.data, line.length)) : nullptr;
+        if (item == nullptr) {
+            reply += "Error: Item not found in menu.\n";
+            promptItem(reply);
+        } else {
+            const char* failure = engine.hold(std::string(line.data, line.length), held, price);
+            if (failure != nullptr) {
+                reply += "Sorry, ";
+                reply += item->name;
+                if (std::strcmp(failure, PURCHASE_OUT_OF_STOCK) == 0) {
+                    reply += " is out of stock.\n";
+                } else {
+                    reply += " cannot be bought: ";
+                    reply += failure;
+                    reply += ".\n";
+                }
+                promptItem(reply);
+            } else {
+                holding = true;
+                itemId.assign(line.data, line.length);
+                paid = Money();
+                payments.clear();
+                reply += "You have selected \"";
+                reply += item->name;
+                reply += " - ";
+                reply += item->description;
+                reply += "\". This will cost you ";
+                appendMoney(reply, price);
+                reply += "\nPlease hand over the money - type in the value of each note/coin in cents.\n"
+                         "Please enter ctrl-D or enter on a new line to cancel this purchase.\n";
+                state = SESSION_PURCHASE_COIN;
+            }
+        }
+    }
+    if (state == SESSION_PURCHASE_COIN) {
+        reply += "You still need to give us ";
+        appendMoney(reply, price - paid);
+        reply += ": ";
+    }
+}
+
+void Session::payCoin(StrRef line, std::string& reply) {
+    int payment = 0;
+    if (line.empty()) {
+        if (!paid.isZero()) {
+            reply += "Transaction canceled. Refunding all payments.\nRefunded: ";
+            appendMoney(reply, paid);
+            reply += '\n';
+        }
+        releaseHeld();
+        reply += "Returning to main menu.\nPurchase process was cancelled.\n";
+        showMenu(reply);
+    } else if (!DataFile::parseInt(line, payment) || !coins.isValidDenomination(payment)) {
+        reply += "Error: invalid denomination encountered.\n";
+    } else if (coins.getCount(payment) == 0) {
+        reply += "Error: Not enough coins of denomination to provide change.\n";
+    } else {
+        payments.push_back(payment);
+        paid += Money::fromCents(payment);
+        if (paid >= price) {
+            completePurchase(reply);
+        }
+    }
+    if (state == SESSION_PURCHASE_COIN) {
+        reply += "You still need to give us ";
+        appendMoney(reply, price - paid);
+        reply += ": ";
+    }
+}
+
+void Session::completePurchase(std::string& reply) {
+    int change[NUM_DENOMS] = {};
+    const char* failure =
+        engine.purchaseHeld(itemId, held, price, payments.data(), static_cast<unsigned>(payments.size()), change);
+    holding = false;
+    if (failure != nullptr && std::strcmp(failure, PURCHASE_NO_CHANGE) == 0) {
+        reply += "Unable to provide correct change. Transaction cannot be completed.\n"
+                 "Returning to main menu.\nPurchase process was cancelled.\n";
+    } else if (failure != nullptr) {
+        reply += "The sale could not be completed: ";
+        reply += failure;
+        reply += ". Refunded: ";
+        appendMoney(reply, paid);
+        reply += '\n';
+    } else if (paid > price) {
+        appendChange(reply, change);
+    } else {
+        reply += "Thank you for your payment!\n";
+    }
+    showMenu(reply);
+}
+
+// Gives back the unit held for a purchase that will not be completed.
+void Session::releaseHeld() {
+    if (holding) {
+        held.release();
+        holding = false;
+    }
+}
+
+// The ID announced is the one the item gets unless another terminal adds an item first.
+void Session::startAdd(std::string& reply) {
+    if (!engine.peekItemId(itemId)) {
+        reply += "There are no free food IDs left.\nNo item was added to the menu.\n";
+        showMenu(reply);
+    } else {
+        state = SESSION_ADD_NAME;
+        reply += "This new meal item will have the Item ID of " + itemId + ".\nEnter the item name: ";
+    }
+}
+
+void Session::addName(StrRef line, std::string& reply) {
+    if (line.empty()) {
+        reply += "Returning to main menu.\nNo item was added to the menu.\n";
+        showMenu(reply);
+    } else if (line.length > NAMELEN) {
+        reply += "The name can be at most " + std::to_string(NAMELEN) + " characters long.\n";
+        startAdd(reply);
+    } else if (std::string(line.data, line.length).find('|') != std::string::npos) {
+        reply += "The name cannot contain '|'.\n";
+        startAdd(reply);
+    } else {
+        name.assign(line.data, line.length);
+        state = SESSION_ADD_DESCRIPTION;
+        reply += "Enter the item description: ";
+    }
+}
+
+void Session::addDescription(StrRef line, std::string& reply) {
+    if (line.empty()) {
+        reply += "Returning to main menu.\nNo item was added to the menu.\n";
+        showMenu(reply);
+    } else if (line.length > DESCLEN) {
+        reply += "The description can be at most " + std::to_string(DESCLEN) + " characters long.\n"
+                 "Enter the item description: ";
+    } else if (std::string(line.data, line.length).find('|') != std::string::npos) {
+        reply += "The description cannot contain '|'.\nEnter the item description: ";
+    } else {
+        description.assign(line.data, line.length);
+        state = SESSION_ADD_PRICE;
+        reply += "Enter the price for this item (in dollars and cents): ";
+    }
+}
+
+void Session::addPrice(StrRef line, std::string& reply) {
+    int cents = 0;
+    if (line.empty()) {
+        reply += "Returning to main menu and deleting the item with ID " + itemId + ".\nNo item was added to the menu.\n";
+        showMenu(reply);
+    } else if (!DataFile::parseCents(line, cents)) {
+        reply += "Invalid input. Please enter a valid price in dollars and cents (non-negative value).\n"
+                 "Enter the price for this item (in dollars and cents): ";
+    } else {
+        std::string newId;
+        const char* failure = engine.addItem(name, description, Money::fromCents(cents), newId);
+        if (failure != nullptr) {
+            reply += "Error: ";
+            reply += failure;
+            reply += ". No item was added.\n";
+        } else {
+            reply += "This item \"" + name + " - " + description + "\" has now been added to the food menu.\n";
+            if (newId != itemId) {
+                reply += "Another item took " + itemId + " first, so this one has the Item ID of " + newId + ".\n";
+            }
+        }
+        showMenu(reply);
+    }
+}
+
+void Session::removeItem(StrRef line, std::string& reply) {
+    std::string id(line.data, line.length);
+    std::string removed;  // what the item was, for the reply
+    if (!line.empty()) {
+        MenuReader items(menu);
+        const FoodItem* item = items->find(id);
+        if (item != nullptr) {
+            removed = "\"" + id + " - " + item->name + " - " + item->description + "\"";
+        }
+    }
+
+    if (line.empty()) {
+        reply += "Returning to main menu.\n";
+        showMenu(reply);
+    } else if (!removed.empty() && engine.removeItem(id) == nullptr) {
+        reply += removed + " has been removed from the system.\n";
+        showMenu(reply);
+    } else {
+        reply += "Food item with ID " + id + " not found.\n";
+        reply += "Failed to remove item with ID " + id + ". Item may not exist.\n";
+        if (++attempts >= SESSION_REMOVE_ATTEMPTS) {
+            reply += "Too many failed attempts. Returning to main menu.\n";
+            showMenu(reply);
+        } else {
+            reply += "Enter the food ID of the item to remove from the menu: ";
+        }
+    }
+}
+
+void Session::restockItem(StrRef line, std::string& reply) {
+    if (line.empty()) {
+        reply += "Returning to main menu.\n";
+        showMenu(reply);
+    } else {
+        MenuReader items(menu);
+        const FoodItem* item = line.length <= IDLEN ? items->find(FoodItem::makeKey(line.data, line.length)) : nullptr;
+        if (item == nullptr) {
+            reply += "Food item with ID " + std::string(line.data, line.length) + " not found.\n";
+            reply += "Enter the food ID of the item to restock: ";
+        } else {
+            itemId.assign(line.data, line.length);
+            name = item->name;
+            state = SESSION_RESTOCK_LEVEL;
+            promptLevel(reply);
+        }
+    }
+}
+
+// The level shown is the item's level now, which other terminals may have changed since it was chosen.
+void Session::promptLevel(std::string& reply) {
+    MenuReader items(menu);
+    const FoodItem* item = items->find(itemId);
+    reply += "Enter the new stock level for " + name + " (currently " +
+             std::to_string(item != nullptr ? item->on_hand.get() : 0) + ", enter for " +
+             std::to_string(DEFAULT_FOOD_STOCK_LEVEL) + "): ";
+}
+
+void Session::restockLevel(StrRef line, std::string& reply) {
+    int level = DEFAULT_FOOD_STOCK_LEVEL;
+    if (!line.empty() && !DataFile::parseInt(line, level)) {
+        reply += "Invalid input. Please enter a whole number of units.\n";
+        promptLevel(reply);
+    } else {
+        const char* failure = engine.restock(itemId, static_cast<unsigned>(level));
+        if (failure != nullptr) {
+            reply += "The item could not be restocked: ";
+            reply += failure;
+            reply += ".\n";
+        } else {
+            reply += name + " now has " + std::to_string(level) + " in stock.\n";
+        }
+        showMenu(reply);
+    }
+}
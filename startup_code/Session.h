@@ -0,0 +1,112 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <string>
+#include <vector>
+#include "SessionEngine.h"
+#include "DataFile.h"
+
+// The steps of a session, one for each kind of line it can be waiting for.
+enum SessionState {
+    SESSION_MENU,             // an option from the main menu
+    SESSION_BROWSE,           // a page of the menu
+    SESSION_PURCHASE_ITEM,    // the ID of the item to buy
+    SESSION_PURCHASE_COIN,    // the next coin, in cents
+    SESSION_ADD_NAME,
+    SESSION_ADD_DESCRIPTION,
+    SESSION_ADD_PRICE,
+    SESSION_REMOVE_ITEM,
+    SESSION_RESTOCK_ITEM,
+    SESSION_RESTOCK_LEVEL,
+    SESSION_ENDED
+};
+
+// What an option of the main menu does. SESSION_LOCAL options are carried out by the caller.
+enum SessionAction {
+    SESSION_DISPLAY,
+    SESSION_PURCHASE,
+    SESSION_END,
+    SESSION_ADD,
+    SESSION_REMOVE,
+    SESSION_BALANCE,
+    SESSION_RESTOCK,
+    SESSION_LOCAL
+};
+
+// An option of the main menu, numbered by its place in the menu from 1. Admin options are listed
+// under a heading of their own, which comes before the first of them.
+struct SessionOption {
+    const char* label;
+    SessionAction action;
+    bool adminOnly;
+};
+
+// One customer's or administrator's conversation with the machine, the main menu with its purchase
+// and admin flows, as a state machine fed one line at a time. Nothing waits for input: handleLine
+// takes a line, does what it asks and appends the reply, which ends with what to enter next, so
+// one thread can keep any number of sessions going at once. Sales and edits go through the
+// SessionEngine like those of any other terminal. The wording is the terminal's.
+//
+// Choosing an item holds a unit of it for the session, so once the customer is asked to pay, no
+// other terminal can sell that unit. The unit is sold when the last coin is paid, and given back
+// if the purchase is cancelled or the session is destroyed, as when its client goes away. The item
+// itself is looked up again at the sale, since it may have been removed meanwhile; the sale then
+// fails, with the coins handed back.
+//
+// The main menu is the session's own unless the caller gives one, as the terminal does. Choosing a
+// SESSION_LOCAL option leaves the session at the main menu with no reply; takeLocalOption then
+// returns the option, and the caller carries it out and calls start to show the menu again.
+class Session {
+public:
+    Session(SessionEngine& engine, const LinkedList& menu, const Coin& coins, const SessionOption* options = nullptr,
+            unsigned optionCount = 0);
+    ~Session();
+
+    void start(std::string& reply);
+    void handleLine(StrRef line, std::string& reply);
+    bool isEnded() const { return state == SESSION_ENDED; }
+    int takeLocalOption();
+
+private:
+    SessionEngine& engine;
+    const LinkedList& menu;
+    const Coin& coins;
+    const SessionOption* options;
+    unsigned optionCount;
+    int localOption;  // a local option chosen and not yet taken, or 0
+    SessionState state;
+
+    // What the flow under way has been told so far.
+    std::string itemId;
+    std::string name;
+    std::string description;
+    Money price;
+    Money paid;
+    std::vector<int> payments;
+    unsigned attempts;
+    StockLevel held;  // shares the stock of the chosen item while holding
+    bool holding;
+
+    Session(const Session&);
+    Session& operator=(const Session&);
+
+    void showMenu(std::string& reply);
+    void chooseOption(StrRef line, std::string& reply);
+    void promptPage(std::string& reply);
+    void browse(StrRef line, std::string& reply);
+    void promptItem(std::string& reply);
+    void chooseItem(StrRef line, std::string& reply);
+    void payCoin(StrRef line, std::string& reply);
+    void completePurchase(std::string& reply);
+    void releaseHeld();
+    void startAdd(std::string& reply);
+    void addName(StrRef line, std::string& reply);
+    void addDescription(StrRef line, std::string& reply);
+    void addPrice(StrRef line, std::string& reply);
+    void removeItem(StrRef line, std::string& reply);
+    void restockItem(StrRef line, std::string& reply);
+    void promptLevel(std::string& reply);
+    void restockLevel(StrRef line, std::string& reply);
+};
+
+#endif  // SESSION_H
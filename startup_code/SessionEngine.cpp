@@ -0,0 +1,227 @@
+#include <algorithm>
+#include "SessionEngine.h"
+#include "Stats.h"
+
+namespace {
+
+// Each thread keeps its own scratch tables, so change can be worked out without a lock.
+thread_local ChangeEngine changeEngine;
+
+}
+
+SessionEngine::SessionEngine(LinkedList& menu, Coin& coins, Journal& journal, FoodIdAllocator& ids)
+    : menu(menu), coins(coins), journal(journal), ids(ids) {}
+
+// Coins are paid in order until the price is covered, as at the interactive prompt. There is no
+// one to ask for another coin, so a coin the machine will not take fails the whole sale, as do
+// coins left over once the price is covered.
+const char* SessionEngine::purchase(const std::string& itemId, const int* payments, unsigned paymentCount, int* change) {
+    STAT_TIME(STAT_SESSION_PURCHASE);
+    MenuReader items(menu);
+    const char* failure = nullptr;
+    FoodItem* selectedItem = items->find(itemId);
+
+    if (selectedItem == nullptr) {
+        failure = "item not found";
+    } else if (!selectedItem->on_hand.reserve()) {
+        failure = PURCHASE_OUT_OF_STOCK;
+    } else {
+        failure = sell(*selectedItem, selectedItem->price, payments, paymentCount, change);
+    }
+    return failure;
+}
+
+const char* SessionEngine::hold(const std::string& itemId, StockLevel& held, Money& price) {
+    MenuReader items(menu);
+    const char* failure = nullptr;
+    FoodItem* item = items->find(itemId);
+
+    if (item == nullptr) {
+        failure = "item not found";
+    } else if (!item->on_hand.reserve()) {
+        failure = PURCHASE_OUT_OF_STOCK;
+    } else {
+        held.share(item->on_hand);
+        price = item->price;
+    }
+    return failure;
+}
+
+// Every version of an item shares one stock counter, so the item found now is the one the unit was
+// held on only if the counters match. A counter is not reused while a unit is held on it, so an
+// item removed and added again under the same ID does not match. A version that has repriced the
+// item since does match, and the buyer still pays the price they were asked for.
+const char* SessionEngine::purchaseHeld(const std::string& itemId, StockLevel& held, Money price, const int* payments,
+                                        unsigned paymentCount, int* change) {
+    STAT_TIME(STAT_SESSION_PURCHASE);
+    MenuReader items(menu);
+    const char* failure = nullptr;
+    FoodItem* item = items->find(itemId);
+
+    if (item == nullptr || item->on_hand.counter() != held.counter()) {
+        held.release();
+        failure = "item not found";
+    } else {
+        failure = sell(*item, price, payments, paymentCount, change);
+    }
+    return failure;
+}
+
+// This method takes payment of price for a unit of the item already reserved, then commits the
+// unit, or releases it if the sale fails. The unit is committed and the sale journaled in one step
+// under the journal lock, so that a restock of the item is journaled before or after the sale in
+// the order the two changed its stock.
+const char* SessionEngine::sell(FoodItem& item, Money price, const int* payments, unsigned paymentCount, int* change) {
+    const char* failure = nullptr;
+    Money paidAmount;
+    int coinsIn[NUM_DENOMS] = {};
+
+    for (unsigned i = 0; i < paymentCount && failure == nullptr; i++) {
+        if (paidAmount >= price) {
+            failure = "paid too many coins";
+        } else if (!coins.isValidDenomination(payments[i])) {
+            failure = "invalid denomination";
+        } else {
+            paidAmount += Money::fromCents(payments[i]);
+            coinsIn[denominationSlot(payments[i])]++;
+        }
+    }
+
+    if (failure == nullptr && paidAmount < price) {
+        failure = "not enough paid";
+    } else if (failure == nullptr) {
+        std::fill(change, change + NUM_DENOMS, 0);
+        failure = settle((paidAmount - price).asCents(), coinsIn, change);
+    }
+
+    if (failure == nullptr) {
+        std::lock_guard<std::mutex> writing(journalLock);
+        item.on_hand.commit();
+        menu.markChanged(item);
+        journal.recordSale(item, price, coinsIn, change);
+    } else {
+        item.on_hand.release();
+    }
+    return failure;
+}
+
+// This method takes the change for a sale from the float and banks the coins paid in, as one step.
+// The change is first worked out from a copy of the float taken under the lock, so the slow part
+// runs while other terminals use the float. A denomination the float holds none of is refused,
+// as at the interactive prompt. On failure the float is untouched and the reason is returned.
+const char* SessionEngine::settle(long long cents, const int* coinsIn, int* used) {
+    const char* failure = nullptr;
+    CoinFloat seen;
+    bool found = true;
+    {
+        std::lock_guard<std::mutex> locked(floatLock);
+        seen = coins.getFloat();
+    }
+    for (int slot = 0; slot < NUM_DENOMS; slot++) {
+        if (coinsIn[slot] > 0 && seen.counts[slot] == 0) {
+            failure = "denomination not accepted";
+        }
+    }
+    if (failure == nullptr && cents > 0) {
+        found = changeEngine.solve(DENOMINATION_VALUES, seen.counts, NUM_DENOMS, cents, used);
+    }
+
+    if (failure == nullptr && found) {
+        std::lock_guard<std::mutex> locked(floatLock);
+        if (!coins.takeCoins(used)) {
+            // Another terminal took some of these coins first; solve again against the live float.
+            std::fill(used, used + NUM_DENOMS, 0);
+            found = changeEngine.solve(DENOMINATION_VALUES, coins.getFloat().counts, NUM_DENOMS, cents, used) &&
+                    coins.takeCoins(used);
+        }
+        if (found) {
+            coins.addCoins(coinsIn);
+        }
+    }
+    if (failure == nullptr && !found) {
+        failure = PURCHASE_NO_CHANGE;
+    }
+    return failure;
+}
+
+bool SessionEngine::peekItemId(std::string& itemId) {
+    std::lock_guard<std::mutex> editing(editLock);
+    return ids.peek(itemId);
+}
+
+const char* SessionEngine::addItem(const std::string& name, const std::string& description, Money price, std::string& itemId) {
+    std::lock_guard<std::mutex> editing(editLock);
+    std::lock_guard<std::mutex> writing(journalLock);
+    const char* failure = nullptr;
+
+    std::string nextId;
+
+    // The ID is only taken once the item is in; if the insert fails it is already on the menu, and
+    // is taken so that the next add gets another.
+    if (!ids.peek(nextId)) {
+        failure = "no free food IDs";
+    } else if (!menu.insertNode(FoodItem(nextId, name, description, price, DEFAULT_FOOD_STOCK_LEVEL))) {
+        ids.allocate(nextId);
+        failure = "food ID already in use";
+    } else {
+        ids.allocate(nextId);
+        itemId = nextId;
+        journal.recordAdd(*menu.findItem(itemId)->data);
+    }
+    return failure;
+}
+
+const char* SessionEngine::removeItem(const std::string& itemId) {
+    std::lock_guard<std::mutex> editing(editLock);
+    std::lock_guard<std::mutex> writing(journalLock);
+    const char* failure = nullptr;
+
+    if (!menu.eraseItem(itemId)) {
+        failure = "item not found";
+    } else {
+        ids.release(itemId);
+        journal.recordRemove(itemId);
+    }
+    return failure;
+}
+
+bool SessionEngine::applyChanges(const std::vector<MenuChange>& changes, std::vector<const char*>& failures) {
+    std::lock_guard<std::mutex> editing(editLock);
+    std::lock_guard<std::mutex> writing(journalLock);
+    bool applied = menu.applyChanges(changes, failures);
+
+    if (applied) {
+        for (const MenuChange& change : changes) {
+            if (change.type == MENU_ADD) {
+                ids.observe(change.item.id);
+            } else if (change.type == MENU_REMOVE) {
+                ids.release(change.item.id);
+            }
+        }
+        journal.recordChanges(changes);
+    }
+    return applied;
+}
+
+// Reports which changes could not be made, as applyChanges would, without making any.
+bool SessionEngine::checkChanges(const std::vector<MenuChange>& changes, std::vector<const char*>& failures) {
+    std::lock_guard<std::mutex> editing(editLock);
+    return menu.checkChanges(changes, failures);
+}
+
+// Stock levels are atomic and shared by every version of the menu, so restocking only reads it.
+const char* SessionEngine::restock(const std::string& itemId, unsigned level) {
+    MenuReader items(menu);
+    const char* failure = nullptr;
+    FoodItem* item = items->find(itemId);
+
+    if (item == nullptr) {
+        failure = "item not found";
+    } else {
+        std::lock_guard<std::mutex> writing(journalLock);
+        item->on_hand.set(level);
+        menu.markChanged(*item);
+        journal.recordRestock(itemId, level);
+    }
+    return failure;
+}
@@ -0,0 +1,85 @@
+#ifndef SESSIONENGINE_H
+#define SESSIONENGINE_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include "LinkedList.h"
+#include "Coin.h"
+#include "Journal.h"
+#include "FoodIdAllocator.h"
+
+// The reason a purchase fails when the float cannot make its change.
+#define PURCHASE_NO_CHANGE "unable to make change"
+
+// The reason a purchase or hold fails when the item has no stock left to reserve.
+#define PURCHASE_OUT_OF_STOCK "out of stock"
+
+// The rules for sales and menu edits, shared by any number of terminals running on their own
+// threads against one menu and one coin float.
+//
+// Purchases and restocks only read the menu, so they go through a MenuReader and take no lock on
+// it: they run side by side, and an item added or removed meanwhile does not hold them up. Adding
+// and removing items, and sets of changes, take the edit lock, one at a time. A sale that races
+// with the removal of its item completes as if it came first. A unit of stock is reserved with a
+// compare-and-swap on the item before payment, then committed once paid or released if the sale
+// fails, so two terminals can never both sell the last unit. Change is worked out on a private copy
+// of the float outside any lock. The result is then taken from the live float under a short lock,
+// but only if those coins are all still there. If another terminal took them first, the change is
+// worked out again with the float locked. A sale therefore takes its change and banks its payment
+// in one atomic step.
+//
+// Every change to the menu or to stock is made and journaled in one step under the journal lock,
+// so the journal holds changes in the order they were made, and replaying it gives the same menu.
+// A sale holds the lock only to commit its unit and append its record; an edit holds it throughout.
+//
+// Every method is safe to call from any thread.
+class SessionEngine {
+public:
+    SessionEngine(LinkedList& menu, Coin& coins, Journal& journal, FoodIdAllocator& ids);
+
+    // Sells one unit of itemId for the coins in payments, paid in order. Returns nullptr on
+    // success with change set to the number of coins of each Denomination handed out, otherwise
+    // the reason the sale failed, in which case nothing has changed. A sale allocates no memory
+    // once the journal buffer and the list of changed items have grown to their working size.
+    const char* purchase(const std::string& itemId, const int* payments, unsigned paymentCount, int* change);
+
+    // Reserves a unit of itemId for a buyer who pays over several steps, points held at the item's
+    // stock so the unit stays theirs however long that takes, and sets price to what it costs now.
+    // The unit must then either be sold with purchaseHeld or given back with held.release().
+    const char* hold(const std::string& itemId, StockLevel& held, Money& price);
+    // Sells the unit held for itemId at the price it was held at, as purchase. It is committed on
+    // success and released on any failure, as when the item was removed while it was being paid for.
+    const char* purchaseHeld(const std::string& itemId, StockLevel& held, Money price, const int* payments,
+                             unsigned paymentCount, int* change);
+
+    // Sets itemId to the ID the next addItem will use, unless another terminal adds an item first.
+    // Returns false if there are no free IDs.
+    bool peekItemId(std::string& itemId);
+    // Adds an item under the next ID from the allocator, which is returned in itemId.
+    const char* addItem(const std::string& name, const std::string& description, Money price, std::string& itemId);
+    const char* removeItem(const std::string& itemId);
+    const char* restock(const std::string& itemId, unsigned level);
+
+    // Makes every change or none of them, as LinkedList::applyChanges. A unit held for a sale before
+    // its item is repriced is still sold at the price it was held at.
+    bool applyChanges(const std::vector<MenuChange>& changes, std::vector<const char*>& failures);
+    bool checkChanges(const std::vector<MenuChange>& changes, std::vector<const char*>& failures);
+
+private:
+    LinkedList& menu;
+    Coin& coins;
+    Journal& journal;
+    FoodIdAllocator& ids;  // used only with the edit lock held
+    std::mutex editLock;
+    std::mutex floatLock;
+    std::mutex journalLock;
+
+    SessionEngine(const SessionEngine&);
+    SessionEngine& operator=(const SessionEngine&);
+
+    const char* sell(FoodItem& item, Money price, const int* payments, unsigned paymentCount, int* change);
+    const char* settle(long long cents, const int* coinsIn, int* used);
+};
+
+#endif  // SESSIONENGINE_H
@@ -0,0 +1,267 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/resource.h>
+#include "SessionServer.h"
+
+SessionServer::SessionServer(SessionEngine& engine, const LinkedList& menu, const Coin& coins)
+    : engine(engine), menu(menu), coins(coins), listenFd(-1), epollFd(-1), signalFd(-1), accepting(true), connected(0),
+      stats() {}
+
+SessionServer::~SessionServer() {
+    for (Connection* connection : clients) {
+        if (connection != nullptr) {
+            closeClient(connection);
+        }
+    }
+    if (listenFd >= 0) {
+        close(listenFd);
+    }
+    if (!path.empty()) {
+        unlink(path.c_str());
+    }
+    if (signalFd >= 0) {
+        close(signalFd);
+    }
+    if (epollFd >= 0) {
+        close(epollFd);
+    }
+}
+
+// This method creates the socket at path and starts listening on it. A socket file left there by
+// a server that did not shut down is replaced; any other file is not. Each client needs a file
+// descriptor, so the limit on them is raised as far as it goes. Returns false, saying why, if the
+// server cannot listen.
+bool SessionServer::listen(const std::string& socketPath) {
+    const char* failure = nullptr;
+    struct sockaddr_un address;
+    struct stat existing;
+    struct rlimit files;
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max) {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        failure = "the socket path is too long";
+    } else if (lstat(socketPath.c_str(), &existing) == 0 && !S_ISSOCK(existing.st_mode)) {
+        failure = "a file that is not a socket is in the way";
+    } else {
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+        unlink(socketPath.c_str());
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0 || bind(listenFd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(listenFd, SOMAXCONN) != 0) {
+            failure = std::strerror(errno);
+        } else {
+            path = socketPath;
+        }
+    }
+
+    if (failure == nullptr) {
+        struct epoll_event event;
+        blockStopSignals();
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        event.events = EPOLLIN;
+        event.data.fd = listenFd;
+        if (epollFd < 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) != 0 ||
+            (signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC)) < 0) {
+            failure = std::strerror(errno);
+        } else {
+            event.data.fd = signalFd;
+            if (epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &event) != 0) {
+                failure = std::strerror(errno);
+            }
+        }
+    }
+    if (failure != nullptr) {
+        std::cerr << "Error listening on " << socketPath << ": " << failure << std::endl;
+    }
+    return failure == nullptr;
+}
+
+// Blocks SIGINT and SIGTERM in the calling thread, and so in every thread it starts afterwards.
+void SessionServer::blockStopSignals() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+}
+
+// This method serves clients until SIGINT or SIGTERM. Returns false if waiting for events failed.
+bool SessionServer::run() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    struct epoll_event events[SERVER_EVENTS];
+    bool stopped = false;
+    bool failed = false;
+
+    while (!stopped && !failed) {
+        int ready = epoll_wait(epollFd, events, SERVER_EVENTS, -1);
+        if (ready < 0 && errno != EINTR) {
+            std::cerr << "Error waiting for clients: " << std::strerror(errno) << std::endl;
+            failed = true;
+        }
+        for (int i = 0; i < ready; i++) {
+            int fd = events[i].data.fd;
+            if (fd == signalFd) {
+                stopped = true;
+            } else if (fd == listenFd) {
+                acceptClients();
+            } else if (static_cast<std::size_t>(fd) < clients.size() && clients[fd] != nullptr) {
+                Connection* connection = clients[fd];
+                bool keep = (events[i].events & EPOLLERR) == 0;
+                if (keep) {
+                    keep = connection->writing ? writeClient(connection) : readClient(connection);
+                }
+                if (!keep) {
+                    closeClient(connection);
+                }
+            }
+        }
+    }
+    for (Connection* connection : clients) {
+        if (connection != nullptr) {
+            closeClient(connection);
+        }
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return !failed;
+}
+
+// Takes every client waiting to connect and greets each with the main menu. Out of file
+// descriptors, the server stops accepting until a client leaves; the rest wait in the backlog.
+void SessionServer::acceptClients() {
+    bool waiting = true;
+    while (waiting) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd >= 0) {
+            Connection* connection = new Connection(fd, engine, menu, coins);
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (static_cast<std::size_t>(fd) >= clients.size()) {
+                clients.resize(fd + 1, nullptr);
+            }
+            clients[fd] = connection;
+            connected++;
+            stats.sessions++;
+            stats.peak = std::max(stats.peak, connected);
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+            connection->session.start(connection->output);
+            connection->output += SESSION_PROMPT;
+            if (!writeClient(connection)) {
+                closeClient(connection);
+            }
+        } else if (errno == EMFILE || errno == ENFILE) {
+            std::cerr << "Out of file descriptors with " << connected << " clients; new clients wait." << std::endl;
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, listenFd, nullptr);
+            accepting = false;
+            waiting = false;
+        } else if (errno != EINTR && errno != ECONNABORTED) {
+            waiting = false;
+        }
+    }
+}
+
+// This method reads what the client has sent and answers every whole line in it. Returns false if
+// the client has gone, or sent a line too long to be one the session would take.
+bool SessionServer::readClient(Connection* connection) {
+    char buffer[SERVER_READ_BYTES];
+    ssize_t got = read(connection->fd, buffer, sizeof(buffer));
+    bool keep = got > 0 || (got < 0 && (errno == EAGAIN || errno == EINTR));
+
+    if (got > 0) {
+        std::string& input = connection->input;
+        std::size_t start = 0;
+        std::size_t end = 0;
+        input.append(buffer, got);
+        while (!connection->session.isEnded() && (end = input.find('\n', start)) != std::string::npos) {
+            connection->session.handleLine(StrRef(input.data() + start, end - start), connection->output);
+            if (!connection->session.isEnded()) {
+                connection->output += SESSION_PROMPT;
+            }
+            stats.lines++;
+            start = end + 1;
+        }
+        input.erase(0, start);
+        keep = input.size() <= SERVER_MAX_LINE && writeClient(connection);
+    }
+    return keep;
+}
+
+// This method writes as much of the reply as the socket takes, and waits for room for the rest.
+// Returns false once the client has gone, or has had the last reply of a session it ended.
+bool SessionServer::writeClient(Connection* connection) {
+    std::string& output = connection->output;
+    bool keep = true;
+    bool full = false;
+
+    while (keep && !full && connection->sent < output.size()) {
+        ssize_t wrote = send(connection->fd, output.data() + connection->sent, output.size() - connection->sent, MSG_NOSIGNAL);
+        if (wrote >= 0) {
+            connection->sent += wrote;
+        } else if (errno == EAGAIN) {
+            full = true;
+        } else if (errno != EINTR) {
+            keep = false;
+        }
+    }
+    if (keep && !full) {
+        output.clear();
+        connection->sent = 0;
+        keep = !connection->session.isEnded();
+    }
+    if (keep && full != connection->writing) {
+        watch(connection, full);
+    }
+    return keep;
+}
+
+// Waits for room to write to the client, or for input from it, but not both, so that a client is
+// only read from once it has had every reply.
+void SessionServer::watch(Connection* connection, bool writing) {
+    struct epoll_event event;
+    event.events = writing ? EPOLLOUT : EPOLLIN;
+    event.data.fd = connection->fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+    connection->writing = writing;
+}
+
+// Deleting the connection destroys its session, which gives back any unit it held for a purchase
+// its client never finished.
+void SessionServer::closeClient(Connection* connection) {
+    if (connection->session.isEnded()) {
+        stats.ended++;
+    } else {
+        stats.dropped++;
+    }
+    clients[connection->fd] = nullptr;
+    close(connection->fd);
+    delete connection;
+    connected--;
+
+    if (!accepting) {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = listenFd;
+        accepting = epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) == 0;
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef SESSIONSERVER_H
+#define SESSIONSERVER_H
+
+#include <string>
+#include <vector>
+#include "Session.h"
+
+// Every reply to a client ends with this, after what the session asks for, so a client has the
+// whole reply once what it has read ends with it. A session's last reply has none, as the server
+// closes the connection after it.
+#define SESSION_PROMPT "> "
+
+// Events taken from epoll per wait, and bytes read from a client per event.
+#define SERVER_EVENTS 256
+#define SERVER_READ_BYTES 4096
+
+// A client that sends a line longer than this without a newline is disconnected.
+#define SERVER_MAX_LINE 1024
+
+// What a server run did.
+struct ServerStats {
+    unsigned long long sessions;  // accepted
+    unsigned long long ended;     // ended by the client choosing End Session
+    unsigned long long dropped;   // disconnected part way through
+    unsigned long long lines;
+    unsigned peak;                // sessions open at once
+    double seconds;
+};
+
+// Serves sessions to any number of clients at once over a Unix domain socket, from one thread.
+// Every socket is non-blocking and an epoll loop waits on all of them: each complete line a
+// client sends is handed to its Session, and the reply is written as far as the socket takes it.
+// The rest of a reply is kept and written once the socket has room, and nothing more is read from
+// that client until it is, so a client that does not read its replies only holds up itself.
+//
+// SIGINT and SIGTERM are taken through a signalfd in the same loop, so a signal is seen whenever
+// it arrives, and run returns. Sessions still open are then dropped, mid-purchase ones with nothing
+// taken, and the socket file is removed. For the signalfd to get them, the two signals must be
+// blocked in every thread: call blockStopSignals before starting any other thread.
+class SessionServer {
+public:
+    SessionServer(SessionEngine& engine, const LinkedList& menu, const Coin& coins);
+    ~SessionServer();
+
+    bool listen(const std::string& path);
+    bool run();
+    const ServerStats& getStats() const { return stats; }
+
+    static void blockStopSignals();
+
+private:
+    // One client: its socket, its session, what it has sent that is not yet a whole line, and the
+    // reply still to be written from offset sent.
+    struct Connection {
+        int fd;
+        Session session;
+        std::string input;
+        std::string output;
+        std::size_t sent;
+        bool writing;  // waiting for room to write, not for input
+
+        Connection(int fd, SessionEngine& engine, const LinkedList& menu, const Coin& coins)
+            : fd(fd), session(engine, menu, coins), sent(0), writing(false) {}
+    };
+
+    SessionEngine& engine;
+    const LinkedList& menu;
+    const Coin& coins;
+    std::vector<Connection*> clients;  // indexed by socket, nullptr where none is open
+    std::string path;
+    int listenFd;
+    int epollFd;
+    int signalFd;
+    bool accepting;  // false while out of file descriptors
+    unsigned connected;
+    ServerStats stats;
+
+    SessionServer(const SessionServer&);
+    SessionServer& operator=(const SessionServer&);
+
+    void acceptClients();
+    bool readClient(Connection* connection);
+    bool writeClient(Connection* connection);
+    void watch(Connection* connection, bool writing);
+    void closeClient(Connection* connection);
+};
+
+#endif  // SESSIONSERVER_H
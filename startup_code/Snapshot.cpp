@@ -0,0 +1,246 @@
+#include <iostream>
+#include <cstring>
+#include "Snapshot.h"
+#include "DataFile.h"
+#include "SaveFile.h"
+#include "Stats.h"
+
+namespace {
+
+// Written to the header so that a snapshot from a machine with the other byte order is refused.
+const unsigned BYTE_ORDER_MARK = 0x01020304;
+
+struct SnapshotHeader {
+    char magic[8];
+    unsigned version;
+    unsigned byteOrder;
+    unsigned recordSize;
+    unsigned itemCount;
+    unsigned long long textBytes;
+    int coinCounts[NUM_DENOMS];
+    unsigned long long checksum;  // over the header with this field zeroed, then the rest of the file
+};
+
+struct SnapshotRecord {
+    FoodKey key;
+    long long priceCents;
+    unsigned long long descOffset;
+    unsigned descLength;
+    unsigned onHand;
+    char id[IDLEN + 1];
+    char name[NAMELEN + 1];
+};
+
+// The record of a version 1 snapshot, written when IDLEN was 5.
+struct SnapshotRecordV1 {
+    FoodKey key;
+    long long priceCents;
+    unsigned long long descOffset;
+    unsigned descLength;
+    unsigned onHand;
+    char id[6];
+    char name[NAMELEN + 1];
+};
+
+std::size_t recordSize(unsigned version) {
+    return version == 1 ? sizeof(SnapshotRecordV1) : sizeof(SnapshotRecord);
+}
+
+// Copies record i of a snapshot of the given version into the current layout.
+void readRecord(const char* records, unsigned i, unsigned version, SnapshotRecord& record) {
+    if (version == 1) {
+        SnapshotRecordV1 old;
+        std::memcpy(&old, records + i * sizeof(SnapshotRecordV1), sizeof(old));
+        std::memset(&record, 0, sizeof(record));
+        record.key = old.key;
+        record.priceCents = old.priceCents;
+        record.descOffset = old.descOffset;
+        record.descLength = old.descLength;
+        record.onHand = old.onHand;
+        std::memcpy(record.id, old.id, sizeof(old.id));
+        std::memcpy(record.name, old.name, sizeof(old.name));
+    } else {
+        std::memcpy(&record, records + i * sizeof(SnapshotRecord), sizeof(record));
+    }
+}
+
+}
+
+Checksum::Checksum() : hash(14695981039346656037ULL), pendingLength(0), total(0) {}
+
+void Checksum::mix(unsigned long long word) {
+    hash = (hash ^ word) * 0x100000001b3ULL;
+    hash ^= hash >> 29;
+}
+
+void Checksum::update(const void* data, std::size_t length) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    total += length;
+    while (length > 0 && (pendingLength > 0 || length < sizeof(unsigned long long))) {
+        pending[pendingLength++] = *bytes++;
+        length--;
+        if (pendingLength == sizeof(unsigned long long)) {
+            unsigned long long word;
+            std::memcpy(&word, pending, sizeof(word));
+            mix(word);
+            pendingLength = 0;
+        }
+    }
+    while (length >= sizeof(unsigned long long)) {
+        unsigned long long word;
+        std::memcpy(&word, bytes, sizeof(word));
+        mix(word);
+        bytes += sizeof(word);
+        length -= sizeof(word);
+    }
+    while (length > 0) {
+        pending[pendingLength++] = *bytes++;
+        length--;
+    }
+}
+
+unsigned long long Checksum::value() const {
+    unsigned long long word = 0;
+    std::memcpy(&word, pending, pendingLength);
+    unsigned long long result = (hash ^ word ^ (static_cast<unsigned long long>(pendingLength) << 56)) * 0x100000001b3ULL;
+    return result ^ total;
+}
+
+// Items are written in ID order, so loading never needs to sort. The menu is read as one version
+// of it, so it may be edited meanwhile. The file is replaced as a whole, never left torn.
+bool Snapshot::save(const std::string& filename, const LinkedList& list, const Coin& coins) {
+    STAT_TIME(STAT_SAVE_SNAPSHOT);
+    MenuReader menu(list);
+    SaveFile file(filename);
+    bool saved = file.isOpen();
+
+    if (saved) {
+        SnapshotHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.version = SNAPSHOT_VERSION;
+        header.byteOrder = BYTE_ORDER_MARK;
+        header.recordSize = sizeof(SnapshotRecord);
+        header.itemCount = menu->getCount();
+        for (const FoodItem* item : *menu) {
+            header.textBytes += std::strlen(item->description) + 1;
+        }
+        std::memcpy(header.coinCounts, coins.getFloat().counts, sizeof(header.coinCounts));
+
+        Checksum checksum;
+        checksum.update(&header, sizeof(header));
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        unsigned long long offset = 0;
+        for (const FoodItem* item : *menu) {
+            SnapshotRecord record;
+            std::memset(&record, 0, sizeof(record));
+            record.key = item->key;
+            record.priceCents = item->price.asCents();
+            record.descOffset = offset;
+            record.descLength = std::strlen(item->description);
+            record.onHand = item->on_hand.get();
+            // Only the text is copied; the bytes after its terminator in the item are not defined.
+            std::memcpy(record.id, item->id, std::strlen(item->id));
+            std::memcpy(record.name, item->name, std::strlen(item->name));
+            offset += record.descLength + 1;
+            checksum.update(&record, sizeof(record));
+            file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        }
+        for (const FoodItem* item : *menu) {
+            const char* description = item->description;
+            std::size_t length = std::strlen(description) + 1;
+            checksum.update(description, length);
+            file.write(description, length);
+        }
+
+        header.checksum = checksum.value();
+        file.patch(offsetof(SnapshotHeader, checksum), &header.checksum, sizeof(header.checksum));
+        saved = file.commit();
+    }
+    return saved;
+}
+
+// The menu must be empty. The file is verified in full before anything is changed, so a damaged
+// snapshot leaves the menu and coins untouched. Records must be in ID order, as save writes them,
+// so each item is linked straight onto the end of the list, and readers see them all at once.
+bool Snapshot::load(const std::string& filename, LinkedList& menu, Coin& coins) {
+    STAT_TIME(STAT_LOAD_SNAPSHOT);
+    DataFile file(filename);
+    StrRef contents = file.contents();
+    const char* error = nullptr;
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+
+    if (!file.isOpen()) {
+        error = "cannot open file";
+    } else if (menu.getHead() != nullptr) {
+        error = "menu is not empty";
+    } else if (contents.length < sizeof(header)) {
+        error = "file is too short";
+    } else {
+        std::memcpy(&header, contents.data, sizeof(header));
+        if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+            error = "not a snapshot file";
+        } else if (header.version < 1 || header.version > SNAPSHOT_VERSION || header.byteOrder != BYTE_ORDER_MARK ||
+                   header.recordSize != recordSize(header.version)) {
+            error = "unsupported snapshot version or byte order";
+        } else if (contents.length != sizeof(header) + static_cast<unsigned long long>(header.itemCount) * header.recordSize + header.textBytes) {
+            error = "file size does not match header";
+        } else {
+            SnapshotHeader unsummed = header;
+            unsummed.checksum = 0;
+            Checksum checksum;
+            checksum.update(&unsummed, sizeof(unsummed));
+            checksum.update(contents.data + sizeof(header), contents.length - sizeof(header));
+            if (checksum.value() != header.checksum) {
+                error = "checksum mismatch";
+            }
+        }
+    }
+
+    const char* records = contents.data + sizeof(header);
+    const char* text = records + static_cast<std::size_t>(header.itemCount) * header.recordSize;
+    // Earlier builds copied whatever followed the terminators of the ID and name, so only a
+    // terminator somewhere in each field is required.
+    FoodKey previousKey = 0;
+    for (unsigned i = 0; i < header.itemCount && error == nullptr; i++) {
+        SnapshotRecord record;
+        readRecord(records, i, header.version, record);
+        if (record.descOffset + record.descLength >= header.textBytes || text[record.descOffset + record.descLength] != '\0' ||
+            std::memchr(record.id, '\0', sizeof(record.id)) == nullptr || std::memchr(record.name, '\0', sizeof(record.name)) == nullptr ||
+            record.key != FoodItem::makeKey(record.id, std::strlen(record.id))) {
+            error = "corrupt item record";
+        } else if (i > 0 && record.key <= previousKey) {
+            error = "item records out of ID order";
+        }
+        previousKey = record.key;
+    }
+
+    if (error != nullptr) {
+        std::cerr << "Error loading snapshot " << filename << ": " << error << std::endl;
+    } else {
+        Node* tail = nullptr;
+        menu.index.reserve(header.itemCount);
+        menu.pool.reserve(header.itemCount);
+        for (unsigned i = 0; i < header.itemCount; i++) {
+            SnapshotRecord record;
+            if (i + SNAPSHOT_PREFETCH < header.itemCount) {
+                // Records of every version start with the key.
+                FoodKey ahead;
+                std::memcpy(&ahead, records + static_cast<std::size_t>(i + SNAPSHOT_PREFETCH) * header.recordSize, sizeof(ahead));
+                menu.index.prefetch(ahead);
+            }
+            readRecord(records, i, header.version, record);
+            tail = menu.appendNode(tail, FoodItem(record.id, std::strlen(record.id), record.name, std::strlen(record.name),
+                                                  menu.descriptions.add(text + record.descOffset, record.descLength),
+                                                  Money::fromCents(record.priceCents), record.onHand));
+        }
+        menu.publish(MenuView::build(menu.head, menu.latest.load()->getVersion() + 1));
+
+        CoinFloat coinFloat;
+        std::memcpy(coinFloat.counts, header.coinCounts, sizeof(coinFloat.counts));
+        coins.setFloat(coinFloat);
+    }
+    return error == nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <string>
+#include <cstddef>
+#include "LinkedList.h"
+#include "Coin.h"
+
+// Identifies a snapshot file and the layout version written by this build. Version 1 files, from
+// before IDs could be longer than five characters, can still be loaded.
+#define SNAPSHOT_MAGIC "FTTSNAP"
+#define SNAPSHOT_VERSION 2
+
+// How many records ahead of the one being loaded the loader starts fetching the index slot for.
+#define SNAPSHOT_PREFETCH 16
+
+// Streaming 64-bit checksum over arbitrary byte ranges. Input is consumed eight bytes at a time,
+// so it costs far less than a byte-wise hash, and the result does not depend on how the input
+// is split between update calls.
+class Checksum {
+public:
+    Checksum();
+    void update(const void* data, std::size_t length);
+    unsigned long long value() const;
+
+private:
+    unsigned long long hash;
+    unsigned char pending[8];
+    std::size_t pendingLength;
+    unsigned long long total;
+
+    void mix(unsigned long long word);
+};
+
+// Binary image of the whole machine: catalog, stock levels and coin float. The file is a fixed
+// header, one fixed-size record per item in ID order, then every description back to back.
+// Loading maps the file, verifies it and copies records and text with no text parsing.
+// Numbers are stored in native byte order, which the header records and the loader checks.
+class Snapshot {
+public:
+    static bool save(const std::string& filename, const LinkedList& menu, const Coin& coins);
+    static bool load(const std::string& filename, LinkedList& menu, Coin& coins);
+};
+
+#endif  // SNAPSHOT_H
\ No newline at end of file
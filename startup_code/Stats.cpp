@@ -0,0 +1,184 @@
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <csignal>
+#include <algorithm>
+#include <pthread.h>
+#include "Stats.h"
+
+#ifndef FTT_NO_METRICS
+
+namespace {
+
+const char* const OP_NAMES[NUM_STAT_OPS] = {
+    "findItem", "search", "listByPrice", "canMakeChange", "makeChange", "session purchase", "session step",
+    "loadMenuFromFile", "loadDenominations", "Snapshot::load", "Journal::replay", "saveMenuToFile",
+    "saveDenominations", "Snapshot::save"
+};
+
+// One thread's counters. Only the owning thread writes them, so relaxed loads and stores are
+// enough and no read-modify-write is needed; print may read them while they change.
+struct ThreadStats {
+    std::atomic<unsigned long long> calls[NUM_STAT_OPS];
+    std::atomic<unsigned long long> buckets[NUM_STAT_OPS][STAT_BUCKETS];
+    std::atomic<unsigned long long> max[NUM_STAT_OPS];
+
+    ThreadStats() {
+        for (int op = 0; op < NUM_STAT_OPS; op++) {
+            calls[op].store(0, std::memory_order_relaxed);
+            for (int bucket = 0; bucket < STAT_BUCKETS; bucket++) {
+                buckets[op][bucket].store(0, std::memory_order_relaxed);
+            }
+            max[op].store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+void increment(std::atomic<unsigned long long>& counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// Counters of every thread that has recorded anything. They are kept after the thread exits.
+std::mutex& registryLock() {
+    static std::mutex lock;
+    return lock;
+}
+
+std::vector<std::unique_ptr<ThreadStats>>& registry() {
+    static std::vector<std::unique_ptr<ThreadStats>> threads;
+    return threads;
+}
+
+ThreadStats& localStats() {
+    thread_local ThreadStats* local = nullptr;
+    if (local == nullptr) {
+        std::lock_guard<std::mutex> locked(registryLock());
+        registry().emplace_back(new ThreadStats());
+        local = registry().back().get();
+    }
+    return *local;
+}
+
+// Values below 4 ns get a bucket each. Above that, a value whose highest set bit is bit e goes in
+// one of four buckets chosen by the two bits below it.
+unsigned bucketOf(unsigned long long nanoseconds) {
+    unsigned bucket = static_cast<unsigned>(nanoseconds);
+    if (nanoseconds >= 4) {
+        unsigned e = 63 - __builtin_clzll(nanoseconds);
+        bucket = (e - 1) * 4 + ((nanoseconds >> (e - 2)) & 3);
+    }
+    return bucket;
+}
+
+// The smallest value that falls in the next bucket.
+unsigned long long bucketLimit(unsigned bucket) {
+    unsigned long long limit = bucket + 1;
+    if (bucket >= 4) {
+        unsigned e = bucket / 4 + 1;
+        limit = static_cast<unsigned long long>(5 + bucket % 4) << (e - 2);
+    }
+    return limit;
+}
+
+// Returns the upper end of the bucket holding the given fraction of the timed calls, but no more
+// than the slowest call, in microseconds.
+double percentile(const unsigned long long* buckets, unsigned long long timed, unsigned long long max, double fraction) {
+    unsigned long long rank = static_cast<unsigned long long>(fraction * (timed - 1)) + 1;
+    unsigned long long seen = 0;
+    unsigned bucket = 0;
+    while (seen + buckets[bucket] < rank) {
+        seen += buckets[bucket];
+        bucket++;
+    }
+    return std::min(bucketLimit(bucket), max) / 1000.0;
+}
+
+}
+
+// This method counts a call of op and returns whether this call should be timed.
+bool Stats::begin(StatOp op) {
+    std::atomic<unsigned long long>& calls = localStats().calls[op];
+    unsigned long long made = calls.load(std::memory_order_relaxed);
+    calls.store(made + 1, std::memory_order_relaxed);
+    return op != STAT_FIND_ITEM || made % STAT_FIND_ITEM_SAMPLING == 0;
+}
+
+void Stats::record(StatOp op, unsigned long long nanoseconds) {
+    ThreadStats& stats = localStats();
+    increment(stats.buckets[op][bucketOf(nanoseconds)]);
+    if (nanoseconds > stats.max[op].load(std::memory_order_relaxed)) {
+        stats.max[op].store(nanoseconds, std::memory_order_relaxed);
+    }
+}
+
+// This method prints how many times each operation has run and the median, 99th percentile and
+// slowest of the timed calls.
+void Stats::print(std::ostream& out) {
+    std::lock_guard<std::mutex> locked(registryLock());
+    std::ios::fmtflags flags = out.flags();
+    out << "Operation Statistics (times in microseconds)\n";
+    out << "--------------------\n";
+    out << "Operation              |    Count |      p50 |      p99 |      max\n";
+    out << "--------------------------------------------------------------------\n";
+
+    for (int op = 0; op < NUM_STAT_OPS; op++) {
+        unsigned long long buckets[STAT_BUCKETS] = {};
+        unsigned long long calls = 0;
+        unsigned long long timed = 0;
+        unsigned long long max = 0;
+        for (const std::unique_ptr<ThreadStats>& thread : registry()) {
+            calls += thread->calls[op].load(std::memory_order_relaxed);
+            for (int bucket = 0; bucket < STAT_BUCKETS; bucket++) {
+                unsigned long long n = thread->buckets[op][bucket].load(std::memory_order_relaxed);
+                buckets[bucket] += n;
+                timed += n;
+            }
+            max = std::max(max, thread->max[op].load(std::memory_order_relaxed));
+        }
+        if (timed > 0) {
+            out << std::left << std::setw(22) << OP_NAMES[op] << " | " << std::right << std::setw(8) << calls
+                << std::fixed << std::setprecision(2)
+                << " | " << std::setw(8) << percentile(buckets, timed, max, 0.50)
+                << " | " << std::setw(8) << percentile(buckets, timed, max, 0.99)
+                << " | " << std::setw(8) << max / 1000.0 << '\n';
+        }
+    }
+    out.flush();
+    out.flags(flags);
+}
+
+// This method starts a thread that prints the statistics to standard error whenever the process
+// receives the signal. The signal is blocked in the calling thread, and so in every thread it
+// starts afterwards, so call it before starting any other thread.
+void Stats::dumpOnSignal(int signal) {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, signal);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    std::thread([signals]() {
+        int received = 0;
+        while (sigwait(&signals, &received) == 0) {
+            print(std::cerr);
+        }
+    }).detach();
+}
+
+#else
+
+bool Stats::begin(StatOp) {
+    return false;
+}
+
+void Stats::record(StatOp, unsigned long long) {}
+
+void Stats::print(std::ostream& out) {
+    out << "Operation statistics are not available in this build." << std::endl;
+}
+
+void Stats::dumpOnSignal(int) {}
+
+#endif  // FTT_NO_METRICS
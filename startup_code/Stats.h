@@ -0,0 +1,82 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <iosfwd>
+#include <chrono>
+
+// The operations that are timed. Session steps cover only the machine's own work for each line,
+// not the time spent waiting for the customer to type.
+enum StatOp {
+    STAT_FIND_ITEM,
+    STAT_SEARCH,
+    STAT_LIST_BY_PRICE,
+    STAT_CAN_MAKE_CHANGE,
+    STAT_MAKE_CHANGE,
+    STAT_SESSION_PURCHASE,
+    STAT_SESSION_STEP,       // handle one line of a session, at the terminal or served over a socket
+    STAT_LOAD_MENU,
+    STAT_LOAD_COINS,
+    STAT_LOAD_SNAPSHOT,
+    STAT_REPLAY_JOURNAL,
+    STAT_SAVE_MENU,
+    STAT_SAVE_COINS,
+    STAT_SAVE_SNAPSHOT,
+    NUM_STAT_OPS
+};
+
+// Histogram buckets per operation: four per power of two of nanoseconds, so a reported time is
+// within 25% of the real one.
+#define STAT_BUCKETS 256
+
+// Lookups take about as long as reading the clock twice, so only one in this many is timed. Every
+// call is still counted. Must be a power of two.
+#define STAT_FIND_ITEM_SAMPLING 16
+
+// Counts and latency histograms for the hot paths. Each thread records into its own counters, so
+// timing an operation costs two clock reads and a few uncontended stores. The counters of all
+// threads, including ones that have finished, are added up when the statistics are printed.
+// Operations that are cheaper than the clock are timed on a sample of calls.
+//
+// Building with -DFTT_NO_METRICS removes every timer; print then only says so.
+class Stats {
+public:
+    static bool begin(StatOp op);
+    static void record(StatOp op, unsigned long long nanoseconds);
+    static void print(std::ostream& out);
+    static void dumpOnSignal(int signal);
+};
+
+#ifndef FTT_NO_METRICS
+
+// Counts the enclosing scope as one operation and, unless it falls outside the sample, times it.
+class StatTimer {
+public:
+    explicit StatTimer(StatOp op) : op(op), timed(Stats::begin(op)) {
+        if (timed) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+    ~StatTimer() {
+        if (timed) {
+            Stats::record(op, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+    }
+
+private:
+    StatOp op;
+    bool timed;
+    std::chrono::steady_clock::time_point start;
+
+    StatTimer(const StatTimer&);
+    StatTimer& operator=(const StatTimer&);
+};
+
+#define STAT_TIME(op) StatTimer statTimer(op)
+
+#else
+
+#define STAT_TIME(op)
+
+#endif  // FTT_NO_METRICS
+
+#endif  // STATS_H
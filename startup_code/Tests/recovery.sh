@@ -0,0 +1,70 @@
+#!/bin/sh
+# Crash recovery test for ftt: "make recoverytest", or "sh Tests/recovery.sh <ftt binary>".
+#
+# Runs purchases through an interactive ftt fed from a pipe, kills it with SIGKILL part way through
+# another purchase, restarts it to replay the journal and save, and checks that the stock and the
+# float are exactly what the completed sales left, with nothing from the unfinished one.
+set -u
+
+FTT=$(cd "$(dirname "${1:-./ftt}")" 2>/dev/null && pwd)/$(basename "${1:-./ftt}")
+if [ ! -x "$FTT" ]; then
+    echo "No ftt binary at ${1:-./ftt}"
+    exit 1
+fi
+DIR=$(mktemp -d)
+FAILED=0
+trap 'rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+cat > foods.dat <<EOF
+F0001|Pie|A test pie|5.00|10
+F0002|Tart|A test tart|2.50|4
+EOF
+for value in 5 10 20 50 100 200 500 1000 2000 5000; do
+    echo "$value,10"
+done > coins.dat
+
+# Three pies paid for with $5, and a tart paid for with $2 and $1 for 50c change; then a pie that
+# is chosen and part paid for when the machine dies.
+mkfifo input
+"$FTT" foods.dat coins.dat < input > output.txt 2>&1 &
+PID=$!
+exec 3> input
+printf '2\nF0001\n500\n2\nF0001\n500\n2\nF0001\n500\n2\nF0002\n200\n100\n2\nF0001\n200\n' >&3
+
+TRIES=0
+while [ "$(wc -l 2>/dev/null < foods.dat.journal || echo 0)" -lt 4 ] && [ $TRIES -lt 50 ]; do
+    sleep 0.1
+    TRIES=$((TRIES + 1))
+done
+sleep 0.3
+kill -KILL $PID
+wait $PID 2>/dev/null
+exec 3>&-
+
+# The restart replays the journal; "Save and Exit" writes the recovered state. Export turns the
+# saved files, delta and all, back into plain ones to check.
+printf '3\n' | "$FTT" foods.dat coins.dat > restart.txt 2>&1
+"$FTT" --import foods.dat coins.dat state.bin > /dev/null &&
+    "$FTT" --export state.bin checked_foods.dat checked_coins.dat > /dev/null
+
+expect() {
+    if ! grep -qx "$2" "$1"; then
+        echo "FAIL: expected \"$2\" in $1:"
+        cat "$1"
+        FAILED=1
+    fi
+}
+expect restart.txt "Recovered 4 unsaved changes from foods.dat.journal"
+expect checked_foods.dat "F0001|Pie|A test pie|5.00|7"
+expect checked_foods.dat "F0002|Tart|A test tart|2.50|3"
+expect checked_coins.dat "500,13"
+expect checked_coins.dat "200,11"
+expect checked_coins.dat "100,11"
+expect checked_coins.dat "50,9"
+expect checked_coins.dat "5,10"
+
+if [ $FAILED -eq 0 ]; then
+    echo "Recovery test passed."
+fi
+exit $FAILED
@@ -0,0 +1,58 @@
+#include <cstring>
+#include "TextArena.h"
+
+TextArena::TextArena() : cursor(nullptr), end(nullptr), used(0), wasted(0), reserved(0), freeSpans() {}
+
+TextArena::~TextArena() {
+    for (char* block : blocks) {
+        delete[] block;
+    }
+}
+
+// This method copies a string into the arena, adds a null terminator and returns the stored copy.
+// A released span of the same size is reused before any new space is taken.
+const char* TextArena::add(const char* text, std::size_t length) {
+    std::size_t span = spanSize(length);
+    char* stored = nullptr;
+
+    if (span <= TEXT_REUSE_MAX && freeSpans[span / TEXT_SPAN_ALIGN - 1] != nullptr) {
+        char*& freeSpan = freeSpans[span / TEXT_SPAN_ALIGN - 1];
+        stored = freeSpan;
+        std::memcpy(&freeSpan, stored, sizeof(freeSpan));
+        wasted -= span;
+    } else {
+        if (static_cast<std::size_t>(end - cursor) < span) {
+            std::size_t blockSize = span > TEXT_BLOCK_SIZE ? span : TEXT_BLOCK_SIZE;
+            char* block = new char[blockSize];
+            blocks.push_back(block);
+            cursor = block;
+            end = block + blockSize;
+            reserved += blockSize;
+        }
+        stored = cursor;
+        cursor += span;
+    }
+    std::memcpy(stored, text, length);
+    stored[length] = '\0';
+    used += span;
+    return stored;
+}
+
+// This method gives back the span of a string add returned, of the length it was added with, for
+// the next string of its size. Nothing may read the string afterwards. Spans too large to keep
+// are only counted as wasted.
+void TextArena::release(const char* text, std::size_t length) {
+    std::size_t span = spanSize(length);
+    used -= span;
+    wasted += span;
+    if (span <= TEXT_REUSE_MAX) {
+        char* freed = const_cast<char*>(text);
+        char*& freeSpan = freeSpans[span / TEXT_SPAN_ALIGN - 1];
+        std::memcpy(freed, &freeSpan, sizeof(freeSpan));
+        freeSpan = freed;
+    }
+}
+
+std::size_t TextArena::spanSize(std::size_t length) {
+    return (length + TEXT_SPAN_ALIGN) / TEXT_SPAN_ALIGN * TEXT_SPAN_ALIGN;
+}
@@ -0,0 +1,46 @@
+#ifndef TEXTARENA_H
+#define TEXTARENA_H
+
+#include <vector>
+#include <cstddef>
+
+// Size of each block of text storage. Strings longer than this get a block of their own.
+#define TEXT_BLOCK_SIZE 65536
+
+// Each string takes a span of its length plus terminator rounded up to this many bytes, so that a
+// released span fits any string that rounds up to the same size. Released spans of up to
+// TEXT_REUSE_MAX bytes, which covers every description, are kept for reuse, a free list per size.
+#define TEXT_SPAN_ALIGN 8
+#define TEXT_REUSE_MAX 256
+
+// Storage for cold strings such as food descriptions. Strings are packed back to back in large
+// blocks and never move once stored. A released string's span is handed to the next string of
+// its size, so storage grows only with the most strings of each size held at once, however many
+// are added and removed. Blocks are freed together when the arena is destroyed.
+class TextArena {
+public:
+    TextArena();
+    ~TextArena();
+
+    const char* add(const char* text, std::size_t length);
+    void release(const char* text, std::size_t length);
+    std::size_t bytesUsed() const { return used; }
+    std::size_t bytesWasted() const { return wasted; }
+    std::size_t bytesReserved() const { return reserved; }
+
+private:
+    std::vector<char*> blocks;
+    char* cursor;
+    char* end;
+    std::size_t used;      // in spans of strings stored
+    std::size_t wasted;    // in spans released and not yet reused
+    std::size_t reserved;  // in blocks
+    char* freeSpans[TEXT_REUSE_MAX / TEXT_SPAN_ALIGN];  // by span size; each span holds the next
+
+    TextArena(const TextArena&);
+    TextArena& operator=(const TextArena&);
+
+    static std::size_t spanSize(std::size_t length);
+};
+
+#endif  // TEXTARENA_H
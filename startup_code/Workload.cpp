@@ -0,0 +1,194 @@
+#include <fstream>
+#include <cstdio>
+#include "Workload.h"
+#include "Coin.h"
+#include "FoodIdAllocator.h"
+
+namespace {
+
+const char* const STYLES[] = { "Spicy", "Smoked", "Crispy", "Baked", "Grilled", "Sweet", "Creamy", "Braised",
+                               "Roast", "Steamed", "Fried", "Tangy" };
+const char* const DISHES[] = { "Dumplings", "Noodles", "Curry", "Pie", "Tart", "Risotto", "Salad", "Stew",
+                               "Pancakes", "Burrito", "Soup", "Skewers" };
+const char* const ORIGINS[] = { "Korean", "Italian", "Scottish", "Mexican", "Ghanaian", "Turkish", "French", "Thai",
+                                "Peruvian", "Greek" };
+const char* const SIDES[] = { "rice", "bread", "a rich cheese sauce", "pickled vegetables", "fresh herbs",
+                              "whiskey sauce", "chilli oil", "honey" };
+
+// Coins that look like money but that the machine does not take.
+const int INVALID_COINS[] = { 1, 2, 25, 300, 10000 };
+
+template <typename T, unsigned N>
+constexpr unsigned countOf(const T (&)[N]) {
+    return N;
+}
+
+void appendCents(std::string& text, int cents) {
+    char amount[24];
+    text.append(amount, std::snprintf(amount, sizeof(amount), "%d.%02d", cents / 100, cents % 100));
+}
+
+void appendCoin(std::string& line, int coin, bool& first) {
+    if (!first) {
+        line += ',';
+    }
+    line += std::to_string(coin);
+    first = false;
+}
+
+}
+
+Workload::Workload(unsigned long long seed) : rng(seed), nextNumber(1) {}
+
+// This method writes a foods file of items with IDs F0001 up, each with a stock level of its own,
+// some of them none. Returns false if the file could not be written.
+bool Workload::writeCatalog(const std::string& filename, unsigned items) {
+    std::ofstream file(filename);
+    std::string line;
+    ids.clear();
+    prices.clear();
+
+    for (unsigned i = 1; i <= items && i <= MAX_FOOD_NUMBER; i++) {
+        int price = pickPrice();
+        ids.push_back(FoodIdAllocator::format(i));
+        prices.push_back(price);
+        line = ids.back() + '|' + makeName() + '|' + makeDescription() + '|';
+        appendCents(line, price);
+        line += '|' + std::to_string(pick(4) == 0 ? 0 : pick(30));
+        file << line << '\n';
+    }
+    nextNumber = static_cast<unsigned>(ids.size()) + 1;
+    return items <= MAX_FOOD_NUMBER && file.good();
+}
+
+// Writes a coins file holding every denomination: a working float, or a depleted one with one to
+// three of each.
+bool Workload::writeCoins(const std::string& filename, bool depleted) {
+    std::ofstream file(filename);
+    for (int value : DENOMINATION_VALUES) {
+        file << value << DELIM << (depleted ? 1 + pick(3) : 10 + pick(50)) << '\n';
+    }
+    return file.good();
+}
+
+// This method writes count transactions against the items of the last catalog written. Returns
+// false if the file could not be written.
+bool Workload::writeTransactions(const std::string& filename, unsigned count) {
+    std::ofstream file(filename);
+    std::string line;
+
+    for (unsigned i = 0; i < count; i++) {
+        unsigned kind = pick(100);
+        line.clear();
+        if (ids.empty() || (kind >= WORKLOAD_RESTOCK_PERCENT && kind < WORKLOAD_RESTOCK_PERCENT + WORKLOAD_ADD_PERCENT)) {
+            int price = pickPrice();
+            line = "A|" + makeName() + '|' + makeDescription() + '|';
+            appendCents(line, price);
+            if (nextNumber <= MAX_FOOD_NUMBER) {
+                ids.push_back(FoodIdAllocator::format(nextNumber++));
+                prices.push_back(price);
+            }
+        } else if (kind < WORKLOAD_RESTOCK_PERCENT) {
+            line = "Q|" + ids[pickItem()] + '|' + std::to_string(pick(40));
+        } else if (kind < WORKLOAD_RESTOCK_PERCENT + WORKLOAD_ADD_PERCENT + WORKLOAD_REMOVE_PERCENT) {
+            unsigned item = pickItem();
+            line = "R|" + ids[item];
+            ids.erase(ids.begin() + item);
+            prices.erase(prices.begin() + item);
+        } else if (pick(100) < WORKLOAD_UNKNOWN_PERCENT) {
+            line = "P|X" + std::to_string(pick(1000)) + '|';
+            appendPayment(line, pickPrice());
+        } else {
+            unsigned item = pickItem();
+            line = "P|" + ids[item] + '|';
+            appendPayment(line, prices[item]);
+        }
+        file << line << '\n';
+    }
+    return file.good();
+}
+
+unsigned Workload::pick(unsigned count) {
+    return std::uniform_int_distribution<unsigned>(0, count - 1)(rng);
+}
+
+// Most purchases are of the first tenth of the items, the popular ones.
+unsigned Workload::pickItem() {
+    unsigned popular = static_cast<unsigned>(ids.size() + 9) / 10;
+    return pick(10) < 6 ? pick(popular) : pick(static_cast<unsigned>(ids.size()));
+}
+
+// Prices run from 50c to $60, in multiples of 5c except for a few that cannot be paid exactly.
+int Workload::pickPrice() {
+    int price = 50 + 5 * static_cast<int>(pick(1191));
+    if (pick(100) < WORKLOAD_ODD_PRICE_PERCENT) {
+        price += 1 + pick(4);
+    }
+    return price;
+}
+
+std::string Workload::makeName() {
+    return std::string(STYLES[pick(countOf(STYLES))]) + ' ' + DISHES[pick(countOf(DISHES))];
+}
+
+std::string Workload::makeDescription() {
+    return std::string(ORIGINS[pick(countOf(ORIGINS))]) + " dish of " + DISHES[pick(countOf(DISHES))] +
+           " served with " + SIDES[pick(countOf(SIDES))];
+}
+
+// This method appends the coins of one purchase of an item priced price, in one of the ways the
+// class comment lists.
+void Workload::appendPayment(std::string& line, int price) {
+    unsigned way = pick(100);
+    bool first = true;
+    int paid = 0;
+
+    if (way < WORKLOAD_NOTE_PERCENT) {
+        // Notes of $50 until what is left is less than one, then the smallest note or coin over it.
+        while (price - paid > DENOMINATION_VALUES[NUM_DENOMS - 1]) {
+            appendCoin(line, DENOMINATION_VALUES[NUM_DENOMS - 1], first);
+            paid += DENOMINATION_VALUES[NUM_DENOMS - 1];
+        }
+        int slot = 0;
+        while (DENOMINATION_VALUES[slot] <= price - paid && slot < NUM_DENOMS - 1) {
+            slot++;
+        }
+        appendCoin(line, DENOMINATION_VALUES[slot + pick(NUM_DENOMS - slot)], first);
+    } else if (way < WORKLOAD_NOTE_PERCENT + WORKLOAD_COINS_PERCENT) {
+        while (paid < price) {
+            int coin = DENOMINATION_VALUES[pick(6)];
+            appendCoin(line, coin, first);
+            paid += coin;
+        }
+    } else if (way < WORKLOAD_NOTE_PERCENT + WORKLOAD_COINS_PERCENT + WORKLOAD_CANCEL_PERCENT) {
+        bool stopped = false;
+        while (!stopped) {
+            int coin = DENOMINATION_VALUES[pick(NUM_DENOMS)];
+            stopped = paid + coin >= price || pick(4) == 0;
+            if (!stopped) {
+                appendCoin(line, coin, first);
+                paid += coin;
+            }
+        }
+    } else {
+        // The exact price, largest coins first but not always the largest that fits; a price that
+        // is not a multiple of 5c is passed by the last coin.
+        bool invalid = way >= 100 - WORKLOAD_INVALID_PERCENT;
+        while (paid < price) {
+            int slot = NUM_DENOMS - 1;
+            while (slot > 0 && DENOMINATION_VALUES[slot] > price - paid) {
+                slot--;
+            }
+            slot -= slot > 0 && pick(3) == 0 ? 1 : 0;
+            if (invalid && pick(3) == 0) {
+                appendCoin(line, INVALID_COINS[pick(countOf(INVALID_COINS))], first);
+                invalid = false;
+            }
+            appendCoin(line, DENOMINATION_VALUES[slot], first);
+            paid += DENOMINATION_VALUES[slot];
+        }
+        if (invalid) {
+            appendCoin(line, INVALID_COINS[pick(countOf(INVALID_COINS))], first);
+        }
+    }
+}
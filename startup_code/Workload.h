@@ -0,0 +1,58 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <string>
+#include <vector>
+#include <random>
+
+// Out of every 100 transactions, how many of each kind are generated; the rest are purchases.
+#define WORKLOAD_RESTOCK_PERCENT 8
+#define WORKLOAD_ADD_PERCENT 3
+#define WORKLOAD_REMOVE_PERCENT 3
+
+// Out of every 100 purchases, how many pay in each way; the rest pay the exact price in coins.
+#define WORKLOAD_NOTE_PERCENT 30      // one note or coin worth more than the price, for change
+#define WORKLOAD_COINS_PERCENT 20     // small coins until the price is passed, for change
+#define WORKLOAD_CANCEL_PERCENT 10    // stop short of the price, as a customer who walks away
+#define WORKLOAD_INVALID_PERCENT 3    // include a coin the machine does not take
+#define WORKLOAD_UNKNOWN_PERCENT 2    // ask for an ID that is not on the menu
+
+// Out of every 100 items, how many have a price that no coins can pay exactly, such as $3.02.
+#define WORKLOAD_ODD_PRICE_PERCENT 2
+
+// A seeded generator of test data for ftt: a foods file of any size, a coins file, and a stream of
+// transactions in the format of a batch file (see Batch). The same seed always gives the same
+// files, so a stream can be replayed through two builds of ftt and the outcomes compared.
+//
+// Purchases favour a few popular items, as sales do, so stock runs out and restocks matter. They
+// pay in a mix of ways: exact coins, a large note, a run of small coins, too little (a
+// cancellation), an unacceptable coin, or for an unknown item. A depleted float holds only a
+// handful of coins, so making change is often hard or impossible. Removes and purchases also pick
+// items added earlier in the stream, by the IDs the machine will hand them, and leave alone
+// those removed, bar the odd request for an unknown item.
+class Workload {
+public:
+    explicit Workload(unsigned long long seed);
+
+    bool writeCatalog(const std::string& filename, unsigned items);
+    bool writeCoins(const std::string& filename, bool depleted);
+    bool writeTransactions(const std::string& filename, unsigned count);
+
+private:
+    std::mt19937_64 rng;
+    std::vector<std::string> ids;  // on the menu
+    std::vector<int> prices;       // in cents, one for each of ids
+    unsigned nextNumber;           // of the next ID the machine will hand out
+
+    Workload(const Workload&);
+    Workload& operator=(const Workload&);
+
+    unsigned pick(unsigned count);
+    unsigned pickItem();
+    int pickPrice();
+    std::string makeName();
+    std::string makeDescription();
+    void appendPayment(std::string& line, int price);
+};
+
+#endif  // WORKLOAD_H
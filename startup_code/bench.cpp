@@ -0,0 +1,1417 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <fstream>
+#include <streambuf>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <atomic>
+#include <climits>
+#include <memory>
+#include <initializer_list>
+#include "Coin.h"
+#include "LinkedList.h"
+#include "Snapshot.h"
+#include "SessionEngine.h"
+#include "Session.h"
+#include "FoodIdAllocator.h"
+
+// Micro-benchmarks for the hot paths of ftt. Build and run with "make bench".
+//
+// Every benchmark runs a fixed number of samples of a fixed number of operations with fixed random
+// seeds, so two runs do the same work and can be compared. Results are written to standard output
+// as JSON, one entry per benchmark:
+//
+//   name           what was measured, with the catalog or table size after the '/'
+//   ops            operations timed in total
+//   ns_per_op      mean wall time per operation
+//   allocs_per_op  calls to operator new per operation
+//   p50_ns ...     percentiles and maximum of the per-operation time of each sample
+//
+// Correctness checks made along the way are listed under "checks"; the exit status is non-zero if
+// any of them failed. Progress is reported on standard error. Benchmarks can be limited to those
+// whose names start with a prefix given as the only argument, such as "ftt_bench findItem".
+
+namespace {
+
+// Counts every allocation made through operator new, from any thread.
+std::atomic<unsigned long long> allocations(0);
+
+// Kept out of line so the compiler does not pair an inlined free with the built-in operator new.
+__attribute__((noinline)) void releaseBlock(void* block) {
+    std::free(block);
+}
+
+}
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* block = std::malloc(size != 0 ? size : 1);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void operator delete(void* block) noexcept {
+    releaseBlock(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept {
+    releaseBlock(block);
+}
+
+namespace {
+
+// Catalog sizes for the loaders, and the size used by the other catalog benchmarks.
+const unsigned LOAD_SIZES[] = { 1000, 100000, 1000000 };
+const unsigned CATALOG_ITEMS = 100000;
+
+// Lookups per sample and samples taken in the findItem benchmark.
+const unsigned LOOKUPS_PER_SAMPLE = 1000;
+const unsigned LOOKUP_SAMPLES = 1000;
+
+// Items removed from and put back into the catalog in the edit benchmarks, and the times the
+// same items are removed and put back in batches to check that their text storage is reused.
+const unsigned EDITS = 2000;
+const unsigned CHURN_ROUNDS = 20;
+
+// Catalog size for the search benchmarks, and the queries they run with the number of results wanted.
+const unsigned SEARCH_ITEMS = 1000000;
+const unsigned SEARCH_LIMIT = 20;
+const char* const SEARCH_QUERIES[] = { "item", "item 4242", "98765", "benchmark 31337", "umber", "esc item 5", "cheese" };
+
+// Random float states and change amounts in the change-making benchmarks.
+const unsigned CHANGE_FLOATS = 1000;
+const unsigned CHANGE_TRIALS = 200000;
+
+// Purchases made by each terminal in the session stress test, and the items it buys from.
+const unsigned SESSION_PURCHASES = 20000;
+const unsigned SESSION_ITEMS = 10000;
+
+// Units of the single item that every terminal races to buy in the last-unit test.
+const unsigned CONTESTED_STOCK = 1000;
+
+// Price changes made to one item while terminals are selling it, and restocks of one item while
+// terminals are selling its last few units.
+const unsigned REPRICES = 20000;
+const unsigned RESTOCKS = 20000;
+
+// Lookups per sample made by each reader thread, samples each takes while the menu is left alone,
+// and edits made while they read in the menu version benchmark.
+const unsigned VIEW_READS_PER_SAMPLE = 1000;
+const unsigned VIEW_SAMPLES = 500;
+const unsigned VIEW_EDITS = 20000;
+
+// Changes in each set made by the bulk change benchmark, spread evenly over the catalog.
+const unsigned CHANGE_SET_SIZE = 2000;
+
+// Queries per sample and samples taken in the price index benchmarks, and items repriced in them.
+const unsigned PRICE_QUERIES_PER_SAMPLE = 1000;
+const unsigned PRICE_SAMPLES = 100;
+const unsigned PRICE_EDITS = 2000;
+
+// Purchase sessions run through Session, and how many are kept going at once with their lines
+// interleaved, as the server's event loop interleaves them.
+const unsigned SERVED_SESSIONS = 20000;
+const unsigned SERVED_AT_ONCE = 1000;
+
+// One line of the report.
+struct Result {
+    std::string name;
+    unsigned long long ops;
+    double nsPerOp;
+    double allocsPerOp;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+};
+
+struct Check {
+    std::string name;
+    bool passed;
+};
+
+std::vector<Result> results;
+std::vector<Check> checks;
+std::string selected;
+
+// Swallows everything written to it, so rendering can be timed without a terminal.
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+bool wanted(const std::string& name) {
+    return name.compare(0, selected.size(), selected) == 0;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+    return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(fraction * sorted.size()))];
+}
+
+void progress(const Result& result) {
+    std::cerr << "  " << result.name << ": " << std::fixed << std::setprecision(1) << result.nsPerOp << " ns/op" << std::endl;
+}
+
+// Adds a result from per-operation sample times in nanoseconds, opsPerSample operations per sample.
+Result& report(const std::string& name, std::vector<double> samples, unsigned opsPerSample, unsigned long long allocated) {
+    std::sort(samples.begin(), samples.end());
+    double total = 0;
+    for (double sample : samples) {
+        total += sample;
+    }
+    unsigned long long ops = static_cast<unsigned long long>(samples.size()) * opsPerSample;
+    results.push_back(Result{name, ops, total / samples.size(), static_cast<double>(allocated) / ops,
+                             percentile(samples, 0.50), percentile(samples, 0.90), percentile(samples, 0.99), samples.back()});
+    return results.back();
+}
+
+// Times sampleCount samples of opsPerSample calls of op(i), where i counts calls from zero, and
+// records the mean time per call of each sample. setup(sample) runs untimed before each sample.
+template <typename Setup, typename Op>
+void measure(const std::string& name, unsigned sampleCount, unsigned opsPerSample, Setup setup, Op op) {
+    if (wanted(name)) {
+        std::vector<double> samples;
+        samples.reserve(sampleCount);
+        unsigned long long allocated = 0;
+        unsigned i = 0;
+        for (unsigned sample = 0; sample < sampleCount; sample++) {
+            setup(sample);
+            unsigned long long allocatedBefore = allocations.load();
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned n = 0; n < opsPerSample; n++) {
+                op(i++);
+            }
+            double seconds = secondsSince(start);
+            allocated += allocations.load() - allocatedBefore;
+            samples.push_back(seconds * 1e9 / opsPerSample);
+        }
+        progress(report(name, samples, opsPerSample, allocated));
+    }
+}
+
+template <typename Op>
+void measure(const std::string& name, unsigned sampleCount, unsigned opsPerSample, Op op) {
+    measure(name, sampleCount, opsPerSample, [](unsigned) {}, op);
+}
+
+// The ID of catalog item i: 'F' followed by four base-36 digits, so up to 1,679,616 distinct IDs
+// fit within IDLEN and increasing i gives increasing IDs.
+std::string catalogId(unsigned i) {
+    static const char digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    char id[IDLEN + 1] = { 'F', digits[i / 46656 % 36], digits[i / 1296 % 36], digits[i / 36 % 36], digits[i % 36], '\0' };
+    return id;
+}
+
+// Writes a foods file with count items in ID order, removing any delta file left by an earlier
+// benchmark so that it is not applied over the new file.
+void writeCatalog(const std::string& filename, unsigned count) {
+    std::remove((filename + MENU_DELTA_SUFFIX).c_str());
+    std::ofstream file(filename);
+    for (unsigned i = 0; i < count; i++) {
+        file << catalogId(i) << "|Item " << i << "|Synthetic description for benchmark item number " << i
+             << '|' << 1 + i % 50 << '.' << (i % 4) * 25 / 10 << (i % 4) * 25 % 10 << '\n';
+    }
+}
+
+// Writes a coins file of count lines cycling through the denominations.
+void writeCoins(const std::string& filename, unsigned count) {
+    std::ofstream file(filename);
+    for (unsigned i = 0; i < count; i++) {
+        file << DENOMINATION_VALUES[i % NUM_DENOMS] << DELIM << i % 100 << '\n';
+    }
+}
+
+// The greedy change-making loop that Coin used before the bounded change engine, kept as a baseline.
+bool greedyChange(const CoinFloat& coinFloat, long long cents_needed) {
+    CoinFloat temp = coinFloat;
+    for (int slot = NUM_DENOMS - 1; slot >= 0; slot--) {
+        while (cents_needed >= DENOMINATION_VALUES[slot] && temp.counts[slot] > 0) {
+            cents_needed -= DENOMINATION_VALUES[slot];
+            temp.counts[slot]--;
+        }
+    }
+    return cents_needed == 0;
+}
+
+// A float with a small random stock of every denomination, so that limited counts regularly
+// defeat the greedy strategy.
+CoinFloat randomFloat(std::mt19937& rng) {
+    std::uniform_int_distribution<int> stock(0, 4);
+    CoinFloat coinFloat;
+    for (int& count : coinFloat.counts) {
+        count = stock(rng);
+    }
+    return coinFloat;
+}
+
+void benchLoad() {
+    const std::string foodsFile = "bench_foods.dat";
+    const std::string coinsFile = "bench_coins.dat";
+    for (unsigned size : LOAD_SIZES) {
+        std::string suffix = "/" + std::to_string(size);
+        unsigned samples = size >= 1000000 ? 3 : size >= 100000 ? 10 : 200;
+        if (wanted("loadMenuFromFile" + suffix)) {
+            writeCatalog(foodsFile, size);
+        }
+        measure("loadMenuFromFile" + suffix, samples, 1, [&](unsigned) {
+            LinkedList menu;
+            menu.loadMenuFromFile(foodsFile);
+        });
+        if (wanted("loadDenominations" + suffix)) {
+            writeCoins(coinsFile, size);
+        }
+        measure("loadDenominations" + suffix, samples, 1, [&](unsigned) {
+            Coin coins;
+            coins.loadDenominations(coinsFile);
+        });
+    }
+    std::remove(foodsFile.c_str());
+    std::remove(coinsFile.c_str());
+}
+
+// With reuse turned on, removes items and adds some of them back through changes that carry their
+// IDs, removing one twice, and then adds new items before and after reloading the menu. Every add
+// must get an ID not on the menu, and no ID may be handed out twice.
+bool reusedIdsFree(const std::string& foodsFile) {
+    LinkedList menu;
+    Coin coins;
+    Journal journal;
+    std::remove((foodsFile + MENU_DELTA_SUFFIX).c_str());
+    std::ofstream(foodsFile) << "F0001|One|First|1.00\nF0002|Two|Second|2.00\nF0003|Three|Third|3.00\n";
+    menu.loadMenuFromFile(foodsFile);
+    FoodIdAllocator ids(true);
+    ids.rebuild(menu);
+    SessionEngine engine(menu, coins, journal, ids);
+    std::vector<MenuChange> changes;
+    std::vector<const char*> failures;
+    changes.push_back(MenuChange(MENU_ADD, FoodItem("F0002", "Two", "", Money::fromCents(200), 0), StrRef("Second", 6)));
+    changes.push_back(MenuChange(MENU_ADD, FoodItem("F0003", "Three", "", Money::fromCents(300), 0), StrRef("Third", 5)));
+
+    bool edited = engine.removeItem("F0002") == nullptr && engine.removeItem("F0003") == nullptr &&
+                  engine.applyChanges(changes, failures) && engine.removeItem("F0003") == nullptr;
+    std::string itemIds[4];
+    bool added = edited;
+    for (unsigned i = 0; i < 3 && added; i++) {
+        added = engine.addItem("New", "Added", Money::fromCents(100), itemIds[i]) == nullptr;
+    }
+
+    LinkedList reloaded;
+    FoodIdAllocator reloadedIds(true);
+    added = added && menu.saveMenuToFile(foodsFile);
+    reloaded.loadMenuFromFile(foodsFile);
+    reloadedIds.rebuild(reloaded);
+    SessionEngine reloadedEngine(reloaded, coins, journal, reloadedIds);
+    added = added && reloadedEngine.removeItem("F0001") == nullptr &&
+            reloadedEngine.addItem("New", "Added", Money::fromCents(100), itemIds[3]) == nullptr;
+    std::remove(foodsFile.c_str());
+    return added && itemIds[0] == "F0003" && itemIds[1] == "F0004" && itemIds[2] == "F0005" && itemIds[3] == "F0001" &&
+           reloaded.getCount() == 5;
+}
+
+void benchCatalog() {
+    const std::string foodsFile = "bench_foods.dat";
+    writeCatalog(foodsFile, CATALOG_ITEMS);
+    LinkedList menu;
+    menu.loadMenuFromFile(foodsFile);
+    std::string suffix = "/" + std::to_string(CATALOG_ITEMS);
+
+    std::mt19937 rng(20240602);
+    std::uniform_int_distribution<unsigned> pick(0, CATALOG_ITEMS - 1);
+    std::vector<std::string> lookups(LOOKUPS_PER_SAMPLE * 16);
+    for (std::string& id : lookups) {
+        id = catalogId(pick(rng));
+    }
+    Node* found = nullptr;
+    measure("findItem" + suffix, LOOKUP_SAMPLES, LOOKUPS_PER_SAMPLE, [&](unsigned i) {
+        found = menu.findItem(lookups[i % lookups.size()]);
+    });
+    if (wanted("findItem")) {
+        checks.push_back(Check{"findItem finds catalog items", found != nullptr});
+    }
+
+    // Remove a random set of items, then put the same items back.
+    std::vector<unsigned> order(CATALOG_ITEMS);
+    for (unsigned i = 0; i < CATALOG_ITEMS; i++) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+    std::vector<FoodItem> removed;
+    std::vector<std::string> descriptions;
+    for (unsigned i = 0; i < EDITS; i++) {
+        Node* node = menu.findItem(catalogId(order[i]));
+        descriptions.push_back(node->data->description);
+        removed.push_back(*node->data);
+    }
+    for (unsigned i = 0; i < EDITS; i++) {
+        removed[i].description = descriptions[i].c_str();
+    }
+
+    NullBuffer discard;
+    std::streambuf* console = std::cout.rdbuf(&discard);
+    measure("removeItem" + suffix, EDITS, 1, [&](unsigned i) {
+        menu.removeItem(removed[i].id);
+    });
+    std::cout.rdbuf(console);
+    measure("insertNode" + suffix, EDITS, 1, [&](unsigned i) {
+        menu.insertNode(removed[i]);
+    });
+    checks.push_back(Check{"removeItem and insertNode restore the catalog", menu.getCount() == CATALOG_ITEMS});
+
+    std::vector<MenuChange> removals;
+    std::vector<MenuChange> additions;
+    std::vector<const char*> failures;
+    for (unsigned i = 0; i < EDITS; i++) {
+        removals.push_back(MenuChange(MENU_REMOVE, removed[i], StrRef()));
+        additions.push_back(MenuChange(MENU_ADD, removed[i], StrRef(descriptions[i].data(), descriptions[i].size())));
+    }
+    std::size_t textBytes = menu.getTextBytes();
+    bool churned = true;
+    for (unsigned round = 0; round < CHURN_ROUNDS && churned; round++) {
+        churned = menu.applyChanges(removals, failures) && menu.applyChanges(additions, failures);
+    }
+    checks.push_back(Check{"removed descriptions are reused, so churn does not grow text storage",
+                           churned && menu.getCount() == CATALOG_ITEMS && menu.getTextBytes() <= textBytes + TEXT_BLOCK_SIZE});
+
+    // Finding the next ID by scanning the menu, as adding an item used to, against the allocator.
+    int highestSeen = 0;
+    measure("next food ID: scan menu" + suffix, 20, 1, [&](unsigned) {
+        for (Node* current = menu.getHead(); current != nullptr; current = current->next) {
+            std::string id = current->data->id;
+            highestSeen = std::max(highestSeen, std::stoi(id.substr(1)));
+        }
+    });
+    FoodIdAllocator ids(true);
+    ids.rebuild(menu);
+    std::string nextId;
+    measure("FoodIdAllocator::allocate" + suffix, LOOKUP_SAMPLES, LOOKUPS_PER_SAMPLE, [&](unsigned) {
+        ids.allocate(nextId);
+    });
+    measure("FoodIdAllocator::release" + suffix, LOOKUP_SAMPLES, LOOKUPS_PER_SAMPLE, [&](unsigned i) {
+        ids.release(FoodIdAllocator::format(i + 1));
+    });
+    if (wanted("FoodIdAllocator")) {
+        checks.push_back(Check{"reused food IDs are never on the menu after removes, re-adds and a reload",
+                               reusedIdsFree(foodsFile)});
+    }
+
+    std::remove(foodsFile.c_str());
+}
+
+void benchChange() {
+    std::mt19937 rng(20240601);
+    std::uniform_int_distribution<int> amount(1, 400);
+    std::vector<CoinFloat> floats(CHANGE_FLOATS);
+    std::vector<long long> amounts(CHANGE_TRIALS);
+    for (CoinFloat& coinFloat : floats) {
+        coinFloat = randomFloat(rng);
+    }
+    for (long long& cents : amounts) {
+        cents = amount(rng) * 5;
+    }
+    Coin coins;
+    std::string suffix = "/" + std::to_string(CHANGE_FLOATS);
+    unsigned samples = CHANGE_TRIALS / CHANGE_FLOATS;
+    int greedySolved = 0;
+    int engineSolved = 0;
+    unsigned changeMade = 0;
+    int used[NUM_DENOMS];
+
+    measure("greedyChange" + suffix, samples, CHANGE_FLOATS, [&](unsigned i) {
+        greedySolved += greedyChange(floats[i % CHANGE_FLOATS], amounts[i]);
+    });
+    measure("canMakeChange" + suffix, samples, CHANGE_FLOATS, [&](unsigned i) {
+        coins.setFloat(floats[i % CHANGE_FLOATS]);
+        engineSolved += coins.canMakeChange(Money::fromCents(amounts[i]));
+    });
+    measure("makeChange" + suffix, samples, CHANGE_FLOATS, [&](unsigned i) {
+        coins.setFloat(floats[i % CHANGE_FLOATS]);
+        changeMade += coins.makeChange(Money::fromCents(amounts[i]), used);
+    });
+    if (wanted("canMakeChange") && wanted("greedyChange")) {
+        checks.push_back(Check{"change engine solves everything greedy does", engineSolved >= greedySolved});
+    }
+    if (wanted("canMakeChange") && wanted("makeChange")) {
+        checks.push_back(Check{"makeChange agrees with canMakeChange", changeMade == static_cast<unsigned>(engineSolved)});
+    }
+}
+
+void benchRender() {
+    const std::string foodsFile = "bench_foods.dat";
+    const std::string savedFile = "bench_saved.dat";
+    const std::string reloadedFile = "bench_reloaded.dat";
+    NullBuffer discard;
+    for (unsigned size : { 1000u, CATALOG_ITEMS }) {
+        std::string suffix = "/" + std::to_string(size);
+        unsigned samples = size >= 100000 ? 10 : 200;
+        writeCatalog(foodsFile, size);
+        LinkedList menu;
+        menu.loadMenuFromFile(foodsFile);
+
+        std::streambuf* console = std::cout.rdbuf(&discard);
+        measure("displayMenu" + suffix, samples, 1, [&](unsigned) {
+            menu.displayMenu();
+        });
+        // A price change throws the rendered menu away, so the next display builds it again.
+        measure("displayMenu after edit" + suffix, samples, 1, [&](unsigned sample) {
+            menu.setPrice(catalogId(sample % size), Money::fromCents(100 + sample));
+        }, [&](unsigned) {
+            menu.displayMenu();
+        });
+        unsigned pages = menu.getPageCount(MENU_PAGE_SIZE);
+        measure("displayMenuPage" + suffix, 10, 1000, [&](unsigned i) {
+            menu.displayMenuPage(i * 7919 % pages + 1, MENU_PAGE_SIZE);
+        });
+        std::cout.rdbuf(console);
+
+        if (size == 1000) {
+            std::stringbuf before, repriced, paged;
+            std::cout.rdbuf(&before);
+            menu.displayMenu();
+            menu.setPrice(catalogId(0), Money::fromCents(123456));
+            std::cout.rdbuf(&repriced);
+            menu.displayMenu();
+            std::cout.rdbuf(&paged);
+            for (unsigned page = 1; page <= pages; page++) {
+                menu.displayMenuPage(page, MENU_PAGE_SIZE);
+            }
+            std::cout.rdbuf(console);
+            std::string pageText = paged.str();
+            checks.push_back(Check{"displayMenu shows a price change",
+                                   repriced.str() != before.str() && repriced.str().find("$1234.56\n") != std::string::npos});
+            checks.push_back(Check{"menu pages hold every item once",
+                                   static_cast<unsigned>(std::count(pageText.begin(), pageText.end(), '$')) == menu.getCount()});
+        }
+        measure("saveMenuToFile" + suffix, samples, 1, [&](unsigned) {
+            menu.saveMenuToFile(savedFile);
+        });
+        // A save after one price change writes one segment of the delta file, not the whole menu.
+        measure("saveChanges after one edit" + suffix, samples, 1, [&](unsigned sample) {
+            menu.setPrice(catalogId(sample * 7919 % size), Money::fromCents(200 + sample));
+        }, [&](unsigned) {
+            menu.saveChanges(foodsFile);
+            LinkedList::installChanges(foodsFile);
+            menu.markSaved();
+        });
+
+        if (size == 1000) {
+            menu.eraseItem(catalogId(1));
+            menu.insertNode(FoodItem(catalogId(size), "Added", "Added for the delta check", Money::fromCents(999), 3));
+            Node* restocked = menu.findItem(catalogId(2));
+            restocked->data->on_hand.set(7);
+            menu.markChanged(*restocked->data);
+            bool saved = menu.saveChanges(foodsFile) && LinkedList::installChanges(foodsFile);
+            menu.markSaved();
+
+            LinkedList reloaded;
+            reloaded.loadMenuFromFile(foodsFile);
+            menu.saveMenuToFile(savedFile);
+            reloaded.saveMenuToFile(reloadedFile);
+            std::ifstream expected(savedFile);
+            std::ifstream actual(reloadedFile);
+            std::stringstream expectedText, actualText;
+            expectedText << expected.rdbuf();
+            actualText << actual.rdbuf();
+            checks.push_back(Check{"saveChanges reloads as the same menu", saved && expectedText.str() == actualText.str()});
+        }
+        std::remove((foodsFile + MENU_DELTA_SUFFIX).c_str());
+    }
+    std::remove(foodsFile.c_str());
+    std::remove(savedFile.c_str());
+    std::remove(reloadedFile.c_str());
+}
+
+// Compares startup and shutdown with the text files against the binary snapshot.
+void benchSnapshot() {
+    const std::string foodsFile = "bench_foods.dat";
+    const std::string snapshotFile = "bench_state.snap";
+    std::string suffix = "/" + std::to_string(CATALOG_ITEMS);
+    writeCatalog(foodsFile, CATALOG_ITEMS);
+    LinkedList menu;
+    Coin coins;
+    menu.loadMenuFromFile(foodsFile);
+
+    measure("Snapshot::save" + suffix, 10, 1, [&](unsigned) {
+        Snapshot::save(snapshotFile, menu, coins);
+    });
+    measure("Snapshot::load" + suffix, 10, 1, [&](unsigned) {
+        LinkedList loadedMenu;
+        Coin loadedCoins;
+        Snapshot::load(snapshotFile, loadedMenu, loadedCoins);
+    });
+    std::remove(foodsFile.c_str());
+    std::remove(snapshotFile.c_str());
+}
+
+// Value of everything in the float, in cents.
+long long floatValue(const Coin& coins) {
+    long long total = 0;
+    for (int slot = 0; slot < NUM_DENOMS; slot++) {
+        total += static_cast<long long>(coins.getFloat().counts[slot]) * DENOMINATION_VALUES[slot];
+    }
+    return total;
+}
+
+// Runs terminals threads that each make SESSION_PURCHASES random purchases paid with a $50 note,
+// so that every sale needs change. Afterwards the float must have grown by exactly the value of
+// the sales and the stock must have fallen by exactly their number.
+void stressSessions(const std::string& foodsFile, unsigned terminals) {
+    LinkedList menu;
+    Coin coins;
+    Journal journal;
+    menu.loadMenuFromFile(foodsFile);
+    for (int value : DENOMINATION_VALUES) {
+        coins.setCount(value, 1000000000 / value);
+    }
+    unsigned long long stockBefore = 0;
+    for (Node* current = menu.getHead(); current != nullptr; current = current->next) {
+        current->data->on_hand.set(SESSION_PURCHASES);
+        stockBefore += SESSION_PURCHASES;
+    }
+    long long floatBefore = floatValue(coins);
+
+    FoodIdAllocator ids(false);
+    ids.rebuild(menu);
+    SessionEngine engine(menu, coins, journal, ids);
+    std::atomic<long long> salesValue(0);
+    std::atomic<unsigned> sales(0);
+    std::vector<std::vector<double>> latencies(terminals);
+    std::vector<std::thread> threads;
+    unsigned long long allocatedBefore = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < terminals; t++) {
+        threads.emplace_back([&engine, &menu, &salesValue, &sales, &latencies, t]() {
+            std::mt19937 rng(t + 1);
+            std::uniform_int_distribution<unsigned> pick(0, SESSION_ITEMS - 1);
+            int change[NUM_DENOMS];
+            std::vector<double>& times = latencies[t];
+            const int payment = 5000;
+            long long value = 0;
+            unsigned made = 0;
+            times.reserve(SESSION_PURCHASES);
+            for (unsigned i = 0; i < SESSION_PURCHASES; i++) {
+                std::string id = catalogId(pick(rng));
+                auto began = std::chrono::steady_clock::now();
+                bool sold = engine.purchase(id, &payment, 1, change) == nullptr;
+                times.push_back(secondsSince(began) * 1e9);
+                if (sold) {
+                    value += menu.findItem(id)->data->price.asCents();
+                    made++;
+                }
+            }
+            salesValue += value;
+            sales += made;
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double seconds = secondsSince(start);
+    unsigned long long allocated = allocations.load() - allocatedBefore;
+
+    unsigned long long stockAfter = 0;
+    for (Node* current = menu.getHead(); current != nullptr; current = current->next) {
+        stockAfter += current->data->on_hand.get();
+    }
+    std::string name = "SessionEngine::purchase/" + std::to_string(terminals) + "-terminals";
+    checks.push_back(Check{name + " keeps float and stock consistent",
+                           floatValue(coins) == floatBefore + salesValue && stockBefore - stockAfter == sales});
+
+    // The percentiles are of single purchases; ns_per_op is wall time over all terminals, so it
+    // falls as terminals are added if purchases scale across cores.
+    std::vector<double> all;
+    for (const std::vector<double>& times : latencies) {
+        all.insert(all.end(), times.begin(), times.end());
+    }
+    Result& result = report(name, all, 1, allocated);
+    result.nsPerOp = seconds * 1e9 / (terminals * SESSION_PURCHASES);
+    progress(result);
+}
+
+// Every terminal tries to buy all CONTESTED_STOCK units of one item. Exactly that many sales must
+// succeed, however the terminals interleave.
+void contestLastUnit(const std::string& foodsFile, unsigned terminals) {
+    LinkedList menu;
+    Coin coins;
+    Journal journal;
+    menu.loadMenuFromFile(foodsFile);
+    for (int value : DENOMINATION_VALUES) {
+        coins.setCount(value, 1000000);
+    }
+    Node* contested = menu.getHead();
+    contested->data->on_hand.set(CONTESTED_STOCK);
+
+    FoodIdAllocator ids(false);
+    ids.rebuild(menu);
+    SessionEngine engine(menu, coins, journal, ids);
+    std::atomic<unsigned> sales(0);
+    std::vector<std::thread> threads;
+    std::string id = contested->data->id;
+    for (unsigned t = 0; t < terminals; t++) {
+        threads.emplace_back([&engine, &sales, &id]() {
+            int change[NUM_DENOMS];
+            const int payment = 5000;
+            for (unsigned i = 0; i < CONTESTED_STOCK; i++) {
+                sales += engine.purchase(id, &payment, 1, change) == nullptr;
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    checks.push_back(Check{std::to_string(terminals) + " terminals sell exactly the last " + std::to_string(CONTESTED_STOCK) + " units",
+                           sales == CONTESTED_STOCK && contested->data->on_hand.get() == 0});
+}
+
+// Terminals sell one item while another thread changes its price over and over, each change
+// replacing the item with a new version. Every sale must come off the one stock level the versions
+// share, and none may leave a unit reserved.
+void repriceDuringSales(const std::string& foodsFile, unsigned terminals) {
+    LinkedList menu;
+    Coin coins;
+    Journal journal;
+    menu.loadMenuFromFile(foodsFile);
+    for (int value : DENOMINATION_VALUES) {
+        coins.setCount(value, 1000000000 / value);
+    }
+    std::string id = menu.getHead()->data->id;
+    menu.getHead()->data->on_hand.set(1000000000);
+
+    FoodIdAllocator ids(false);
+    ids.rebuild(menu);
+    SessionEngine engine(menu, coins, journal, ids);
+    std::atomic<unsigned> sales(0);
+    std::atomic<bool> repricing(true);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < terminals; t++) {
+        threads.emplace_back([&engine, &sales, &repricing, &id]() {
+            int change[NUM_DENOMS];
+            const int payment = 5000;
+            while (repricing) {
+                sales += engine.purchase(id, &payment, 1, change) == nullptr;
+            }
+        });
+    }
+    std::vector<const char*> failures;
+    for (unsigned i = 0; i < REPRICES; i++) {
+        std::vector<MenuChange> changes;
+        changes.push_back(MenuChange(MENU_REPRICE, FoodItem(id, "", "", Money::fromCents(100 + i % 2 * 5), 0), StrRef()));
+        engine.applyChanges(changes, failures);
+    }
+    repricing = false;
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const StockLevel& stock = menu.findItem(id)->data->on_hand;
+    checks.push_back(Check{std::to_string(terminals) + " terminals lose no sales to " + std::to_string(REPRICES) + " price changes",
+                           sales > 0 && stock.get() == 1000000000 - sales && stock.available() == stock.get()});
+}
+
+// Terminals sell one item while another thread restocks it to one, two or three units over and
+// over, with a journal open. Replaying the journal onto the menu and float as they were must then
+// give the same stock level and float, whatever order the sales and restocks came in.
+void restockDuringSales(const std::string& foodsFile, unsigned terminals) {
+    const std::string journalFile = "bench_journal.dat";
+    LinkedList menu;
+    Coin coins;
+    Journal journal;
+    menu.loadMenuFromFile(foodsFile);
+    for (int value : DENOMINATION_VALUES) {
+        coins.setCount(value, 1000000);
+    }
+    std::string id = menu.getHead()->data->id;
+    std::remove(journalFile.c_str());
+    journal.open(journalFile, JOURNAL_BUFFERED);
+
+    FoodIdAllocator ids(false);
+    ids.rebuild(menu);
+    SessionEngine engine(menu, coins, journal, ids);
+    std::atomic<bool> restocking(true);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < terminals; t++) {
+        threads.emplace_back([&engine, &restocking, &id]() {
+            int change[NUM_DENOMS];
+            const int payment = 5000;
+            while (restocking) {
+                engine.purchase(id, &payment, 1, change);
+            }
+        });
+    }
+    for (unsigned i = 0; i < RESTOCKS; i++) {
+        engine.restock(id, 1 + i % 3);
+    }
+    restocking = false;
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    journal.sync();
+
+    LinkedList replayedMenu;
+    Coin replayedCoins;
+    FoodIdAllocator replayedIds(false);
+    replayedMenu.loadMenuFromFile(foodsFile);
+    for (int value : DENOMINATION_VALUES) {
+        replayedCoins.setCount(value, 1000000);
+    }
+    Journal::replay(journalFile, replayedMenu, replayedCoins, replayedIds);
+    checks.push_back(Check{std::to_string(terminals) + " terminals and " + std::to_string(RESTOCKS) +
+                               " restocks of the last units replay from the journal as they ran",
+                           replayedMenu.findItem(id)->data->on_hand.get() == menu.findItem(id)->data->on_hand.get() &&
+                               floatValue(replayedCoins) == floatValue(coins)});
+    journal.checkpoint();
+    std::remove(journalFile.c_str());
+}
+
+// One terminal selling with a buffered journal open, as the machine does. Once the first sales
+// have grown the journal buffer and the list of changed items, a sale must not allocate at all.
+void steadyPurchases(const std::string& foodsFile) {
+    const std::string journalFile = "bench_journal.dat";
+    LinkedList menu;
+    Coin coins;
+    Journal journal;
+    menu.loadMenuFromFile(foodsFile);
+    for (int value : DENOMINATION_VALUES) {
+        coins.setCount(value, 1000000000 / value);
+    }
+    std::vector<std::string> itemIds;
+    for (Node* current = menu.getHead(); current != nullptr; current = current->next) {
+        current->data->on_hand.set(1000000000);
+        if (current->data->price.asCents() < 5000) {
+            itemIds.push_back(current->data->id);
+        }
+    }
+    std::remove(journalFile.c_str());
+    journal.open(journalFile, JOURNAL_BUFFERED);
+
+    FoodIdAllocator ids(false);
+    ids.rebuild(menu);
+    SessionEngine engine(menu, coins, journal, ids);
+    int change[NUM_DENOMS];
+    const int payment = 5000;
+    unsigned failed = 0;
+    for (unsigned i = 0; i < 4 * SESSION_ITEMS; i++) {
+        failed += engine.purchase(itemIds[i % itemIds.size()], &payment, 1, change) != nullptr;
+    }
+    unsigned long long allocatedBefore = allocations.load();
+    for (unsigned i = 0; i < SESSION_PURCHASES; i++) {
+        failed += engine.purchase(itemIds[i * 7919 % itemIds.size()], &payment, 1, change) != nullptr;
+    }
+    unsigned long long allocated = allocations.load() - allocatedBefore;
+    measure("SessionEngine::purchase/steady-state", 50, 1000, [&](unsigned i) {
+        failed += engine.purchase(itemIds[i * 7919 % itemIds.size()], &payment, 1, change) != nullptr;
+    });
+    checks.push_back(Check{"steady-state purchases make no allocations", allocated == 0 && failed == 0});
+    journal.checkpoint();
+    std::remove(journalFile.c_str());
+}
+
+// Stress test of concurrent terminals sharing one menu and float through a SessionEngine, on
+// 1, 2, 4 ... terminals up to the number of hardware threads (at least 4).
+void benchSessions() {
+    if (wanted("SessionEngine::purchase")) {
+        const std::string foodsFile = "bench_foods.dat";
+        writeCatalog(foodsFile, SESSION_ITEMS);
+        for (unsigned terminals = 1; terminals <= std::max(4u, std::thread::hardware_concurrency()); terminals *= 2) {
+            stressSessions(foodsFile, terminals);
+        }
+        contestLastUnit(foodsFile, 8);
+        repriceDuringSales(foodsFile, 4);
+        restockDuringSales(foodsFile, 4);
+        steadyPurchases(foodsFile);
+        std::remove(foodsFile.c_str());
+    }
+}
+
+// Reader threads look items up through MenuReader, first on a menu left alone, then while one
+// thread removes, re-adds and reprices items as fast as it can. Only items at even positions are
+// edited, so every lookup of an odd one must succeed, and every version a reader scans in full
+// must hold its items in ID order. ns_per_op is wall time over all readers, as for the sessions.
+void readMenuViews(LinkedList& menu, unsigned readers, bool editing, const std::string& name) {
+    std::vector<std::string> stableIds;
+    std::vector<FoodItem> edited;
+    std::vector<std::string> descriptions;
+    for (unsigned i = 0; i < CATALOG_ITEMS; i++) {
+        if (i % 2 == 1) {
+            stableIds.push_back(catalogId(i));
+        } else if (edited.size() < EDITS) {
+            Node* node = menu.findItem(catalogId(i));
+            descriptions.push_back(node->data->description);
+            edited.push_back(*node->data);
+        }
+    }
+    for (unsigned i = 0; i < edited.size(); i++) {
+        edited[i].description = descriptions[i].c_str();
+    }
+
+    std::atomic<bool> writing(editing);
+    std::atomic<bool> consistent(true);
+    std::atomic<unsigned long long> reads(0);
+    std::vector<std::vector<double>> latencies(readers);
+    std::vector<std::thread> threads;
+    for (std::vector<double>& times : latencies) {
+        times.reserve(VIEW_SAMPLES * 16);
+    }
+    std::vector<double> editTimes;
+    editTimes.reserve(VIEW_EDITS);
+    unsigned long long allocatedBefore = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < readers; t++) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 rng(t + 1);
+            std::uniform_int_distribution<unsigned> pick(0, stableIds.size() - 1);
+            std::vector<double>& times = latencies[t];
+            bool found = true;
+            unsigned sample = 0;
+            while (editing ? writing.load() : sample < VIEW_SAMPLES) {
+                auto began = std::chrono::steady_clock::now();
+                for (unsigned i = 0; i < VIEW_READS_PER_SAMPLE; i++) {
+                    MenuReader view(menu);
+                    found = found && view->find(stableIds[pick(rng)]) != nullptr;
+                }
+                times.push_back(secondsSince(began) * 1e9 / VIEW_READS_PER_SAMPLE);
+                if (++sample % 64 == 0) {
+                    MenuReader view(menu);
+                    unsigned scanned = 0;
+                    FoodKey previous = 0;
+                    for (const FoodItem* item : *view) {
+                        found = found && item->key > previous;
+                        previous = item->key;
+                        scanned++;
+                    }
+                    found = found && scanned == view->getCount();
+                }
+            }
+            reads += static_cast<unsigned long long>(sample) * VIEW_READS_PER_SAMPLE;
+            consistent = consistent && found;
+        });
+    }
+
+    NullBuffer discard;
+    std::streambuf* console = std::cout.rdbuf(&discard);
+    unsigned long long editsBefore = allocations.load();
+    for (unsigned i = 0; editing && i < VIEW_EDITS; i++) {
+        const FoodItem& item = edited[i % edited.size()];
+        auto began = std::chrono::steady_clock::now();
+        if (i / edited.size() % 2 == 0) {
+            menu.removeItem(item.id);
+            menu.insertNode(item);
+        } else {
+            menu.setPrice(item.id, Money::fromCents(100 + i % 5000));
+        }
+        editTimes.push_back(secondsSince(began) * 1e9);
+    }
+    unsigned long long editAllocations = allocations.load() - editsBefore;
+    writing = false;
+    std::cout.rdbuf(console);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double seconds = secondsSince(start);
+    // Apart from starting the threads, everything allocated outside the edits was allocated by readers.
+    unsigned long long readAllocations = allocations.load() - allocatedBefore - editAllocations;
+
+    std::vector<double> all;
+    for (const std::vector<double>& times : latencies) {
+        all.insert(all.end(), times.begin(), times.end());
+    }
+    Result& result = report(name, all, VIEW_READS_PER_SAMPLE, readAllocations);
+    result.nsPerOp = seconds * 1e9 / reads;
+    progress(result);
+    if (editing) {
+        progress(report("LinkedList edit with readers/" + std::to_string(CATALOG_ITEMS), editTimes, 1, editAllocations));
+    }
+    checks.push_back(Check{name + " sees consistent versions", consistent && menu.getCount() == CATALOG_ITEMS});
+}
+
+void benchViews() {
+    if (wanted("MenuReader::find")) {
+        const std::string foodsFile = "bench_foods.dat";
+        writeCatalog(foodsFile, CATALOG_ITEMS);
+        LinkedList menu;
+        menu.loadMenuFromFile(foodsFile);
+        unsigned readers = std::max(2u, std::thread::hardware_concurrency());
+        std::string suffix = "/" + std::to_string(CATALOG_ITEMS) + "/" + std::to_string(readers) + "-readers";
+        readMenuViews(menu, readers, false, "MenuReader::find" + suffix);
+        readMenuViews(menu, readers, true, "MenuReader::find" + suffix + "-under-edits");
+        std::remove(foodsFile.c_str());
+    }
+}
+
+// A set of changes to every (CATALOG_ITEMS / CHANGE_SET_SIZE)th catalog item, in ID order. With
+// out set, the items are in turn removed, repriced, run down and repriced; otherwise they are put
+// back as writeCatalog wrote them. descriptions holds the text of the items added.
+std::vector<MenuChange> catalogChanges(bool out, std::vector<std::string>& descriptions) {
+    std::vector<MenuChange> changes;
+    descriptions.clear();
+    descriptions.reserve(CHANGE_SET_SIZE);
+    for (unsigned k = 0; k < CHANGE_SET_SIZE; k++) {
+        unsigned i = k * (CATALOG_ITEMS / CHANGE_SET_SIZE);
+        Money price = Money::fromCents(out ? 99 + k : (1 + i % 50) * 100 + i % 4 * 25);
+        unsigned units = out ? 5 : DEFAULT_FOOD_STOCK_LEVEL;
+        if (k % 4 == 0 && out) {
+            changes.push_back(MenuChange(MENU_REMOVE, FoodItem(catalogId(i), "", "", Money(), 0), StrRef()));
+        } else if (k % 4 == 0) {
+            descriptions.push_back("Synthetic description for benchmark item number " + std::to_string(i));
+            changes.push_back(MenuChange(MENU_ADD, FoodItem(catalogId(i), "Item " + std::to_string(i), "", price, units),
+                                         StrRef(descriptions.back().data(), descriptions.back().size())));
+        } else if (k % 4 == 2) {
+            changes.push_back(MenuChange(MENU_RESTOCK, FoodItem(catalogId(i), "", "", Money(), units), StrRef()));
+        } else {
+            changes.push_back(MenuChange(MENU_REPRICE, FoodItem(catalogId(i), "", "", price, 0), StrRef()));
+        }
+    }
+    return changes;
+}
+
+// Makes the changes one call at a time, as the interactive prompts do.
+void applyOneByOne(LinkedList& menu, const std::vector<MenuChange>& changes) {
+    for (const MenuChange& change : changes) {
+        if (change.type == MENU_ADD) {
+            std::string description = change.description.str();
+            FoodItem item(change.item);
+            item.description = description.c_str();
+            menu.insertNode(item);
+        } else if (change.type == MENU_REMOVE) {
+            menu.eraseItem(change.item.id);
+        } else if (change.type == MENU_REPRICE) {
+            menu.setPrice(change.item.id, change.item.price);
+        } else {
+            FoodItem* item = menu.findItem(change.item.id)->data;
+            item->on_hand.set(change.item.on_hand.get());
+            menu.markChanged(*item);
+        }
+    }
+}
+
+// Returns whether two menus hold the same items, with the same prices and stock levels.
+bool sameMenu(const LinkedList& first, const LinkedList& second) {
+    MenuReader a(first);
+    MenuReader b(second);
+    bool same = a->getCount() == b->getCount();
+    MenuView::const_iterator at = a->begin();
+    MenuView::const_iterator bt = b->begin();
+    for (; same && at != a->end(); ++at, ++bt) {
+        const FoodItem& x = **at;
+        const FoodItem& y = **bt;
+        same = std::strcmp(x.id, y.id) == 0 && std::strcmp(x.name, y.name) == 0 &&
+               std::strcmp(x.description, y.description) == 0 && x.price == y.price && x.on_hand.get() == y.on_hand.get();
+    }
+    return same;
+}
+
+// Times a set of changes spread over the catalog made in one merge with applyChanges, against the
+// same changes made one call at a time. Sets alternate between taking items out and putting them
+// back, so the catalog ends as it started. ns_per_op is for a whole set.
+void benchChanges() {
+    std::string setName = std::to_string(CHANGE_SET_SIZE) + " changes";
+    if (wanted("LinkedList::applyChanges") || wanted(setName)) {
+        const std::string foodsFile = "bench_foods.dat";
+        writeCatalog(foodsFile, CATALOG_ITEMS);
+        LinkedList menu;
+        LinkedList original;
+        menu.loadMenuFromFile(foodsFile);
+        original.loadMenuFromFile(foodsFile);
+        std::string suffix = "/" + std::to_string(CATALOG_ITEMS);
+        std::vector<std::string> outDescriptions;
+        std::vector<std::string> backDescriptions;
+        std::vector<MenuChange> out = catalogChanges(true, outDescriptions);
+        std::vector<MenuChange> back = catalogChanges(false, backDescriptions);
+        std::vector<const char*> failures;
+
+        bool applied = true;
+        measure("LinkedList::applyChanges " + setName + suffix, 20, 1, [&](unsigned i) {
+            applied = menu.applyChanges(i % 2 == 0 ? out : back, failures) && applied;
+        });
+        measure(setName + " one at a time" + suffix, 4, 1, [&](unsigned i) {
+            applyOneByOne(menu, i % 2 == 0 ? out : back);
+        });
+        checks.push_back(Check{"applyChanges puts the catalog back", applied && sameMenu(menu, original)});
+
+        LinkedList oneByOne;
+        oneByOne.loadMenuFromFile(foodsFile);
+        applyOneByOne(oneByOne, out);
+        menu.applyChanges(out, failures);
+        checks.push_back(Check{"applyChanges matches one change at a time", sameMenu(menu, oneByOne)});
+
+        // A removal of an item that is not there fails the whole set.
+        back.push_back(MenuChange(MENU_REMOVE, FoodItem(catalogId(CATALOG_ITEMS), "", "", Money(), 0), StrRef()));
+        bool rejected = !menu.applyChanges(back, failures) && failures.back() != nullptr &&
+                        std::count(failures.begin(), failures.end(), nullptr) == static_cast<long>(back.size() - 1);
+        checks.push_back(Check{"applyChanges makes none of a set with a failing change", rejected && sameMenu(menu, oneByOne)});
+        std::remove(foodsFile.c_str());
+    }
+}
+
+// Lists items priced from low to high, cheapest first, by scanning the whole menu and sorting the
+// matches: what a price query costs without the index, and the answer it must give.
+void scanByPrice(const LinkedList& menu, Money low, Money high, unsigned skip, unsigned limit,
+                 std::vector<Node*>& matches, std::vector<Node*>& scratch) {
+    scratch.clear();
+    for (Node* current = menu.getHead(); current != nullptr; current = current->next) {
+        if (current->data->price >= low && current->data->price <= high) {
+            scratch.push_back(current);
+        }
+    }
+    std::sort(scratch.begin(), scratch.end(), [](const Node* a, const Node* b) {
+        return a->data->price < b->data->price || (a->data->price == b->data->price && a->data->key < b->data->key);
+    });
+    matches.clear();
+    for (std::size_t i = skip; i < scratch.size() && matches.size() < limit; i++) {
+        matches.push_back(scratch[i]);
+    }
+}
+
+// Returns whether listByPrice and countByPrice agree with a scan of the menu for random ranges
+// and pages of them.
+bool priceQueriesMatchScan(const LinkedList& menu, std::mt19937& rng) {
+    std::uniform_int_distribution<int> cents(0, 5200);
+    std::vector<Node*> listed;
+    std::vector<Node*> scanned;
+    std::vector<Node*> scratch;
+    bool same = true;
+    for (unsigned trial = 0; trial < 200 && same; trial++) {
+        Money low = Money::fromCents(cents(rng));
+        Money high = trial % 10 == 0 ? low : Money::fromCents(cents(rng));
+        unsigned skip = trial % 3 == 0 ? 0 : rng() % (menu.getCount() / 50 + 1);
+        unsigned limit = trial % 5 == 0 ? menu.getCount() : MENU_PAGE_SIZE;
+        menu.listByPrice(low, high, skip, limit, listed);
+        scanByPrice(menu, low, high, 0, menu.getCount(), scanned, scratch);
+        same = menu.countByPrice(low, high) == scanned.size();
+        scanByPrice(menu, low, high, skip, limit, scanned, scratch);
+        same = same && listed == scanned;
+    }
+    return same;
+}
+
+// Times counting and listing the items in random price ranges through the price index, against a
+// scan and sort of the menu, and checks the index against the scan before and after items are
+// repriced, removed and added.
+void benchPrices() {
+    if (wanted("PriceIndex") || wanted("countByPrice") || wanted("listByPrice") || wanted("price range") ||
+        wanted("setPrice")) {
+        const std::string foodsFile = "bench_foods.dat";
+        writeCatalog(foodsFile, CATALOG_ITEMS);
+        std::string suffix = "/" + std::to_string(CATALOG_ITEMS);
+        std::vector<Node*> matches;
+        std::vector<Node*> scratch;
+
+        std::unique_ptr<LinkedList> fresh;
+        measure("PriceIndex: build" + suffix, 5, 1, [&](unsigned) {
+            fresh.reset(new LinkedList());
+            fresh->loadMenuFromFile(foodsFile);
+        }, [&](unsigned) {
+            fresh->countByPrice(Money(), Money());
+        });
+        fresh.reset();
+
+        LinkedList menu;
+        menu.loadMenuFromFile(foodsFile);
+        std::mt19937 rng(20240623);
+        std::uniform_int_distribution<int> cents(100, 5100);
+        std::vector<std::pair<Money, Money>> ranges(PRICE_QUERIES_PER_SAMPLE);
+        for (std::pair<Money, Money>& range : ranges) {
+            int a = cents(rng);
+            int b = cents(rng);
+            range = std::make_pair(Money::fromCents(std::min(a, b)), Money::fromCents(std::max(a, b)));
+        }
+        unsigned counted = 0;
+        measure("countByPrice" + suffix, PRICE_SAMPLES, PRICE_QUERIES_PER_SAMPLE, [&](unsigned i) {
+            const std::pair<Money, Money>& range = ranges[i % ranges.size()];
+            counted += menu.countByPrice(range.first, range.second);
+        });
+        measure("listByPrice 20 cheapest" + suffix, PRICE_SAMPLES, PRICE_QUERIES_PER_SAMPLE, [&](unsigned) {
+            menu.listByPrice(Money(), Money::fromCents(INT_MAX), 0, MENU_PAGE_SIZE, matches);
+        });
+        measure("listByPrice page of range" + suffix, PRICE_SAMPLES, PRICE_QUERIES_PER_SAMPLE, [&](unsigned i) {
+            const std::pair<Money, Money>& range = ranges[i % ranges.size()];
+            menu.listByPrice(range.first, range.second, i * 7919 % 1000, MENU_PAGE_SIZE, matches);
+        });
+        measure("price range: scan and sort" + suffix, 20, 1, [&](unsigned i) {
+            const std::pair<Money, Money>& range = ranges[i % ranges.size()];
+            scanByPrice(menu, range.first, range.second, i * 7919 % 1000, MENU_PAGE_SIZE, matches, scratch);
+        });
+        bool matched = priceQueriesMatchScan(menu, rng);
+
+        measure("setPrice with price index" + suffix, PRICE_EDITS, 1, [&](unsigned i) {
+            menu.setPrice(catalogId(i * 41 % CATALOG_ITEMS), Money::fromCents(cents(rng)));
+        });
+        for (unsigned i = 0; i < PRICE_EDITS; i++) {
+            menu.eraseItem(catalogId(i * 43 % CATALOG_ITEMS + 1));
+        }
+        std::vector<std::string> descriptions;
+        std::vector<MenuChange> back = catalogChanges(false, descriptions);
+        std::vector<const char*> failures;
+        for (unsigned k = 0; k < CHANGE_SET_SIZE; k += 4) {
+            menu.eraseItem(back[k].item.id);
+        }
+        menu.applyChanges(back, failures);
+        checks.push_back(Check{"listByPrice and countByPrice match a scan and sort",
+                               matched && priceQueriesMatchScan(menu, rng)});
+        std::remove(foodsFile.c_str());
+    }
+}
+
+// Sends each line to the session, and returns whether the last reply holds the text.
+bool replies(Session& session, std::initializer_list<std::string> lines, const char* text) {
+    std::string reply;
+    for (const std::string& line : lines) {
+        reply.clear();
+        session.handleLine(StrRef(line.data(), line.size()), reply);
+    }
+    return reply.find(text) != std::string::npos;
+}
+
+// Leaves one unit of lastId and has sessions choose it: while one holds it another is told it is
+// out of stock, and it is back once the holder cancels or is destroyed. Then a held unit of
+// removedId, removed before it is paid for, refunds the payment.
+bool heldUntilDone(SessionEngine& engine, LinkedList& menu, const Coin& coins, const std::string& lastId,
+                   const std::string& removedId) {
+    StockLevel& stock = menu.findItem(lastId)->data->on_hand;
+    stock.set(1);
+    std::unique_ptr<Session> first(new Session(engine, menu, coins));
+    Session second(engine, menu, coins);
+    bool held = replies(*first, { "2", lastId }, "You have selected") &&
+                replies(second, { "2", lastId }, "out of stock") && stock.available() == 0;
+    bool cancelled = replies(*first, { "" }, "cancelled") && stock.available() == 1;
+    bool dropped = replies(*first, { "2", lastId }, "You have selected") && stock.available() == 0;
+    first.reset();
+    dropped = dropped && stock.available() == 1;
+    bool sold = replies(second, { lastId, "5000" }, "Your change is") && stock.get() == 0 && stock.available() == 0;
+
+    Session third(engine, menu, coins);
+    CoinFloat before = coins.getFloat();
+    bool refunded = replies(third, { "2", removedId }, "You have selected") && engine.removeItem(removedId) == nullptr &&
+                    replies(third, { "5000" }, "could not be completed") &&
+                    std::equal(before.counts, before.counts + NUM_DENOMS, coins.getFloat().counts);
+    return held && cancelled && dropped && sold && refunded;
+}
+
+// The value of the coins in a float, in cents.
+long long floatValue(const CoinFloat& coinFloat) {
+    long long cents = 0;
+    for (int slot = 0; slot < NUM_DENOMS; slot++) {
+        cents += static_cast<long long>(coinFloat.counts[slot]) * DENOMINATION_VALUES[slot];
+    }
+    return cents;
+}
+
+// Chooses itemId in a session, doubles its price with applyChanges, then pays $50: the sale must go
+// through at the price first asked for, so the float gains exactly that.
+bool heldPriceKept(SessionEngine& engine, LinkedList& menu, const Coin& coins, const std::string& itemId) {
+    Session session(engine, menu, coins);
+    Money price = menu.findItem(itemId)->data->price;
+    unsigned onHand = menu.findItem(itemId)->data->on_hand.get();
+    long long before = floatValue(coins.getFloat());
+    std::vector<MenuChange> changes;
+    std::vector<const char*> failures;
+    changes.push_back(MenuChange(MENU_REPRICE, FoodItem(itemId, "", "", Money::fromCents(price.asCents() * 2), 0), StrRef()));
+
+    bool repriced = replies(session, { "2", itemId }, "You have selected") && engine.applyChanges(changes, failures);
+    bool sold = replies(session, { "5000" }, "Your change is");
+    const FoodItem& item = *menu.findItem(itemId)->data;
+    return repriced && sold && floatValue(coins.getFloat()) - before == price.asCents() &&
+           item.price.asCents() == price.asCents() * 2 && item.on_hand.get() == onHand - 1;
+}
+
+// Feeds SERVED_AT_ONCE sessions a purchase each, a line to every session in turn, as the server
+// would with that many clients: choose Purchase Meal, enter an ID, pay $50 and end the session.
+// ns_per_op is the time per whole session. Every session must sell exactly one unit, and a sale
+// cancelled after a coin must leave the stock and the float as they were.
+void benchServedSessions() {
+    std::string name = "Session: purchase/" + std::to_string(SERVED_AT_ONCE) + " at once";
+    if (wanted(name)) {
+        const std::string foodsFile = "bench_foods.dat";
+        writeCatalog(foodsFile, SESSION_ITEMS);
+        LinkedList menu;
+        Coin coins;
+        Journal journal;
+        menu.loadMenuFromFile(foodsFile);
+        for (int value : DENOMINATION_VALUES) {
+            coins.setCount(value, 1000000000 / value);
+        }
+        std::vector<std::string> itemIds;
+        for (Node* current = menu.getHead(); current != nullptr; current = current->next) {
+            current->data->on_hand.set(1000000);
+            if (current->data->price.asCents() < 5000) {
+                itemIds.push_back(current->data->id);
+            }
+        }
+        FoodIdAllocator ids(false);
+        ids.rebuild(menu);
+        SessionEngine engine(menu, coins, journal, ids);
+
+        std::vector<std::unique_ptr<Session>> sessions(SERVED_AT_ONCE);
+        std::vector<double> samples;
+        std::string reply;
+        const std::string lines[] = { "2", "", "5000", "3" };
+        unsigned sold = 0;
+        unsigned ended = 0;
+        unsigned long long allocatedBefore = allocations.load();
+        for (unsigned sample = 0; sample < SERVED_SESSIONS / SERVED_AT_ONCE; sample++) {
+            auto start = std::chrono::steady_clock::now();
+            for (std::unique_ptr<Session>& session : sessions) {
+                session.reset(new Session(engine, menu, coins));
+                reply.clear();
+                session->start(reply);
+            }
+            for (unsigned step = 0; step < 4; step++) {
+                for (unsigned s = 0; s < SERVED_AT_ONCE; s++) {
+                    const std::string& line = step == 1 ? itemIds[(sample * SERVED_AT_ONCE + s) % itemIds.size()] : lines[step];
+                    reply.clear();
+                    sessions[s]->handleLine(StrRef(line.data(), line.size()), reply);
+                    sold += step == 2 && reply.find("Your change is") != std::string::npos;
+                    ended += step == 3 && sessions[s]->isEnded();
+                }
+            }
+            samples.push_back(secondsSince(start) * 1e9 / SERVED_AT_ONCE);
+        }
+        progress(report(name, samples, SERVED_AT_ONCE, allocations.load() - allocatedBefore));
+
+        unsigned long long stock = 0;
+        for (Node* current = menu.getHead(); current != nullptr; current = current->next) {
+            stock += 1000000 - current->data->on_hand.get();
+        }
+        Session cancelled(engine, menu, coins);
+        CoinFloat before = coins.getFloat();
+        unsigned onHand = menu.findItem(itemIds[0])->data->on_hand.get();
+        const std::string cancelLines[] = { "2", itemIds[0], "5", "" };
+        cancelled.start(reply);
+        for (const std::string& line : cancelLines) {
+            cancelled.handleLine(StrRef(line.data(), line.size()), reply);
+        }
+        bool untouched = menu.findItem(itemIds[0])->data->on_hand.get() == onHand &&
+                         std::equal(before.counts, before.counts + NUM_DENOMS, coins.getFloat().counts);
+        checks.push_back(Check{"interleaved sessions each sell one unit, and a cancelled one sells none",
+                               sold == SERVED_SESSIONS && ended == SERVED_SESSIONS && stock == SERVED_SESSIONS && untouched});
+        checks.push_back(Check{"a chosen last unit is held until its session pays, cancels or goes",
+                               heldUntilDone(engine, menu, coins, itemIds[1], itemIds[2])});
+        checks.push_back(Check{"a sale held before a price change is charged the price it was held at",
+                               heldPriceKept(engine, menu, coins, itemIds[3])});
+        std::remove(foodsFile.c_str());
+    }
+}
+
+// Writes text as a JSON string, escaping the characters a benchmark or check name may hold.
+void writeJsonString(const std::string& text) {
+    std::cout << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            std::cout << '\\';
+        }
+        std::cout << c;
+    }
+    std::cout << '"';
+}
+
+void writeReport() {
+    std::cout << std::setprecision(1) << std::fixed;
+    std::cout << "{\n  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n  \"benchmarks\": [";
+    for (std::size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        std::cout << (i > 0 ? "," : "") << "\n    {\"name\": ";
+        writeJsonString(r.name);
+        std::cout << ", \"ops\": " << r.ops
+                  << ", \"ns_per_op\": " << r.nsPerOp << ", \"allocs_per_op\": " << std::setprecision(3) << r.allocsPerOp
+                  << std::setprecision(1) << ", \"p50_ns\": " << r.p50 << ", \"p90_ns\": " << r.p90
+                  << ", \"p99_ns\": " << r.p99 << ", \"max_ns\": " << r.max << "}";
+    }
+    std::cout << "\n  ],\n  \"checks\": [";
+    for (std::size_t i = 0; i < checks.size(); i++) {
+        std::cout << (i > 0 ? "," : "") << "\n    {\"name\": ";
+        writeJsonString(checks[i].name);
+        std::cout << ", \"passed\": " << (checks[i].passed ? "true" : "false") << "}";
+    }
+    std::cout << "\n  ]\n}" << std::endl;
+}
+
+// Times searches of a large catalog through the index against a plain scan of every item, and checks
+// that the index follows items being removed and added back.
+void benchSearch() {
+    const std::string foodsFile = "bench_foods.dat";
+    if (wanted("search")) {
+        std::string suffix = "/" + std::to_string(SEARCH_ITEMS);
+        writeCatalog(foodsFile, SEARCH_ITEMS);
+        LinkedList menu;
+        menu.loadMenuFromFile(foodsFile);
+        std::vector<Node*> matches;
+
+        // The first search builds the index.
+        measure("search: build index" + suffix, 1, 1, [&](unsigned) {
+            menu.search("item", SEARCH_LIMIT, matches);
+        });
+        for (const char* query : SEARCH_QUERIES) {
+            measure(std::string("search: ") + query + suffix, 20, 100, [&](unsigned) {
+                menu.search(query, SEARCH_LIMIT, matches);
+            });
+        }
+        measure("search: linear scan" + suffix, 5, 1, [&](unsigned) {
+            matches.clear();
+            for (Node* current = menu.getHead(); current != nullptr; current = current->next) {
+                if (matches.size() < SEARCH_LIMIT && std::strstr(current->data->description, "umber 4242") != nullptr) {
+                    matches.push_back(current);
+                }
+            }
+        });
+
+        // Item 4242 is followed by 42420 to 42429 and then 424200 onwards; matches on the description,
+        // such as item 14242, come after all of them.
+        menu.search("item 4242", SEARCH_LIMIT, matches);
+        bool ranked = matches.size() == SEARCH_LIMIT && std::string(matches[0]->data->name) == "Item 4242";
+        for (std::size_t i = 1; i < matches.size(); i++) {
+            ranked = ranked && std::strncmp(matches[i]->data->name, "Item 4242", 9) == 0;
+        }
+        checks.push_back(Check{"search ranks the exact name first", ranked});
+
+        Node* node = menu.findItem(catalogId(31337));
+        FoodItem removed = *node->data;
+        std::string description = node->data->description;
+        removed.description = description.c_str();
+        menu.eraseItem(removed.id);
+        menu.search("item 31337", SEARCH_LIMIT, matches);
+        bool gone = !matches.empty() && std::string(matches[0]->data->name) == "Item 313370";
+        menu.insertNode(removed);
+        menu.search("item 31337", SEARCH_LIMIT, matches);
+        checks.push_back(Check{"search follows removed and added items",
+                               gone && !matches.empty() && std::string(matches[0]->data->name) == "Item 31337"});
+        std::remove(foodsFile.c_str());
+    }
+}
+
+}
+
+int main(int argc, char** argv) {
+    selected = argc > 1 ? argv[1] : "";
+    std::cerr << "Running benchmarks" << (selected.empty() ? "" : " starting with " + selected) << std::endl;
+    benchLoad();
+    benchCatalog();
+    benchSearch();
+    benchChange();
+    benchRender();
+    benchSnapshot();
+    benchSessions();
+    benchViews();
+    benchChanges();
+    benchPrices();
+    benchServedSessions();
+    writeReport();
+
+    bool passed = true;
+    for (const Check& check : checks) {
+        passed = passed && check.passed;
+    }
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
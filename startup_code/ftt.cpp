@@ -4,341 +4,460 @@
 #include <fstream>
 #include <iomanip>
 #include <limits>
-#include <sstream>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include <cstdio>
+#include <csignal>
 #include "Food.h"
 #include "Coin.h"
+#include "Money.h"
+#include "DataFile.h"
+#include "Snapshot.h"
+#include "Journal.h"
+#include "Batch.h"
+#include "Session.h"
+#include "SessionServer.h"
+#include "Stats.h"
+#include "FoodIdAllocator.h"
+#include "SaveFile.h"
 using std::string;
 
-// This function gets the highest existing food item ID in the menu list.
-// It iterates through the linked list, checks the ID of each item, and updates the highest ID found.
-int getHighestExistingID(const LinkedList& menuList) {
-    int highestID = 0;
-    Node* current = menuList.getHead();
-    while (current != nullptr) {
-        std::string id = current->data->id;
-        if (id[0] == 'F') {
-            int num = std::stoi(id.substr(1));
-            if (num > highestID) {
-                highestID = num;
-            }
+// Returns the text of a line typed at a prompt without the blanks around it.
+StrRef typedText(const std::string& input) {
+    std::size_t first = input.find_first_not_of(" \t\r");
+    std::size_t last = input.find_last_not_of(" \t\r");
+    return first == std::string::npos ? StrRef() : StrRef(input.data() + first, last - first + 1);
+}
+
+// This function shows page 1 of a list of pages with showPage(page), then whichever page the user
+// enters until they press enter to return to the main menu.
+template <typename ShowPage>
+void browsePages(unsigned pages, ShowPage showPage) {
+    int page = 1;
+    bool show = true;
+    bool done = false;
+    std::string pageInput;
+
+    while (!done) {
+        if (show) {
+            showPage(page);
+        }
+        std::cout << "Enter a page number (1-" << pages << "), or press enter to return to the main menu: ";
+        if (!std::getline(std::cin, pageInput) || pageInput.empty()) {
+            std::cin.clear();
+            done = true;
+        } else if (!DataFile::parseInt(StrRef(pageInput.data(), pageInput.size()), page) ||
+                   page < 1 || static_cast<unsigned>(page) > pages) {
+            std::cout << "Invalid input. Please enter a page number from 1 to " << pages << "." << std::endl;
+            show = false;
+        } else {
+            show = true;
         }
-        current = current->next;
     }
-    return highestID;
 }
 
-// This function generates the next available food item ID by incrementing the highest existing ID.
-std::string generateNextFoodID(const LinkedList& menuList, int& foodCounter) {
-    if (foodCounter == 0) { // Initialize once
-        foodCounter = getHighestExistingID(menuList);
+// This function prints food items as rows of the menu, in the order given. As in the menu, the ID
+// column is MENU_ID_WIDTH wide unless a longer ID needs more room.
+void printItems(const std::vector<Node*>& items) {
+    std::size_t idWidth = MENU_ID_WIDTH;
+    for (Node* item : items) {
+        idWidth = std::max(idWidth, std::strlen(item->data->id));
+    }
+    std::cout << std::setw(idWidth) << std::left << "ID" << " | Name                                     | Price\n";
+    std::cout << std::string(61 + idWidth, '-') << '\n';
+    for (Node* item : items) {
+        std::cout << std::setw(idWidth) << std::left << item->data->id << " | "
+                  << std::setw(NAMELEN) << item->data->name << " | $" << item->data->price << '\n';
     }
-    std::ostringstream ss;
-    ss << 'F' << std::setw(4) << std::setfill('0') << (foodCounter + 1);
-    return ss.str();
+    std::cout << std::endl;
 }
 
-// This function adds a new food item to the menu list.
-// It prompts the user for the food item's details, generates a new ID, creates the item, and inserts it into the list.
-void addFoodItem(LinkedList& menuList) {
-    std::string itemName, itemDescription, itemPriceStr;
-    double itemPrice;
-    const unsigned defaultOnHand = 20;
-    int foodCounter = 0;
-
-    bool validInput = false;
-    bool userCancelled = false;
-    std::string itemID = generateNextFoodID(menuList, foodCounter);
-
-    while (!validInput && !userCancelled) {
-        std::cout << "This new meal item will have the Item ID of " << itemID << "." << std::endl;
-        std::cout << "Enter the item name: ";
-        if (!std::getline(std::cin, itemName) || itemName.empty()) {
-            if (std::cin.eof() || itemName.empty()) {
-                std::cin.clear();
-                std::cout << "Returning to main menu." << std::endl;
-                userCancelled = true;
-            }
+// This function asks for a price at a prompt until it gets one, leaving price alone if the user
+// just presses enter. Returns false if input ends.
+bool readPrice(const char* prompt, Money& price) {
+    std::string priceInput;
+    bool entered = false;
+    bool ended = false;
+
+    while (!entered && !ended) {
+        std::cout << prompt;
+        int cents = 0;
+        if (!std::getline(std::cin, priceInput)) {
+            std::cin.clear();
+            ended = true;
+        } else if (typedText(priceInput).empty()) {
+            entered = true;
+        } else if (DataFile::parseCents(typedText(priceInput), cents)) {
+            price = Money::fromCents(cents);
+            entered = true;
         } else {
-            validInput = true;
-        }
-    }
-
-    if (!userCancelled) {
-        validInput = false;
-        while (!validInput && !userCancelled) {
-            std::cout << "Enter the item description: ";
-            if (!std::getline(std::cin, itemDescription) || itemDescription.empty()) {
-                if (std::cin.eof() || itemDescription.empty()) {
-                    std::cin.clear();
-                    std::cout << "Returning to main menu." << std::endl;
-                    userCancelled = true;
-                }
-            } else {
-                validInput = true;
-            }
+            std::cout << "Invalid input. Please enter a price in dollars and cents, such as 12.50." << std::endl;
         }
     }
+    return entered;
+}
 
-    if (!userCancelled) {
-        validInput = false;
-        while (!validInput && !userCancelled) {
-            std::cout << "Enter the price for this item (in dollars and cents): ";
-            if (!std::getline(std::cin, itemPriceStr) || itemPriceStr.empty()) {
-                if (std::cin.eof() || itemPriceStr.empty()) {
-                    std::cin.clear();
-                    std::cout << "Returning to main menu and deleting the item with ID " << itemID << "." << std::endl;
-                    userCancelled = true;
+// This function lists the food items within a price range the user gives, cheapest first, a page
+// at a time. Either end of the range can be left open by pressing enter.
+void displayMealsByPrice(const LinkedList& menuList) {
+    Money low;
+    Money high = Money::fromCents(INT_MAX);
+
+    if (readPrice("Enter the lowest price, or press enter for no lowest price: ", low) &&
+        readPrice("Enter the highest price, or press enter for no highest price: ", high)) {
+        unsigned found = menuList.countByPrice(low, high);
+        if (found == 0) {
+            std::cout << "No food items are priced in that range." << std::endl;
+        } else {
+            unsigned pages = (found - 1) / MENU_PAGE_SIZE + 1;
+            std::vector<Node*> items;
+            auto showPage = [&](unsigned page) {
+                menuList.listByPrice(low, high, (page - 1) * MENU_PAGE_SIZE, MENU_PAGE_SIZE, items);
+                printItems(items);
+                if (pages > 1) {
+                    std::cout << "Page " << page << " of " << pages << std::endl;
                 }
+            };
+            std::cout << found << " food items are priced in that range, cheapest first." << std::endl;
+            if (pages == 1) {
+                showPage(1);
             } else {
-                std::istringstream iss(itemPriceStr);
-                if (iss >> itemPrice && itemPrice >= 0) {
-                    validInput = true;
-                } else {
-                    std::cout << "Invalid input. Please enter a valid price in dollars and cents (non-negative value)." << std::endl;
-                }
+                browsePages(pages, showPage);
             }
         }
-    }
-
-    if (!userCancelled) {
-        Food newItem(itemID, itemName, itemDescription, itemPrice, defaultOnHand);
-        menuList.insertNode(newItem);
-        foodCounter++;
-        std::cout << "This item \"" << itemName << " - " << itemDescription
-                << "\" has now been added to the food menu." << std::endl;
     } else {
-        std::cout << "No item was added to the menu." << std::endl;
+        std::cout << "Returning to main menu." << std::endl;
     }
 }
 
-
-// This function removes a food item from the menu list.
-// It prompts the user for the food item's ID and removes the item if it exists.
-void removeFoodItem(LinkedList& menuList) {
-    std::string itemID;
-    bool continueRemoveItem = true;
-    int attempts = 0;
-    const int maxAttempts = 5;
-
-    while(continueRemoveItem && attempts < maxAttempts) {
-        std::cout << "Enter the food ID of the item to remove from the menu: ";
-        std::getline(std::cin, itemID);
-
-        if(itemID.empty()){
-            std::cout << "Returning to main menu." << std::endl;
-            continueRemoveItem = false;
-        }
-        else if (menuList.removeItem(itemID)){
-            continueRemoveItem = false;
-        }
-        else{
-            std::cout << "Failed to remove item with ID " << itemID << ". Item may not exist." << std::endl;
-            attempts++;
-            if (attempts >= maxAttempts) {
-                std::cout << "Too many failed attempts. Returning to main menu." << std::endl;
-                continueRemoveItem = false;
-            }
+// This function finds food items by words from their names or descriptions and lists the best
+// matches, up to one page of them.
+void searchFood(const LinkedList& menuList) {
+    std::string query;
+    std::cout << "Enter words to search for: ";
+    if (!std::getline(std::cin, query) || query.empty()) {
+        std::cin.clear();
+        std::cout << "Returning to main menu." << std::endl;
+    } else {
+        std::vector<Node*> matches;
+        menuList.search(query, MENU_PAGE_SIZE, matches);
+        if (matches.empty()) {
+            std::cout << "No food items match \"" << query << "\"." << std::endl;
+        } else {
+            printItems(matches);
         }
     }
 }
 
 
-// This function formats and prints the change given to the customer.
-// It converts cents to dollars and cents and prints the change in a human-readable format.
-void printChange(const std::vector<std::pair<int, int>>& change) {
-    std::ostringstream changeOutput;
-    for (const auto& c : change) {
-        if (c.first >= 100) {
-            if (c.first == 100) {
-                changeOutput << "$1 ";
-            } else {
-                changeOutput << '$' << c.first / 100 << ' ';
-            }
-        } else {
-            changeOutput << c.first << 'c' << ' ';
-        }
+// The terminal's main menu. Its session runs the flows it shares with served sessions; the local
+// options, numbered as in TerminalOption, are carried out here.
+enum TerminalOption {
+    TERMINAL_ABORT = 7,
+    TERMINAL_STATS = 9,
+    TERMINAL_SEARCH = 10,
+    TERMINAL_BY_PRICE = 11
+};
+const SessionOption TERMINAL_MENU[] = {
+    { "Display Meal Options", SESSION_DISPLAY, false },
+    { "Purchase Meal", SESSION_PURCHASE, false },
+    { "Save and Exit", SESSION_END, false },
+    { "Add Food", SESSION_ADD, true },
+    { "Remove Food", SESSION_REMOVE, true },
+    { "Display Balance", SESSION_BALANCE, true },
+    { "Abort Program", SESSION_LOCAL, true },
+    { "Restock Food", SESSION_RESTOCK, true },
+    { "Display Statistics", SESSION_LOCAL, true },
+    { "Search Food", SESSION_LOCAL, true },
+    { "Display Meals by Price", SESSION_LOCAL, true }
+};
+
+// This function converts between the editable text files and a binary snapshot.
+// With toSnapshot set it reads the text files and writes the snapshot, otherwise the reverse.
+int convertSnapshot(bool toSnapshot, const std::string& snapshotFile, const std::string& foodsFile, const std::string& coinsFile) {
+    LinkedList menuList;
+    Coin coins;
+    bool converted = false;
+
+    if (toSnapshot) {
+        menuList.loadMenuFromFile(foodsFile);
+        coins.loadDenominations(coinsFile);
+        converted = Snapshot::save(snapshotFile, menuList, coins);
+    } else if (Snapshot::load(snapshotFile, menuList, coins)) {
+        converted = menuList.saveMenuToFile(foodsFile);
+        converted = coins.saveDenominations(coinsFile) && converted;
+    }
+    if (converted) {
+        std::cout << "Converted " << menuList.getCount() << " food items and the coin float." << std::endl;
     }
-    std::cout << "Your change is " << changeOutput.str() << std::endl;
+    return converted ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-// This function handles the purchasing of a meal.
-// It prompts the user for the food item ID, processes payment, provides change, and handles cancellation.
-void purchaseMeal(LinkedList& menu, Coin& coins) {
-    bool continueFindItem = true;
-    bool validItemFound = false;
-    bool userCancelled = false;
-    std::string itemId;
-
-    while (continueFindItem && !userCancelled) {
-        std::cout << "Purchase Meal" << std::endl;
-        std::cout << "-------------" << std::endl;
-        std::cout << "Please enter the ID of the food you wish to purchase:" << std::endl;
-        std::getline(std::cin, itemId);
-
-        if (itemId.empty()) {
-            std::cout << "Returning to main menu." << std::endl;
-            userCancelled = true;
-        } else {
-            Node* itemNode = menu.findItem(itemId);
-            if (itemNode == nullptr || !std::cin) {
-                std::cerr << "Error: Item not found in menu." << std::endl;
-            } else {
-                validItemFound = true;
-                continueFindItem = false;
-            }
-        }
+// This function puts the files of a committed save in place. Doing it again after a crash part way
+// through finishes the job.
+bool installSave(bool useSnapshot, const std::vector<std::string>& files) {
+    bool installed = SaveFile::install(files[0] + ".ids");
+    if (useSnapshot) {
+        installed = SaveFile::install(files[0]) && installed;
+    } else {
+        installed = LinkedList::installChanges(files[0]) && installed;
+        installed = SaveFile::install(files[1]) && installed;
     }
+    return installed;
+}
 
-    if (validItemFound && !userCancelled) {
-        Node* itemNode = menu.findItem(itemId); // Find the item again as continueFindItem is set to false
-        FoodItem* selectedItem = itemNode->data;
-        std::cout << "You have selected \"" << selectedItem->name << " - " << selectedItem->description << "\". This will cost you $" << selectedItem->price.dollars << '.' << std::setfill('0') << std::setw(2) << selectedItem->price.cents << std::endl;
-
-        double totalPrice = selectedItem->price.dollars + (selectedItem->price.cents / 100.0);
-        double paidAmount = 0.0;
-        double remainingAmount = totalPrice;
-
-        std::cout << "Please hand over the money - type in the value of each note/coin in cents." << std::endl;
-        std::cout << "Please enter ctrl-D or enter on a new line to cancel this purchase." << std::endl;
-
-        bool continuePurchase = true;
-        while (continuePurchase && !userCancelled) {
-            std::cout << "You still need to give us $" << std::fixed << std::setprecision(2) << remainingAmount << ": ";
-            std::string paymentInput;
-            std::getline(std::cin, paymentInput);
-
-            if (paymentInput.empty()) {
-                if (paidAmount > 0) {
-                    std::cout << "Transaction canceled. Refunding all payments." << std::endl;
-                    std::cout << "Refunded: $" << std::fixed << std::setprecision(2) << paidAmount << std::endl;
-                }
-                std::cout << "Returning to main menu." << std::endl;
-                userCancelled = true;
-            } else {
-                std::istringstream iss(paymentInput);
-                int payment;
-                if (!(iss >> payment) || !coins.isValidDenomination(payment)) {
-                    std::cout << "Error: invalid denomination encountered." << std::endl;
-                } else {
-                    if (coins.denominations[static_cast<int>(payment)] > 0) {
-                        paidAmount += payment / 100.0;
-                        remainingAmount = totalPrice - paidAmount;
+void discardSave(bool useSnapshot, const std::vector<std::string>& files) {
+    SaveFile::discard(files[0] + ".ids");
+    if (useSnapshot) {
+        SaveFile::discard(files[0]);
+    } else {
+        LinkedList::discardChanges(files[0]);
+        SaveFile::discard(files[1]);
+    }
+}
 
-                        if (remainingAmount < 0) {
-                            double changeNeeded = -remainingAmount;
-                            if (!coins.canMakeChange(changeNeeded)) {
-                                std::cout << "Unable to provide correct change. Transaction cannot be completed." << std::endl;
-                                std::cout << "Returning to main menu." << std::endl;
-                                userCancelled = true;
-                            } else {
-                                std::vector<std::pair<int, int>> change = coins.makeChange(changeNeeded);
-                                if (change.empty()) {
-                                    std::cout << "Error: Unable to make the necessary change." << std::endl;
-                                    std::cout << "Returning to main menu." << std::endl;
-                                    userCancelled = true;
-                                } else {
-                                    printChange(change);
-                                    continuePurchase = false;
-                                }
-                            }
-                        } else if (remainingAmount == 0) {
-                            std::cout << "Thank you for your payment!" << std::endl;
-                            continuePurchase = false;
-                        }
-                    } else {
-                        std::cout << "Error: Not enough coins of denomination to provide change." << std::endl;
-                    }
-                }
-            }
+// This function writes the machine state back in the form it was loaded from, and the food ID
+// high-water mark to "<first file>.ids". With the text files only what changed is written: the
+// changed items as a segment of the foods file's delta file, and the coins file only if the float
+// changed. Every file is first staged under another name and synced; a commit record in the
+// journal then makes the save count, and only after that are the files put in place and the
+// journal emptied. A crash at any point leaves either the old files and the whole journal, or a
+// committed save that recoverSave finishes at the next start, so no change is lost or applied twice.
+bool saveState(bool useSnapshot, const std::vector<std::string>& files, LinkedList& menuList, Coin& coins,
+               const FoodIdAllocator& ids, Journal& journal) {
+    bool staged = ids.save(files[0] + ".ids" + SAVE_STAGED_SUFFIX);
+    if (useSnapshot) {
+        staged = Snapshot::save(files[0] + SAVE_STAGED_SUFFIX, menuList, coins) && staged;
+    } else {
+        staged = menuList.saveChanges(files[0]) && staged;
+        if (coins.isChanged()) {
+            staged = coins.saveDenominations(files[1] + SAVE_STAGED_SUFFIX) && staged;
         }
     }
 
-    if (userCancelled) {
-        std::cout << "Purchase process was cancelled." << std::endl;
+    // Without a journal there is nothing that could be applied twice, so the save stands as it is.
+    bool saved = staged && (journal.commitSave() || !journal.isOpen()) && installSave(useSnapshot, files);
+    if (saved) {
+        journal.checkpoint();
+        menuList.markSaved();
+        coins.markSaved();
+    } else if (!staged) {
+        discardSave(useSnapshot, files);
     }
+    if (!saved) {
+        std::cerr << "The state could not be saved. Changes since the last save are kept in the journal." << std::endl;
+    }
+    return saved;
 }
 
-bool isValidMenuInput(const std::string& input) {
-    // Check if input is a valid integer within the range 1-7
-    bool valid = true;
-    if (input.empty() || input.find_first_not_of("0123456789") != std::string::npos) {
-        valid = false;
-    } else {
-        try {
-            int option = std::stoi(input);
-            if (option < 1 || option > 7) {
-                valid = false;
-            }
-        } catch (const std::invalid_argument& ia) {
-            valid = false;
-        } catch (const std::out_of_range& oor) {
-            valid = false;
+// This function deals with a save that a crash interrupted, before anything is loaded. A committed
+// save is put in place and the journal emptied, as it is all part of the save; anything staged by a
+// save that was not committed is thrown away, leaving the journal to be replayed over the old files.
+bool recoverSave(bool useSnapshot, const std::vector<std::string>& files, Journal& journal) {
+    bool recovered = true;
+    if (Journal::hasCommit(files[0] + ".journal")) {
+        recovered = installSave(useSnapshot, files);
+        if (recovered) {
+            journal.checkpoint();
+        } else {
+            std::cerr << "Could not finish the last save; fix the problem and start again." << std::endl;
         }
+    } else {
+        discardSave(useSnapshot, files);
     }
-    return valid;
+    return recovered;
 }
 
-
 // The main function initializes the program, loads data, displays the menu, and handles user input.
+// The machine state comes either from the foods and coins text files or from one binary snapshot,
+// and "Save and Exit" writes it back in the same form. Every change in between is journaled to
+// "<first file>.journal" and replayed over the saved state at the next start. Saving the text
+// files writes only what changed, to "<foods file>.delta"; see saveState.
+// With --batch the transactions in a file are run without prompts, on --terminals threads at once,
+// and the state is saved at the end. Operation statistics are printed to standard error on SIGUSR1.
+// New food IDs continue from the high-water mark in "<first file>.ids"; with --reuse-ids the IDs
+// of removed items are handed out again first.
+// With --changes the adds, removals, price changes and restocks in a change file are made all
+// together, or not at all if any of them cannot be, and the state is saved. See Batch::applyChanges.
+// The transaction or change file is itself a record of the run, so these modes journal with
+// buffered durability unless told otherwise.
+// With --serve, sessions are served to clients over a Unix domain socket at the path given, all
+// from one thread, until SIGINT or SIGTERM, and the state is then saved. See SessionServer.
 int main(int argc, char **argv) {
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " <foodsfile> <coinsfile>" << std::endl;
+    std::vector<std::string> args(argv + 1, argv + argc);
+    JournalDurability durability = JOURNAL_GROUP;
+    bool durabilityGiven = false;
+    bool validArgs = true;
+    std::string batchFile;
+    std::string changesFile;
+    std::string socketFile;
+    int terminals = 1;
+    bool reuseIds = false;
+
+    while (validArgs && !args.empty() && (args[0] == "--reuse-ids" ||
+           (args.size() >= 2 && (args[0] == "--durability" || args[0] == "--batch" || args[0] == "--changes" ||
+                                 args[0] == "--serve" || args[0] == "--terminals")))) {
+        std::size_t consumed = 2;
+        if (args[0] == "--reuse-ids") {
+            reuseIds = true;
+            consumed = 1;
+        } else if (args[0] == "--durability") {
+            validArgs = Journal::parseDurability(args[1], durability);
+            durabilityGiven = true;
+        } else if (args[0] == "--batch") {
+            batchFile = args[1];
+        } else if (args[0] == "--changes") {
+            changesFile = args[1];
+        } else if (args[0] == "--serve") {
+            socketFile = args[1];
+        } else {
+            validArgs = DataFile::parseInt(StrRef(args[1].data(), args[1].size()), terminals) && terminals > 0;
+        }
+        args.erase(args.begin(), args.begin() + consumed);
+    }
+    if ((batchFile.empty() && terminals != 1) || (!batchFile.empty() + !changesFile.empty() + !socketFile.empty() > 1)) {
+        validArgs = false;
+    } else if ((!batchFile.empty() || !changesFile.empty()) && !durabilityGiven) {
+        durability = JOURNAL_BUFFERED;
+    }
+    if (!socketFile.empty()) {
+        SessionServer::blockStopSignals();
+    }
+    Stats::dumpOnSignal(SIGUSR1);
+    if (validArgs && batchFile.empty() && changesFile.empty() && socketFile.empty() && args.size() == 4 && (args[0] == "--import" || args[0] == "--export")) {
+        bool toSnapshot = args[0] == "--import";
+        return toSnapshot ? convertSnapshot(true, args[3], args[1], args[2]) : convertSnapshot(false, args[1], args[2], args[3]);
+    }
+    if (!validArgs || (args.size() != 1 && args.size() != 2)) {
+        std::cerr << "Usage: " << argv[0] << " [--durability buffered|group|sync] [--reuse-ids] <foodsfile> <coinsfile>" << std::endl;
+        std::cerr << "       " << argv[0] << " [--durability buffered|group|sync] [--reuse-ids] <snapshotfile>" << std::endl;
+        std::cerr << "       " << argv[0] << " [--durability buffered|group|sync] [--reuse-ids] --batch <transactionsfile> [--terminals <n>] <foodsfile> <coinsfile>|<snapshotfile>" << std::endl;
+        std::cerr << "       " << argv[0] << " [--durability buffered|group|sync] [--reuse-ids] --changes <changesfile> <foodsfile> <coinsfile>|<snapshotfile>" << std::endl;
+        std::cerr << "       " << argv[0] << " [--durability buffered|group|sync] [--reuse-ids] --serve <socketfile> <foodsfile> <coinsfile>|<snapshotfile>" << std::endl;
+        std::cerr << "       " << argv[0] << " --import <foodsfile> <coinsfile> <snapshotfile>" << std::endl;
+        std::cerr << "       " << argv[0] << " --export <snapshotfile> <foodsfile> <coinsfile>" << std::endl;
         return EXIT_FAILURE;
     }
 
-    std::cout << "Food file: " << argv[1] << std::endl;
-    std::cout << "Coins file: " << argv[2] << std::endl;
-
+    bool useSnapshot = args.size() == 1;
+    bool batchMode = !batchFile.empty() || !changesFile.empty();
+    // In batch mode standard output carries only the transaction or change results.
+    std::ostream& status = batchMode ? std::cerr : std::cout;
     LinkedList menuList;
-    menuList.loadMenuFromFile(argv[1]);
-
     Coin coins;
-    coins.loadDenominations(argv[2]);
+    Journal journal;
+    FoodIdAllocator ids(reuseIds);
+    std::string journalFile = args[0] + ".journal";
+
+    journal.open(journalFile, durability);
+    if (!recoverSave(useSnapshot, args, journal)) {
+        return EXIT_FAILURE;
+    }
+    if (useSnapshot) {
+        status << "Snapshot file: " << args[0] << std::endl;
+        if (!Snapshot::load(args[0], menuList, coins)) {
+            return EXIT_FAILURE;
+        }
+    } else {
+        status << "Food file: " << args[0] << std::endl;
+        status << "Coins file: " << args[1] << std::endl;
+        menuList.loadMenuFromFile(args[0]);
+        coins.loadDenominations(args[1]);
+    }
+
+    ids.load(args[0] + ".ids");
+    unsigned replayed = Journal::replay(journalFile, menuList, coins, ids);
+    if (replayed > 0) {
+        status << "Recovered " << replayed << " unsaved changes from " << journalFile << std::endl;
+    }
+    ids.rebuild(menuList);
+
+    if (!changesFile.empty()) {
+        std::ios::sync_with_stdio(false);
+        SessionEngine engine(menuList, coins, journal, ids);
+        Batch batch(engine);
+        bool applied = batch.applyChanges(changesFile, std::cout);
+        const BatchStats& stats = batch.getStats();
+        if (applied) {
+            saveState(useSnapshot, args, menuList, coins, ids, journal);
+            std::cerr << "Made " << stats.succeeded << " changes in " << stats.seconds << " s" << std::endl;
+        } else if (stats.failed > 0) {
+            std::cerr << "Made none of the " << stats.transactions << " changes: " << stats.failed
+                      << " could not be made" << std::endl;
+        }
+        return applied ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (!socketFile.empty()) {
+        SessionEngine engine(menuList, coins, journal, ids);
+        SessionServer server(engine, menuList, coins);
+        bool served = server.listen(socketFile);
+        if (served) {
+            std::cout << "Serving sessions on " << socketFile << " until interrupted." << std::endl;
+            served = server.run();
+            const ServerStats& stats = server.getStats();
+            saveState(useSnapshot, args, menuList, coins, ids, journal);
+            std::cout << "Served " << stats.sessions << " sessions (" << stats.ended << " ended, " << stats.dropped
+                      << " dropped, at most " << stats.peak << " at once) and " << stats.lines << " lines in "
+                      << stats.seconds << " s" << std::endl;
+        }
+        return served ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (batchMode) {
+        std::ios::sync_with_stdio(false);
+        SessionEngine engine(menuList, coins, journal, ids);
+        Batch batch(engine);
+        bool ran = batch.run(batchFile, terminals, std::cout);
+        if (ran) {
+            const BatchStats& stats = batch.getStats();
+            saveState(useSnapshot, args, menuList, coins, ids, journal);
+            std::cerr << "Processed " << stats.transactions << " transactions (" << stats.succeeded << " succeeded, "
+                      << stats.failed << " failed) in " << stats.seconds << " s: "
+                      << (stats.seconds > 0 ? stats.transactions / stats.seconds : 0) << " transactions/s" << std::endl;
+        }
+        return ran ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
+    // The terminal is a session like those served with --serve, with the terminal's own menu. Save and
+    // Exit ends the session and saves the state; the end of input leaves it to the journal, as Abort.
+    SessionEngine engine(menuList, coins, journal, ids);
+    Session session(engine, menuList, coins, TERMINAL_MENU, sizeof(TERMINAL_MENU) / sizeof(TERMINAL_MENU[0]));
+    std::string reply;
+    std::string line;
     bool quit = false;
-    std::string menuInput;
 
+    session.start(reply);
     while (!quit) {
-        std::cout << "Main Menu:" << std::endl;
-        std::cout << "  1. Display Meal Options" << std::endl;
-        std::cout << "  2. Purchase Meal" << std::endl;
-        std::cout << "  3. Save and Exit" << std::endl;
-        std::cout << "Administrator-Only Menu:" << std::endl;
-        std::cout << "  4. Add Food" << std::endl;
-        std::cout << "  5. Remove Food" << std::endl;
-        std::cout << "  6. Display Balance" << std::endl;
-        std::cout << "  7. Abort Program" << std::endl;
-        std::cout << "Select your option (1-7) :" << std::endl;
-        std::getline(std::cin, menuInput);
+        std::cout << reply << std::flush;
+        reply.clear();
+        int option = 0;
+        if (!std::getline(std::cin, line)) {
+            option = TERMINAL_ABORT;
+        } else {
+            session.handleLine(StrRef(line.data(), line.size()), reply);
+            option = session.takeLocalOption();
+        }
 
-        try {
-            int option = std::stoi(menuInput);
-            if (option == 1) {
-                menuList.displayMenu();
-            } else if (option == 2) {
-                purchaseMeal(menuList, coins);
-            } else if (option == 3) {
-                menuList.saveMenuToFile(argv[1]);
-                coins.saveDenominations(argv[2]);
-                quit = true;
-            } else if (option == 4) {
-                addFoodItem(menuList);
-            } else if (option == 5) {
-                removeFoodItem(menuList);
-            } else if (option == 6) {
-                coins.displayBalance();
-            } else if (option == 7) {
-                std::cout << "Program is terminating. All program data will be lost." << std::endl;
-                menuList.~LinkedList();
-                coins.~Coin();
-                exit(0);
-            } else {
-                std::cout << "Invalid input. Please try again." << std::endl;
-            }
-        } catch (const std::invalid_argument& ia) {
-            std::cout << "Invalid input. Please enter a number from 1 to 7." << std::endl;
+        if (option == TERMINAL_ABORT) {
+            std::cout << "Program is terminating. Changes since the last save are kept in " << journalFile << " and will be recovered at the next start." << std::endl;
+            journal.sync();
+            menuList.~LinkedList();
+            coins.~Coin();
+            exit(0);
+        } else if (option == TERMINAL_STATS) {
+            Stats::print(std::cout);
+        } else if (option == TERMINAL_SEARCH) {
+            searchFood(menuList);
+        } else if (option == TERMINAL_BY_PRICE) {
+            displayMealsByPrice(menuList);
+        }
+        if (option != 0) {
+            session.start(reply);
+        } else if (session.isEnded()) {
+            saveState(useSnapshot, args, menuList, coins, ids, journal);
+            std::cout << reply << std::flush;
+            quit = true;
         }
     }
-    std::cout << "Good bye!";
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,326 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/resource.h>
+#include "SessionServer.h"
+
+// Load generator for "ftt --serve". Build with "make ftt_load" and run as
+//
+//   ftt_load [--sessions <n>] [--concurrency <n>] <socketfile>
+//
+// It first reads the first page of the menu and restocks every item on it, through one session of
+// its own, so the run does not sell out. It then keeps --concurrency sessions open at once, all
+// driven from one thread, until --sessions have run. Each session buys one item, going round the
+// items in turn: it chooses Purchase Meal, enters the ID, pays the exact price a coin per line,
+// largest coins first, and ends the session. Every line is sent only once the reply to the last
+// one is complete, as a customer would.
+//
+// Reported on standard output: sessions per second, and the percentiles of the time from sending a
+// line (or connecting) to having the whole reply, and of the time a whole session took. Sessions
+// that did not end in a sale are counted as failed; the exit status is non-zero if any did.
+
+namespace {
+
+// Defaults for --sessions and --concurrency.
+const unsigned DEFAULT_SESSIONS = 20000;
+const unsigned DEFAULT_CONCURRENCY = 1000;
+
+// Events taken from epoll per wait, and bytes read per event.
+const unsigned LOAD_EVENTS = 256;
+const unsigned LOAD_READ_BYTES = 8192;
+
+typedef std::chrono::steady_clock Clock;
+
+// Where a session is in its purchase: what the reply being waited for answers.
+enum LoadStep {
+    LOAD_GREETING,  // the main menu sent on connecting
+    LOAD_OPTION,    // "2", Purchase Meal
+    LOAD_ITEM,      // the item's ID
+    LOAD_COIN,      // a coin
+    LOAD_END        // "3", End Session; answered by the server closing the connection
+};
+
+struct Client {
+    int fd;
+    LoadStep step;
+    std::string reply;
+    const std::string* item;
+    std::vector<int> coins;  // still to pay, next one last
+    bool sold;
+    Clock::time_point started;
+    Clock::time_point sent;
+};
+
+bool endsWithPrompt(const std::string& reply) {
+    std::size_t length = sizeof(SESSION_PROMPT) - 1;
+    return reply.size() >= length && reply.compare(reply.size() - length, length, SESSION_PROMPT) == 0;
+}
+
+// Returns a connected socket, or -1 having said why not. A full backlog makes connect wait for the
+// server to catch up, which counts towards the session's first reply.
+int connectTo(const std::string& path) {
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    if (fd < 0) {
+        std::cerr << "Error connecting to " << path << ": " << std::strerror(errno) << std::endl;
+    }
+    return fd;
+}
+
+bool sendLine(int fd, const std::string& line) {
+    std::string text = line + '\n';
+    return send(fd, text.data(), text.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(text.size());
+}
+
+// Reads on a blocking socket until the reply is complete or the server closes the connection.
+bool readReply(int fd, std::string& reply) {
+    char buffer[LOAD_READ_BYTES];
+    bool open = true;
+    reply.clear();
+    while (open && !endsWithPrompt(reply)) {
+        ssize_t got = read(fd, buffer, sizeof(buffer));
+        open = got > 0;
+        if (open) {
+            reply.append(buffer, got);
+        }
+    }
+    return open;
+}
+
+// Sends a line on a blocking socket and reads the whole reply.
+bool converse(int fd, const std::string& line, std::string& reply) {
+    return sendLine(fd, line) && readReply(fd, reply);
+}
+
+// This function collects the IDs on the first page of the menu and sets each item's stock to level.
+// Returns false if the menu could not be read or is empty.
+bool prepareItems(const std::string& path, unsigned level, std::vector<std::string>& items) {
+    int fd = connectTo(path);
+    std::string reply;
+    bool ready = fd >= 0 && readReply(fd, reply) && converse(fd, "1", reply);
+
+    std::size_t start = 0;
+    std::size_t end = 0;
+    while (ready && (end = reply.find('\n', start)) != std::string::npos) {
+        std::string row = reply.substr(start, end - start);
+        std::size_t bar = row.find(" | ");
+        if (bar != std::string::npos && row.find(" | $") != std::string::npos) {
+            items.push_back(row.substr(0, row.find(' ')));
+        }
+        start = end + 1;
+    }
+    if (ready && reply.find("Enter a page number") != std::string::npos) {
+        ready = converse(fd, "", reply);
+    }
+    for (std::size_t i = 0; i < items.size() && ready; i++) {
+        ready = converse(fd, "7", reply) && converse(fd, items[i], reply) &&
+                converse(fd, std::to_string(level), reply) && reply.find("now has") != std::string::npos;
+    }
+    if (fd >= 0) {
+        sendLine(fd, "3");
+        close(fd);
+    }
+    if (ready && items.empty()) {
+        std::cerr << "There are no food items on the menu to buy." << std::endl;
+    }
+    return ready && !items.empty();
+}
+
+// Works out the price from the reply to choosing an item and the coins to pay it exactly with,
+// smallest first so the largest is paid first. Returns false if the item could not be had.
+bool planPayment(const std::string& reply, std::vector<int>& coins) {
+    std::size_t at = reply.find("This will cost you $");
+    long long cents = 0;
+    if (at != std::string::npos) {
+        char* end = nullptr;
+        const char* amount = reply.c_str() + at + std::strlen("This will cost you $");
+        cents = std::strtoll(amount, &end, 10) * 100;
+        if (*end == '.') {
+            cents += std::strtoll(end + 1, nullptr, 10);
+        }
+    }
+    coins.clear();
+    for (int slot = NUM_DENOMS - 1; slot >= 0; slot--) {
+        while (cents >= DENOMINATION_VALUES[slot]) {
+            coins.insert(coins.begin(), DENOMINATION_VALUES[slot]);
+            cents -= DENOMINATION_VALUES[slot];
+        }
+    }
+    return at != std::string::npos && cents == 0 && !coins.empty();
+}
+
+double micros(Clock::duration elapsed) {
+    return std::chrono::duration<double, std::micro>(elapsed).count();
+}
+
+void printPercentiles(const char* title, std::vector<double>& times) {
+    std::sort(times.begin(), times.end());
+    std::cout << title << " (us):";
+    if (times.empty()) {
+        std::cout << " none";
+    } else {
+        const double points[] = {0.50, 0.90, 0.99, 0.999};
+        const char* names[] = {"p50", "p90", "p99", "p99.9"};
+        for (int i = 0; i < 4; i++) {
+            std::size_t index = std::min(times.size() - 1, static_cast<std::size_t>(points[i] * times.size()));
+            std::cout << ' ' << names[i] << ' ' << std::fixed << std::setprecision(1) << times[index];
+        }
+        std::cout << " max " << times.back();
+    }
+    std::cout << std::endl;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    int sessions = DEFAULT_SESSIONS;
+    int concurrency = DEFAULT_CONCURRENCY;
+    bool validArgs = true;
+
+    while (validArgs && args.size() >= 2 && (args[0] == "--sessions" || args[0] == "--concurrency")) {
+        int& value = args[0] == "--sessions" ? sessions : concurrency;
+        validArgs = DataFile::parseInt(StrRef(args[1].data(), args[1].size()), value) && value > 0;
+        args.erase(args.begin(), args.begin() + 2);
+    }
+    if (!validArgs || args.size() != 1) {
+        std::cerr << "Usage: " << argv[0] << " [--sessions <n>] [--concurrency <n>] <socketfile>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    struct rlimit files;
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max) {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    std::vector<std::string> items;
+    if (!prepareItems(args[0], static_cast<unsigned>(sessions) + DEFAULT_FOOD_STOCK_LEVEL, items)) {
+        return EXIT_FAILURE;
+    }
+
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<Client*> clients;  // indexed by socket
+    std::vector<double> replyTimes;
+    std::vector<double> sessionTimes;
+    replyTimes.reserve(static_cast<std::size_t>(sessions) * 8);
+    sessionTimes.reserve(sessions);
+    unsigned started = 0;
+    unsigned finished = 0;
+    unsigned sold = 0;
+    unsigned running = 0;
+    bool failed = epollFd < 0;
+    Clock::time_point start = Clock::now();
+
+    while (!failed && finished < static_cast<unsigned>(sessions)) {
+        while (!failed && running < static_cast<unsigned>(concurrency) && started < static_cast<unsigned>(sessions)) {
+            Client* client = new Client();
+            client->fd = connectTo(args[0]);
+            client->step = LOAD_GREETING;
+            client->item = &items[started % items.size()];
+            client->sold = false;
+            client->started = Clock::now();
+            client->sent = client->started;
+            failed = client->fd < 0;
+            if (!failed) {
+                struct epoll_event event;
+                event.events = EPOLLIN;
+                event.data.fd = client->fd;
+                fcntl(client->fd, F_SETFL, fcntl(client->fd, F_GETFL) | O_NONBLOCK);
+                epoll_ctl(epollFd, EPOLL_CTL_ADD, client->fd, &event);
+                if (static_cast<std::size_t>(client->fd) >= clients.size()) {
+                    clients.resize(client->fd + 1, nullptr);
+                }
+                clients[client->fd] = client;
+                started++;
+                running++;
+            } else {
+                delete client;
+            }
+        }
+
+        struct epoll_event events[LOAD_EVENTS];
+        int ready = failed ? 0 : epoll_wait(epollFd, events, LOAD_EVENTS, -1);
+        for (int i = 0; i < ready; i++) {
+            Client* client = clients[events[i].data.fd];
+            char buffer[LOAD_READ_BYTES];
+            ssize_t got = read(client->fd, buffer, sizeof(buffer));
+            bool done = got == 0 || (got < 0 && errno != EAGAIN && errno != EINTR);
+
+            if (got > 0) {
+                client->reply.append(buffer, got);
+            }
+            if (got > 0 && endsWithPrompt(client->reply)) {
+                Clock::time_point now = Clock::now();
+                replyTimes.push_back(micros(now - client->sent));
+                std::string line;
+                if (client->step == LOAD_GREETING) {
+                    client->step = LOAD_OPTION;
+                    line = "2";
+                } else if (client->step == LOAD_OPTION) {
+                    client->step = LOAD_ITEM;
+                    line = *client->item;
+                } else if (client->step == LOAD_ITEM && planPayment(client->reply, client->coins)) {
+                    client->step = LOAD_COIN;
+                } else if (client->step == LOAD_COIN && client->coins.empty()) {
+                    client->sold = client->reply.find("Thank you for your payment") != std::string::npos;
+                    client->step = LOAD_END;
+                    line = "3";
+                } else if (client->step != LOAD_COIN) {
+                    // Not the reply a purchase expects; the session is given up.
+                    done = true;
+                }
+                if (!done && client->step == LOAD_COIN) {
+                    line = std::to_string(client->coins.back());
+                    client->coins.pop_back();
+                }
+                client->reply.clear();
+                client->sent = Clock::now();
+                done = done || !sendLine(client->fd, line);
+            }
+
+            if (done) {
+                if (client->step == LOAD_END && got == 0) {
+                    replyTimes.push_back(micros(Clock::now() - client->sent));
+                    sessionTimes.push_back(micros(Clock::now() - client->started));
+                }
+                sold += client->sold ? 1 : 0;
+                clients[client->fd] = nullptr;
+                close(client->fd);
+                delete client;
+                running--;
+                finished++;
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (epollFd >= 0) {
+        close(epollFd);
+    }
+
+    std::cout << "Sessions: " << finished << " of " << sessions << " (" << sold << " sales, " << finished - sold
+              << " failed) with up to " << concurrency << " at once in " << std::fixed << std::setprecision(2)
+              << seconds << " s: " << std::setprecision(0) << (seconds > 0 ? finished / seconds : 0)
+              << " sessions/s" << std::endl;
+    printPercentiles("Reply latency", replyTimes);
+    printPercentiles("Session latency", sessionTimes);
+    return !failed && sold == static_cast<unsigned>(sessions) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,382 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "Workload.h"
+#include "LinkedList.h"
+#include "Coin.h"
+#include "DataFile.h"
+
+// Test data generator and differential checker for ftt. Build with "make ftt_workload".
+//
+//   ftt_workload generate [options] <directory>
+//   ftt_workload compare [options] <reference ftt> <candidate ftt>
+//
+// Options: --seed <n> (default 1), --items <n> (default 1000), --transactions <n> (default
+// 100000), and --depleted to start from a float of a few coins. See Workload for what is made.
+//
+// generate writes foods.dat, coins.dat and transactions.txt to the directory. compare generates
+// them into workload.<seed>/reference and workload.<seed>/candidate and runs each build of ftt
+// over its copy with --batch on one terminal, which saves the state at the end. It then checks:
+//
+//   - that each run's own results add up: every sale was of an item on the menu and in stock,
+//     the coins paid in less the change handed out come to its price, and the change was in the
+//     float at the time, which held some of every denomination paid in; and that the state each
+//     run saved is what its results say it should be;
+//   - that the two runs gave the same result for every transaction, and saved the same items,
+//     prices, stock levels and float.
+//
+// The saved state is read with this build's loaders, so a reference build that saves in another
+// form than the candidate is compared fairly. The reference must have --batch. The directory is
+// removed if the runs agree and kept for a look otherwise; the exit status is non-zero then.
+
+namespace {
+
+// An item as the results of a run say it should be.
+struct ModelItem {
+    int price;
+    unsigned onHand;
+};
+
+struct WorkloadOptions {
+    unsigned long long seed;
+    int items;
+    int transactions;
+    bool depleted;
+};
+
+// Differences reported before the rest are only counted.
+const unsigned REPORTED_DIFFERENCES = 5;
+
+bool generate(const WorkloadOptions& options, const std::string& directory) {
+    Workload workload(options.seed);
+    mkdir(directory.c_str(), 0777);
+    bool written = workload.writeCatalog(directory + "/foods.dat", options.items) &&
+                   workload.writeCoins(directory + "/coins.dat", options.depleted) &&
+                   workload.writeTransactions(directory + "/transactions.txt", options.transactions);
+    if (!written) {
+        std::cerr << "Error writing the workload to " << directory << std::endl;
+    }
+    return written;
+}
+
+// This function runs ftt over the workload in directory, with the results going to results.txt
+// and everything else to log.txt there. Returns false, saying why, if it did not exit cleanly.
+bool runBatch(const std::string& binary, const std::string& directory) {
+    char program[PATH_MAX];
+    bool found = realpath(binary.c_str(), program) != nullptr;
+    int status = -1;
+
+    if (found) {
+        pid_t child = fork();
+        if (child == 0) {
+            int results = open((directory + "/results.txt").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+            int log = open((directory + "/log.txt").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+            if (results >= 0 && log >= 0 && chdir(directory.c_str()) == 0 && dup2(results, 1) >= 0 && dup2(log, 2) >= 0) {
+                execl(program, program, "--batch", "transactions.txt", "foods.dat", "coins.dat", static_cast<char*>(nullptr));
+            }
+            _exit(127);
+        }
+        if (child > 0) {
+            waitpid(child, &status, 0);
+        }
+    }
+    if (!found) {
+        std::cerr << "Error: cannot find " << binary << std::endl;
+    } else if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "Error: " << binary << " did not complete the workload; see " << directory << "/log.txt" << std::endl;
+    }
+    return found && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Reads coins written as "<value>,<value>,..." or as change, "<value>*<count>,..." or "-", into
+// counts by Denomination. Returns false if any is not a denomination.
+bool readCoins(StrRef text, int* counts) {
+    StrRef rest = text.length == 1 && text.data[0] == '-' ? StrRef() : text;
+    bool valid = true;
+    std::fill(counts, counts + NUM_DENOMS, 0);
+
+    while (!rest.empty() && valid) {
+        StrRef coin[2];
+        StrRef parts[2];
+        int value = 0;
+        int count = 1;
+        unsigned coins = DataFile::split(rest, ',', coin, 2);
+        unsigned fields = DataFile::split(coin[0], '*', parts, 2);
+        valid = DataFile::parseInt(parts[0], value) && denominationSlot(value) != NO_DENOMINATION &&
+                (fields == 1 || DataFile::parseInt(parts[1], count));
+        if (valid) {
+            counts[denominationSlot(value)] += count;
+        }
+        rest = coins == 2 ? coin[1] : StrRef();
+    }
+    return valid;
+}
+
+long long valueOf(const int* counts) {
+    long long cents = 0;
+    for (int slot = 0; slot < NUM_DENOMS; slot++) {
+        cents += static_cast<long long>(counts[slot]) * DENOMINATION_VALUES[slot];
+    }
+    return cents;
+}
+
+void loadState(const std::string& directory, std::map<std::string, ModelItem>& items, CoinFloat& coinFloat) {
+    LinkedList menu;
+    Coin coins;
+    menu.loadMenuFromFile(directory + "/foods.dat");
+    coins.loadDenominations(directory + "/coins.dat");
+    items.clear();
+    for (Node* current = menu.getHead(); current != nullptr; current = current->next) {
+        items[current->data->id] = ModelItem{static_cast<int>(current->data->price.asCents()), current->data->on_hand.get()};
+    }
+    coinFloat = coins.getFloat();
+}
+
+// This function follows one run's results through the transactions, starting from the state the
+// workload began with, and checks every sale and then the state the run saved. Returns the
+// number of problems found, reporting the first few.
+unsigned checkRun(const std::string& directory, std::map<std::string, ModelItem> items, CoinFloat coinFloat,
+                  unsigned& succeeded) {
+    DataFile transactions(directory + "/transactions.txt");
+    DataFile results(directory + "/results.txt");
+    StrRef line;
+    StrRef result;
+    unsigned problems = 0;
+    succeeded = 0;
+
+    while (transactions.nextLine(line) && results.nextLine(result)) {
+        StrRef fields[5];
+        StrRef outcome[3];
+        unsigned found = DataFile::split(line, '|', fields, 5);
+        bool ok = DataFile::split(result, '|', outcome, 3) == 3 && outcome[1].str() == "OK";
+        const char* problem = nullptr;
+        std::map<std::string, ModelItem>::iterator item = items.find(fields[found > 1 ? 1 : 0].str());
+        succeeded += ok ? 1 : 0;
+
+        if (ok && fields[0].str() == "P") {
+            int paid[NUM_DENOMS];
+            int change[NUM_DENOMS];
+            bool inFloat = true;
+            if (!readCoins(fields[2], paid) || !readCoins(outcome[2], change)) {
+                problem = "a sale with coins that are not denominations";
+            } else if (item == items.end() || item->second.onHand == 0) {
+                problem = "a sale of an item not on the menu or out of stock";
+            } else if (valueOf(paid) - valueOf(change) != item->second.price) {
+                problem = "a sale whose payment less change is not the price";
+            }
+            for (int slot = 0; slot < NUM_DENOMS && problem == nullptr; slot++) {
+                inFloat = inFloat && change[slot] <= coinFloat.counts[slot] && (paid[slot] == 0 || coinFloat.counts[slot] > 0);
+            }
+            if (problem == nullptr && !inFloat) {
+                problem = "change that was not in the float, or coins it holds none of taken";
+            } else if (problem == nullptr) {
+                item->second.onHand--;
+                for (int slot = 0; slot < NUM_DENOMS; slot++) {
+                    coinFloat.counts[slot] += paid[slot] - change[slot];
+                }
+            }
+        } else if (ok && fields[0].str() == "A") {
+            int price = 0;
+            DataFile::parseCents(fields[3], price);
+            items[outcome[2].str()] = ModelItem{price, DEFAULT_FOOD_STOCK_LEVEL};
+        } else if (ok && fields[0].str() == "R") {
+            if (item == items.end()) {
+                problem = "an item removed that was not on the menu";
+            } else {
+                items.erase(item);
+            }
+        } else if (ok && fields[0].str() == "Q") {
+            int level = 0;
+            if (item == items.end() || !DataFile::parseInt(fields[2], level)) {
+                problem = "an item restocked that was not on the menu";
+            } else {
+                item->second.onHand = level;
+            }
+        }
+        if (problem != nullptr && ++problems <= REPORTED_DIFFERENCES) {
+            std::cout << "  " << directory << ": line " << transactions.lineNumber() << ": " << problem << ": "
+                      << line.str() << " -> " << result.str() << std::endl;
+        }
+    }
+    if (transactions.nextLine(line) || results.nextLine(result)) {
+        std::cout << "  " << directory << ": the results do not match the transactions one for one" << std::endl;
+        problems++;
+    }
+
+    std::map<std::string, ModelItem> saved;
+    CoinFloat savedFloat;
+    loadState(directory, saved, savedFloat);
+    bool sameItems = saved.size() == items.size();
+    for (std::map<std::string, ModelItem>::const_iterator i = saved.begin(), j = items.begin(); sameItems && i != saved.end(); ++i, ++j) {
+        sameItems = i->first == j->first && i->second.price == j->second.price && i->second.onHand == j->second.onHand;
+    }
+    if (!sameItems) {
+        std::cout << "  " << directory << ": the saved menu is not what the results say it should be" << std::endl;
+        problems++;
+    }
+    if (!std::equal(savedFloat.counts, savedFloat.counts + NUM_DENOMS, coinFloat.counts)) {
+        std::cout << "  " << directory << ": the saved float is not what the results say it should be" << std::endl;
+        problems++;
+    }
+    return problems;
+}
+
+// Returns the number of transactions the two runs gave different results for, reporting the
+// first few.
+unsigned compareResults(const std::string& reference, const std::string& candidate) {
+    DataFile first(reference + "/results.txt");
+    DataFile second(candidate + "/results.txt");
+    StrRef one;
+    StrRef other;
+    unsigned differences = 0;
+    bool more = true;
+
+    while (more) {
+        bool hasOne = first.nextLine(one);
+        bool hasOther = second.nextLine(other);
+        more = hasOne || hasOther;
+        if (more && (!hasOne || !hasOther || one.str() != other.str())) {
+            if (++differences <= REPORTED_DIFFERENCES) {
+                std::cout << "  reference: " << (hasOne ? one.str() : "(none)") << "\n  candidate: "
+                          << (hasOther ? other.str() : "(none)") << std::endl;
+            }
+        }
+    }
+    return differences;
+}
+
+// Returns the number of items the two runs saved differently, plus one if their floats differ.
+unsigned compareStates(const std::string& reference, const std::string& candidate) {
+    std::map<std::string, ModelItem> first;
+    std::map<std::string, ModelItem> second;
+    CoinFloat firstFloat;
+    CoinFloat secondFloat;
+    loadState(reference, first, firstFloat);
+    loadState(candidate, second, secondFloat);
+    unsigned differences = 0;
+
+    for (const std::pair<const std::string, ModelItem>& item : first) {
+        std::map<std::string, ModelItem>::const_iterator other = second.find(item.first);
+        if (other == second.end() || other->second.price != item.second.price || other->second.onHand != item.second.onHand) {
+            differences++;
+        }
+    }
+    for (const std::pair<const std::string, ModelItem>& item : second) {
+        differences += first.count(item.first) == 0 ? 1 : 0;
+    }
+    if (!std::equal(firstFloat.counts, firstFloat.counts + NUM_DENOMS, secondFloat.counts)) {
+        differences++;
+    }
+    return differences;
+}
+
+// The last line ftt wrote to its log, which gives how long the run took.
+std::string lastLogLine(const std::string& directory) {
+    std::ifstream log(directory + "/log.txt");
+    std::string line;
+    std::string last;
+    while (std::getline(log, line)) {
+        last = line.empty() ? last : line;
+    }
+    return last;
+}
+
+bool compare(const WorkloadOptions& options, const std::string& reference, const std::string& candidate) {
+    std::string directory = "workload." + std::to_string(options.seed);
+    std::string referenceDir = directory + "/reference";
+    std::string candidateDir = directory + "/candidate";
+    mkdir(directory.c_str(), 0777);
+    bool ran = generate(options, referenceDir) && generate(options, candidateDir) &&
+               runBatch(reference, referenceDir) && runBatch(candidate, candidateDir);
+    bool agreed = false;
+
+    if (ran) {
+        std::map<std::string, ModelItem> items;
+        CoinFloat coinFloat;
+        unsigned referenceSucceeded = 0;
+        unsigned candidateSucceeded = 0;
+        Workload workload(options.seed);
+        workload.writeCatalog(directory + "/foods.dat", options.items);
+        workload.writeCoins(directory + "/coins.dat", options.depleted);
+        loadState(directory, items, coinFloat);
+
+        std::cout << "Workload: seed " << options.seed << ", " << options.items << " items, " << options.transactions
+                  << " transactions, " << (options.depleted ? "depleted" : "working") << " float" << std::endl;
+        unsigned referenceProblems = checkRun(referenceDir, items, coinFloat, referenceSucceeded);
+        std::cout << "Reference: " << referenceSucceeded << " succeeded, " << referenceProblems << " problems; "
+                  << lastLogLine(referenceDir) << std::endl;
+        unsigned candidateProblems = checkRun(candidateDir, items, coinFloat, candidateSucceeded);
+        std::cout << "Candidate: " << candidateSucceeded << " succeeded, " << candidateProblems << " problems; "
+                  << lastLogLine(candidateDir) << std::endl;
+        unsigned resultDifferences = compareResults(referenceDir, candidateDir);
+        unsigned stateDifferences = compareStates(referenceDir, candidateDir);
+        std::cout << "Results: " << resultDifferences << " transactions differ" << std::endl;
+        std::cout << "Saved state: " << stateDifferences << " items or floats differ" << std::endl;
+        agreed = referenceProblems == 0 && candidateProblems == 0 && resultDifferences == 0 && stateDifferences == 0;
+    }
+
+    if (agreed) {
+        const char* files[] = { "foods.dat", "foods.dat.delta", "foods.dat.ids", "foods.dat.journal", "coins.dat",
+                                "transactions.txt", "results.txt", "log.txt" };
+        for (const std::string& run : { referenceDir, candidateDir }) {
+            for (const char* file : files) {
+                std::remove((run + "/" + file).c_str());
+            }
+            rmdir(run.c_str());
+        }
+        std::remove((directory + "/foods.dat").c_str());
+        std::remove((directory + "/coins.dat").c_str());
+        rmdir(directory.c_str());
+        std::cout << "The runs agree." << std::endl;
+    } else if (ran) {
+        std::cout << "The runs do not agree; the files are kept in " << directory << "." << std::endl;
+    }
+    return agreed;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    WorkloadOptions options = { 1, 1000, 100000, false };
+    std::string command = args.empty() ? "" : args[0];
+    bool validArgs = command == "generate" || command == "compare";
+    int seed = 1;
+    if (validArgs) {
+        args.erase(args.begin());
+    }
+
+    while (validArgs && !args.empty() && (args[0] == "--depleted" ||
+           (args.size() >= 2 && (args[0] == "--seed" || args[0] == "--items" || args[0] == "--transactions")))) {
+        std::size_t consumed = 2;
+        if (args[0] == "--depleted") {
+            options.depleted = true;
+            consumed = 1;
+        } else {
+            int& value = args[0] == "--seed" ? seed : args[0] == "--items" ? options.items : options.transactions;
+            validArgs = DataFile::parseInt(StrRef(args[1].data(), args[1].size()), value);
+        }
+        args.erase(args.begin(), args.begin() + consumed);
+    }
+    options.seed = static_cast<unsigned long long>(seed);
+
+    if (!validArgs || args.size() != (command == "generate" ? 1u : 2u)) {
+        std::cerr << "Usage: " << argv[0] << " generate [--seed <n>] [--items <n>] [--transactions <n>] [--depleted] <directory>" << std::endl;
+        std::cerr << "       " << argv[0] << " compare [--seed <n>] [--items <n>] [--transactions <n>] [--depleted] <reference ftt> <candidate ftt>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    bool succeeded = command == "generate" ? generate(options, args[0]) : compare(options, args[0], args[1]);
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}